@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Circle.h"
+#include "Rectangle.h"
+
+//! Axis-aligned bounds used by the broadphases. Edges are inclusive.
+struct Aabb
+{
+	float minX;
+	float minY;
+	float maxX;
+	float maxY;
+};
+
+inline Aabb MakeAabb(float minX_, float minY_, float maxX_, float maxY_)
+{
+	Aabb aabb;
+	aabb.minX = minX_;
+	aabb.minY = minY_;
+	aabb.maxX = maxX_;
+	aabb.maxY = maxY_;
+	return aabb;
+}
+
+inline Aabb MakeAabb(const Circle& circle_)
+{
+	return MakeAabb(circle_.x - circle_.r, circle_.y - circle_.r, circle_.x + circle_.r, circle_.y + circle_.r);
+}
+
+inline Aabb MakeAabb(const Rectangle& rect_)
+{
+	return MakeAabb(rect_.x1, rect_.y1, rect_.x2, rect_.y2);
+}
+
+inline bool AabbOverlap(const Aabb& a_, const Aabb& b_)
+{
+	return a_.minX <= b_.maxX && b_.minX <= a_.maxX
+		&& a_.minY <= b_.maxY && b_.minY <= a_.maxY;
+}
+
+inline bool AabbContains(const Aabb& outer_, const Aabb& inner_)
+{
+	return outer_.minX <= inner_.minX && outer_.minY <= inner_.minY
+		&& inner_.maxX <= outer_.maxX && inner_.maxY <= outer_.maxY;
+}
+
+inline Aabb AabbUnion(const Aabb& a_, const Aabb& b_)
+{
+	return MakeAabb(a_.minX < b_.minX ? a_.minX : b_.minX, a_.minY < b_.minY ? a_.minY : b_.minY,
+		a_.maxX > b_.maxX ? a_.maxX : b_.maxX, a_.maxY > b_.maxY ? a_.maxY : b_.maxY);
+}
+
+inline Aabb AabbInflate(const Aabb& aabb_, float margin_)
+{
+	return MakeAabb(aabb_.minX - margin_, aabb_.minY - margin_, aabb_.maxX + margin_, aabb_.maxY + margin_);
+}
+
+//! Half the perimeter, the insertion cost used by DynamicAabbTree.
+inline float AabbHalfPerimeter(const Aabb& aabb_)
+{
+	return (aabb_.maxX - aabb_.minX) + (aabb_.maxY - aabb_.minY);
+}
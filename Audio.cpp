@@ -86,6 +86,7 @@
  *  Comments relating to the relevant code are provided inside the code as comments #3-1 and #3-2.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <new>
 
@@ -98,7 +99,6 @@
 
 #include <nn/audio.h>
 #include <nns/audio/audio_HidUtilities.h>
-#include <nns/audio/audio_WavFormat.h>
 
 #include <nn/hid.h>
 #include <nn/hid/hid_KeyboardKey.h>
@@ -106,6 +106,13 @@
 
 #include <nn/settings/settings_DebugPad.h>
 
+#include "AudioTelemetry.h"
+#include "SeBank.h"
+#include "SineGenerator.h"
+#include "StreamingVoice.h"
+#include "VoiceManager.h"
+#include "WavParser.h"
+
 namespace AUS {
     namespace {
 
@@ -118,6 +125,10 @@ namespace AUS {
         const int BgmCount = 1;
         const int SeCount = 4;
 
+        // Sound effects can overlap; the quietest of them go virtual past SeVoiceCount voices.
+        const int SeSoundCountMax = 64;
+        const int SeVoiceCount = 16;
+
         const char Title[] = "AudioDevice";
 
         // - Add or remove these files from the files lists.
@@ -126,6 +137,18 @@ namespace AUS {
             "asset:/AudioDevice/SampleBgm0-2ch.wav",
         };
 
+        // The sound effects come from one bank built offline with SeBankTool from the .adpcm
+        // files below. When the bank is missing or broken they are read file by file instead.
+        const char g_SeBankFileName[] = "asset:/AudioCommon/SampleSe.sebank";
+
+        const char* g_SeNames[SeCount] =
+        {
+            "SampleSe0",
+            "SampleSe1",
+            "SampleSe2",
+            "SampleSe3",
+        };
+
         const char* g_SeFileNames[SeCount] =
         {
             "asset:/AudioCommon/SampleSe0.adpcm",
@@ -157,18 +180,22 @@ namespace AUS {
         g_Allocator.Free(p);
     }
 
+    // Fills an existing 16-bit buffer with a full scale sine wave, starting at phase 0.
+    std::size_t GenerateSineWave(int16_t* data, int sampleRate, int frequency, int sampleCount)
+    {
+        NN_ASSERT_NOT_NULL(data);
+        SineGenerator generator(static_cast<float>(frequency), sampleRate, static_cast<float>(std::numeric_limits<int16_t>::max()) / 32768.0f);
+        generator.Generate(data, sampleCount);
+        return sampleCount * sizeof(int16_t);
+    }
+
     std::size_t GenerateSineWave(void** data, int sampleRate, int frequency, int sampleCount)
     {
         // The entire memory region managed with g_WaveBufferAllocator is added to the memory pool, waveBufferMemoryPool.
         int16_t* p = static_cast<int16_t*>(g_WaveBufferAllocator.Allocate(sampleCount * sizeof(int16_t), nn::audio::BufferAlignSize));
         NN_ABORT_UNLESS_NOT_NULL(p);
-        const float Pi = 3.1415926535897932384626433f;
-        for (auto i = 0; i < sampleCount; ++i)
-        {
-            p[i] = static_cast<int16_t>(std::numeric_limits<int16_t>::max() * sinf(2 * Pi * frequency * i / sampleRate));
-        }
         *data = p;
-        return sampleCount * sizeof(int16_t);
+        return GenerateSineWave(p, sampleRate, frequency, sampleCount);
     }
 
     std::size_t ReadAdpcmFile(nn::audio::AdpcmHeaderInfo* header, void** adpcmData, const char* filename)
@@ -197,7 +224,9 @@ namespace AUS {
         return static_cast<std::size_t>(size) - sizeof(adpcmheader);
     }
 
-    std::size_t ReadWavFile(nns::audio::WavFormat* format, void** data, const char* filename)
+    // Loads the samples of a WAV file of any layout as 16-bit PCM. Only the chunk headers and
+    // the fmt chunk are read besides the samples, and the allocation holds the samples alone.
+    std::size_t ReadWavFile(WavInfo* info, void** data, const char* filename)
     {
         nn::fs::FileHandle handle;
         nn::Result result = nn::fs::OpenFile(&handle, filename, nn::fs::OpenMode_Read);
@@ -208,24 +237,37 @@ namespace AUS {
         result = nn::fs::GetFileSize(&size, handle);
         NN_ABORT_UNLESS(result.IsSuccess());
 
-        *data = g_WaveBufferAllocator.Allocate(static_cast<std::size_t>(size), nn::audio::BufferAlignSize);
-        NN_ABORT_UNLESS_NOT_NULL(*data);
-
-        // The DATA chunk must be read, but this sample assumes that it is found to be 1024 bits or less.
-        const std::size_t WavHeaderDataSize = 1024;
+        WavResult wavResult = ParseWav(info, ReadFileHandle, &handle, size);
+        NN_ABORT_UNLESS_EQUAL(wavResult, WavResult_Success);
 
-        result = nn::fs::ReadFile(handle, 0, *data, WavHeaderDataSize);
-        NN_ABORT_UNLESS(result.IsSuccess());
-
-        nns::audio::WavResult wavResult = nns::audio::ParseWavFormat(format, *data, WavHeaderDataSize);
-        NN_ABORT_UNLESS_EQUAL(wavResult, nns::audio::WavResult_Success);
-        NN_ABORT_UNLESS_EQUAL(format->bitsPerSample, 16);  // This sample assumes 16-bit PCM.
+        const std::size_t sampleCount = static_cast<std::size_t>(info->frameCount) * info->channelCount;
+        int16_t* p = static_cast<int16_t*>(g_WaveBufferAllocator.Allocate(sampleCount * sizeof(int16_t), nn::audio::BufferAlignSize));
+        NN_ABORT_UNLESS_NOT_NULL(p);
+        *data = p;
 
-        result = nn::fs::ReadFile(handle, static_cast<std::size_t>(format->dataOffset), *data, static_cast<std::size_t>(format->dataSize));
-        NN_ABORT_UNLESS(result.IsSuccess());
+        if (info->sampleFormat == WavSampleFormat_PcmInt16)
+        {
+            NN_ABORT_UNLESS(ReadFileHandle(p, info->dataOffset, sampleCount * sizeof(int16_t), &handle));
+        }
+        else
+        {
+            // Convert a piece at a time through a staging buffer outside the memory pool.
+            const std::size_t StagingSize = 16 * 1024;
+            void* staging = g_Allocator.Allocate(StagingSize, sizeof(int32_t));
+            NN_ABORT_UNLESS_NOT_NULL(staging);
+            const std::size_t sampleByteSize = GetWavSampleByteSize(info->sampleFormat);
+            const std::size_t pieceSampleCount = StagingSize / info->frameByteSize * info->channelCount;
+            for (std::size_t done = 0; done < sampleCount; done += pieceSampleCount)
+            {
+                const std::size_t count = std::min(pieceSampleCount, sampleCount - done);
+                NN_ABORT_UNLESS(ReadFileHandle(staging, info->dataOffset + static_cast<int64_t>(done * sampleByteSize), count * sampleByteSize, &handle));
+                ConvertWavSamples(p + done, staging, info->sampleFormat, count);
+            }
+            g_Allocator.Free(staging);
+        }
         nn::fs::CloseFile(handle);
 
-        return static_cast<std::size_t>(format->dataSize);
+        return sampleCount * sizeof(int16_t);
     }
 
     void InitializeFileSystem()
@@ -325,6 +367,7 @@ namespace AUS {
         NNS_LOG("[X]             StartSound                   (SampleSe2)\n");
         NNS_LOG("[Y]             StartSound                   (SampleSe3)\n");
         NNS_LOG("[L]             Toggle Application Specific DownMix     \n");
+        NNS_LOG("[R]             Print Audio Telemetry                   \n");
         NNS_LOG("[Left][Right]   Select Device                           \n");
         NNS_LOG("[Up][Down]      Control Selected Device Volume          \n");
         NNS_LOG("[Select/-]      Print Usage                             \n");
@@ -332,6 +375,32 @@ namespace AUS {
         NNS_LOG("--------------------------------------------------------\n");
     }
 
+    void PrintAudioHistogram(const char* name, const AUS::AudioHistogram& histogram)
+    {
+        NNS_LOG("%s:\n", name);
+        for (int i = 0; i < AUS::AudioHistogramBinCount; ++i)
+        {
+            if (histogram.counts[i] > 0)
+            {
+                const bool isLast = i == AUS::AudioHistogramBinCount - 1;
+                NNS_LOG("  %6d us%s %d\n", histogram.binMicroSeconds * i, isLast ? " and up" : "       ", histogram.counts[i]);
+            }
+        }
+    }
+
+    void PrintAudioTelemetry(const AUS::AudioTelemetry& telemetry)
+    {
+        const AUS::AudioTelemetryStats stats = telemetry.GetStats();
+        NNS_LOG("Renderer: %d updates of %d us, %d late\n", stats.wakeCount, stats.periodMicroSeconds, stats.lateWakeCount);
+        NNS_LOG("  update %d us after the wake, peak %d us\n", stats.lastLatencyMicroSeconds, stats.peakLatencyMicroSeconds);
+        NNS_LOG("  jitter %d us, peak %d us\n", stats.lastJitterMicroSeconds, stats.peakJitterMicroSeconds);
+        AUS::AudioHistogram histogram;
+        telemetry.GetLatencyHistogram(&histogram);
+        PrintAudioHistogram("Update latency", histogram);
+        telemetry.GetJitterHistogram(&histogram);
+        PrintAudioHistogram("Wake jitter", histogram);
+    }
+
     void SetDefaultParameter(nn::audio::AudioRendererParameter& parameter)
     {
         nn::audio::InitializeAudioRendererParameter(&parameter);
@@ -345,54 +414,56 @@ namespace AUS {
         parameter.performanceFrameCount = 0;
     }
 
+    // Streams the BGM files. The chunks of the voices come from the wave buffer pool, their
+    // loader threads' stacks and staging buffers from ordinary memory.
     void SetupBgmVoices(
-        nn::audio::VoiceType* pOutVoices,
-        nn::audio::WaveBuffer* pOutWaveBuffers,
-        void** ppDataBuffer,
+        StreamingVoice* pOutVoices,
+        void** ppWaveBuffers,
+        void** ppWorkBuffers,
         nn::audio::AudioRendererConfig& config)
     {
+        const size_t waveBufferSize = StreamingVoice::GetRequiredWaveBufferSize();
+        const size_t workBufferSize = StreamingVoice::GetRequiredWorkBufferSize();
         for (int i = 0; i < BgmCount; ++i)
         {
-            nns::audio::WavFormat format;
-            std::size_t dataSize = ReadWavFile(&format, &ppDataBuffer[i], g_BgmFileNames[i]);
-            nn::audio::AcquireVoiceSlot(&config, &pOutVoices[i], format.sampleRate, format.channelCount, nn::audio::SampleFormat_PcmInt16, nn::audio::VoiceType::PriorityHighest, nullptr, 0);
-            nn::audio::SetVoicePlayState(&pOutVoices[i], nn::audio::VoiceType::PlayState_Play);
-
-            pOutWaveBuffers[i].buffer = ppDataBuffer[i];
-            pOutWaveBuffers[i].size = dataSize;
-            pOutWaveBuffers[i].startSampleOffset = 0;
-            pOutWaveBuffers[i].endSampleOffset = static_cast<int32_t>(dataSize / sizeof(int16_t)) / format.channelCount;
-            pOutWaveBuffers[i].loop = true;
-            pOutWaveBuffers[i].isEndOfStream = false;
-            pOutWaveBuffers[i].pContext = nullptr;
-            pOutWaveBuffers[i].contextSize = 0;
-            nn::audio::AppendWaveBuffer(&pOutVoices[i], &pOutWaveBuffers[i]);
+            ppWaveBuffers[i] = g_WaveBufferAllocator.Allocate(waveBufferSize, nn::audio::BufferAlignSize);
+            NN_ABORT_UNLESS_NOT_NULL(ppWaveBuffers[i]);
+            ppWorkBuffers[i] = g_Allocator.Allocate(workBufferSize, nn::os::ThreadStackAlignment);
+            NN_ABORT_UNLESS_NOT_NULL(ppWorkBuffers[i]);
+            pOutVoices[i].Initialize(&config, g_BgmFileNames[i], true, ppWaveBuffers[i], waveBufferSize, ppWorkBuffers[i], workBufferSize);
         }
     }
 
-    void SetupSeVoices(
-        nn::audio::VoiceType* pOutVoices,
-        nn::audio::AdpcmHeaderInfo** pOutHeaders,
-        nn::audio::WaveBuffer* pOutWaveBuffers,
+    // Loads the sound effects. The voices to play them come from a VoiceManager.
+    void SetupSeSources(
+        VoiceSource* pOutSources,
         void** pOutDataBuffer,
-        nn::audio::AudioRendererConfig config)
+        SeBank* pBank)
     {
+        // One read for every sound effect, into one region of the pool.
+        const bool isBankLoaded = pBank->Load(g_SeBankFileName, &g_WaveBufferAllocator).IsSuccess();
+        if (!isBankLoaded)
+        {
+            NNS_LOG("%s could not be loaded, loading the sound effects one by one.\n", g_SeBankFileName);
+        }
+
         for (int i = 0; i < SeCount; ++i)
         {
-            pOutHeaders[i] = reinterpret_cast<nn::audio::AdpcmHeaderInfo*>(g_WaveBufferAllocator.Allocate(sizeof(nn::audio::AdpcmHeaderInfo), NN_ALIGNOF(nn::audio::AdpcmHeaderInfo)));
-            std::size_t dataSeSize = ReadAdpcmFile(pOutHeaders[i], &pOutDataBuffer[i], g_SeFileNames[i]);
-            nn::audio::AcquireVoiceSlot(&config, &pOutVoices[i], pOutHeaders[i]->sampleRate, 1, nn::audio::SampleFormat_Adpcm, nn::audio::VoiceType::PriorityHighest, &pOutHeaders[i]->parameter, sizeof(nn::audio::AdpcmParameter));
-            nn::audio::SetVoicePlayState(&pOutVoices[i], nn::audio::VoiceType::PlayState_Play);
-
-            pOutWaveBuffers[i].buffer = pOutDataBuffer[i];
-            pOutWaveBuffers[i].size = dataSeSize;
-            pOutWaveBuffers[i].startSampleOffset = 0;
-            pOutWaveBuffers[i].endSampleOffset = pOutHeaders[i]->sampleCount;
-            pOutWaveBuffers[i].loop = false;
-            pOutWaveBuffers[i].isEndOfStream = false;
-            pOutWaveBuffers[i].pContext = &pOutHeaders[i]->loopContext;
-            pOutWaveBuffers[i].contextSize = sizeof(nn::audio::AdpcmContext);
-            nn::audio::AppendWaveBuffer(&pOutVoices[i], &pOutWaveBuffers[i]);
+            if (isBankLoaded)
+            {
+                const int index = pBank->Find(g_SeNames[i]);
+                NN_ABORT_UNLESS(index != SeBank::InvalidIndex, "%s is not in the bank.", g_SeNames[i]);
+                pOutSources[i].pHeader = pBank->GetHeader(index);
+                pOutSources[i].pData = pBank->GetData(index);
+                pOutSources[i].dataSize = pBank->GetDataSize(index);
+                pOutDataBuffer[i] = nullptr;
+            }
+            else
+            {
+                pOutSources[i].pHeader = reinterpret_cast<nn::audio::AdpcmHeaderInfo*>(g_WaveBufferAllocator.Allocate(sizeof(nn::audio::AdpcmHeaderInfo), NN_ALIGNOF(nn::audio::AdpcmHeaderInfo)));
+                pOutSources[i].dataSize = ReadAdpcmFile(pOutSources[i].pHeader, &pOutDataBuffer[i], g_SeFileNames[i]);
+                pOutSources[i].pData = pOutDataBuffer[i];
+            }
         }
     }
 
@@ -519,34 +590,34 @@ namespace AUS {
         NN_ABORT_UNLESS(nn::audio::AcquireMemoryPool(&config, &waveBufferMemoryPool, g_WaveBufferPoolMemory, sizeof(g_WaveBufferPoolMemory)));
         NN_ABORT_UNLESS(nn::audio::RequestAttachMemoryPool(&waveBufferMemoryPool));
 
-        nn::audio::VoiceType voiceBgm[BgmCount];
-        nn::audio::WaveBuffer waveBufferBgm[BgmCount];
+        StreamingVoice voiceBgm[BgmCount];
         void* dataBgm[BgmCount];
-        SetupBgmVoices(voiceBgm, waveBufferBgm, dataBgm, config);
+        void* workBufferBgm[BgmCount];
+        SetupBgmVoices(voiceBgm, dataBgm, workBufferBgm, config);
 
         // Specifies finalMix as the output destination for BGM, and Left and Right as the output channels.
         for (auto i = 0; i < BgmCount; ++i)
         {
-            nn::audio::SetVoiceDestination(&config, &voiceBgm[i], &finalMix);
-            nn::audio::SetVoiceMixVolume(&voiceBgm[i], &finalMix, 0.5f, 0, mainBus[nn::audio::ChannelMapping_FrontLeft]);
-            nn::audio::SetVoiceMixVolume(&voiceBgm[i], &finalMix, 0.5f, 1, mainBus[nn::audio::ChannelMapping_FrontRight]);
+            nn::audio::SetVoiceDestination(&config, voiceBgm[i].GetVoice(), &finalMix);
+            nn::audio::SetVoiceMixVolume(voiceBgm[i].GetVoice(), &finalMix, 0.5f, 0, mainBus[nn::audio::ChannelMapping_FrontLeft]);
+            nn::audio::SetVoiceMixVolume(voiceBgm[i].GetVoice(), &finalMix, 0.5f, 1, mainBus[nn::audio::ChannelMapping_FrontRight]);
         }
 
-        nn::audio::VoiceType voiceSe[SeCount];
-        nn::audio::WaveBuffer waveBufferSe[SeCount];
-        nn::audio::AdpcmHeaderInfo* header[SeCount];
+        VoiceSource sourceSe[SeCount];
         void* dataSe[SeCount];
-        SetupSeVoices(voiceSe, header, waveBufferSe, dataSe, config);
+        SeBank seBank;
+        SetupSeSources(sourceSe, dataSe, &seBank);
 
         // Specifies finalMix as the output destination for the sound effects, and distributes the separate sound effects to the output channels Center, Lfe, RearLeft, and RearRight.
-        for (auto i = 0; i < SeCount; ++i)
+        VoiceManager voiceManager(SeSoundCountMax, SeVoiceCount);
+        voiceManager.Initialize(&config, &finalMix);
+        const int seBus[SeCount] =
         {
-            nn::audio::SetVoiceDestination(&config, &voiceSe[i], &finalMix);
-        }
-        nn::audio::SetVoiceMixVolume(&voiceSe[0], &finalMix, 0.707f, 0, mainBus[nn::audio::ChannelMapping_FrontCenter]);
-        nn::audio::SetVoiceMixVolume(&voiceSe[1], &finalMix, 0.707f, 0, mainBus[nn::audio::ChannelMapping_LowFrequency]);
-        nn::audio::SetVoiceMixVolume(&voiceSe[2], &finalMix, 0.707f, 0, mainBus[nn::audio::ChannelMapping_RearLeft]);
-        nn::audio::SetVoiceMixVolume(&voiceSe[3], &finalMix, 0.707f, 0, mainBus[nn::audio::ChannelMapping_RearRight]);
+            mainBus[nn::audio::ChannelMapping_FrontCenter],
+            mainBus[nn::audio::ChannelMapping_LowFrequency],
+            mainBus[nn::audio::ChannelMapping_RearLeft],
+            mainBus[nn::audio::ChannelMapping_RearRight],
+        };
 
 
         //////////////////////////////////////////////////////////////////////////
@@ -593,7 +664,7 @@ namespace AUS {
         // For more information about downmixing, see the Downmix Processing section in the documentation for the @confluencelink{166500119, Audio Library.}
         //
         // As an extreme example of this sample program, the downmix parameters are set to cut all channels other than FrontLeft and FrontRight.
-        // A bit up in the code, voiceBgm was assigned to FrontLeft and FrontRight, and voiceSe was assigned to the other channels,
+        // A bit up in the code, voiceBgm was assigned to FrontLeft and FrontRight, and the sound effects were assigned to the other channels,
         // so when application-specific downmixing is enabled the SE sounds will all be cut.
         //////////////////////////////////////////////////////////////////////////
         nn::audio::DeviceSinkType::DownMixParameter downMixParam;
@@ -605,10 +676,16 @@ namespace AUS {
         nn::audio::SetDownMixParameterEnabled(&deviceSink, false);
 
 
+        // Times every renderer frame: when the loop wakes and when the update goes in. An
+        // update later than one frame after its wake means the renderer played stale parameters.
+        AUS::AudioTelemetry telemetry;
+        telemetry.Initialize(RenderRate, RenderCount);
+
         PrintUsage();
         for (;;)
         {
             systemEvent.Wait();
+            telemetry.RecordWake();
             auto buttonDown = GetButtonDown();
             const auto PlusKeyMask =
                 nn::hid::NpadButton::Up::Mask |
@@ -673,14 +750,12 @@ namespace AUS {
             }
 
 
+            // Every press starts a new sound, even while the last one plays.
             for (int i = 0; i < SeCount; ++i)
             {
                 if (buttonDown.Test(i))
                 {
-                    if (nn::audio::GetReleasedWaveBuffer(&voiceSe[i]))
-                    {
-                        nn::audio::AppendWaveBuffer(&voiceSe[i], &waveBufferSe[i]);
-                    }
+                    voiceManager.Play(&sourceSe[i], seBus[i], 0, 0.707f, false);
                 }
             }
 
@@ -694,10 +769,28 @@ namespace AUS {
                 PrintUsage();
             }
 
+            if (buttonDown.Test< ::nn::hid::NpadButton::R >())
+            {
+                PrintAudioTelemetry(telemetry);
+            }
+
+            // Queue the BGM chunks the loader threads have read since the last frame.
+            for (int i = 0; i < BgmCount; ++i)
+            {
+                voiceBgm[i].Update();
+            }
+            voiceManager.Update();
+
             NN_ABORT_UNLESS(nn::audio::RequestUpdateAudioRenderer(handle, &config).IsSuccess());
+            telemetry.RecordUpdate();
         }
 
         // End rendering.
+        for (int i = 0; i < BgmCount; ++i)
+        {
+            voiceBgm[i].Finalize();
+        }
+        voiceManager.Finalize();
         nn::audio::StopAudioRenderer(handle);
         nn::audio::CloseAudioRenderer(handle);
         nn::os::DestroySystemEvent(systemEvent.GetBase());
@@ -710,6 +803,11 @@ namespace AUS {
                 g_WaveBufferAllocator.Free(dataBgm[i]);
                 dataBgm[i] = nullptr;
             }
+            if (workBufferBgm[i])
+            {
+                g_Allocator.Free(workBufferBgm[i]);
+                workBufferBgm[i] = nullptr;
+            }
         }
         for (int i = 0; i < SeCount; ++i)
         {
@@ -717,10 +815,11 @@ namespace AUS {
             {
                 g_WaveBufferAllocator.Free(dataSe[i]);
                 dataSe[i] = nullptr;
-                g_WaveBufferAllocator.Free(header[i]);
-                header[i] = nullptr;
+                g_WaveBufferAllocator.Free(sourceSe[i].pHeader);
+                sourceSe[i].pHeader = nullptr;
             }
         }
+        seBank.Unload();
         if (configBuffer)
         {
             g_Allocator.Free(configBuffer);
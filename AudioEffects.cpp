@@ -0,0 +1,658 @@
+#include "AudioEffects.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    namespace {
+
+        using SimdUtil::Vec;
+
+        const float Pi = 3.14159265358979323846f;
+
+        // Frame offsets of the lanes, for gains that glide across a vector.
+        alignas(SimdUtil::Alignment) const float LaneOffsets[SimdUtil::MaxLaneCount] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+        // Kept off zero so decaying feedback never reaches denormals, which are slow on x86.
+        const float AntiDenormal = 1e-18f;
+
+        float DecibelsToGain(float decibels)
+        {
+            return std::pow(10.0f, decibels * 0.05f);
+        }
+
+        int MilliSecondsToFrames(int sampleRate, float milliSeconds)
+        {
+            return static_cast<int>(milliSeconds * 0.001f * sampleRate + 0.5f);
+        }
+
+        float GetPeak(const float* pSamples, int count)
+        {
+            const Vec zero = SimdUtil::Set(0.0f);
+            Vec peak = zero;
+            int i = 0;
+            for (; i + SimdUtil::LaneCount <= count; i += SimdUtil::LaneCount)
+            {
+                const Vec v = SimdUtil::LoadUnaligned(pSamples + i);
+                peak = SimdUtil::Max(peak, SimdUtil::Max(v, SimdUtil::Sub(zero, v)));
+            }
+            alignas(SimdUtil::Alignment) float lanes[SimdUtil::MaxLaneCount];
+            SimdUtil::Store(lanes, peak);
+            float result = 0.0f;
+            for (int lane = 0; lane < SimdUtil::LaneCount; ++lane)
+            {
+                result = std::max(result, lanes[lane]);
+            }
+            for (; i < count; ++i)
+            {
+                result = std::max(result, std::fabs(pSamples[i]));
+            }
+            return result;
+        }
+
+        // pOut[i] = pIn[i] * (start + step * (i + 1)).
+        void ApplyGainRamp(float* pOut, const float* pIn, int count, float start, float step)
+        {
+            const Vec stepVec = SimdUtil::Set(step);
+            const Vec laneCount = SimdUtil::Set(static_cast<float>(SimdUtil::LaneCount));
+            Vec frame = SimdUtil::Add(SimdUtil::Load(LaneOffsets), SimdUtil::Set(1.0f));
+            const Vec startVec = SimdUtil::Set(start);
+            int i = 0;
+            for (; i + SimdUtil::LaneCount <= count; i += SimdUtil::LaneCount)
+            {
+                const Vec gain = SimdUtil::Add(startVec, SimdUtil::Mul(stepVec, frame));
+                SimdUtil::StoreUnaligned(pOut + i, SimdUtil::Mul(SimdUtil::LoadUnaligned(pIn + i), gain));
+                frame = SimdUtil::Add(frame, laneCount);
+            }
+            for (; i < count; ++i)
+            {
+                pOut[i] = pIn[i] * (start + step * static_cast<float>(i + 1));
+            }
+        }
+
+        bool IsPrime(int value)
+        {
+            for (int divisor = 2; divisor * divisor <= value; ++divisor)
+            {
+                if (value % divisor == 0)
+                {
+                    return false;
+                }
+            }
+            return value > 1;
+        }
+
+    }
+
+    //
+    // Equalizer
+    //
+
+    Equalizer::Equalizer(int sampleRate)
+        : m_SampleRate(sampleRate)
+    {
+        assert(sampleRate > 0);
+        for (int band = 0; band < BandCountMax; ++band)
+        {
+            m_Bands[band].current = MakeFlat();
+            m_Bands[band].target = MakeFlat();
+            m_Bands[band].isFlat = true;
+        }
+        Reset();
+    }
+
+    Equalizer::Coefficients Equalizer::MakeFlat()
+    {
+        const Coefficients flat = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        return flat;
+    }
+
+    void Equalizer::SetBand(int band, BiquadType type, float frequency, float q, float gainDb)
+    {
+        assert(0 <= band && band < BandCountMax);
+        assert(0.0f < frequency && frequency < 0.5f * m_SampleRate);
+        assert(q > 0.0f);
+
+        const float w0 = 2.0f * Pi * frequency / m_SampleRate;
+        const float cosW0 = std::cos(w0);
+        const float alpha = std::sin(w0) / (2.0f * q);
+        const float a = std::pow(10.0f, gainDb / 40.0f);
+        const float shelf = 2.0f * std::sqrt(a) * alpha;
+
+        float b0, b1, b2, a0, a1, a2;
+        switch (type)
+        {
+        case BiquadType_LowPass:
+            b0 = (1.0f - cosW0) * 0.5f;
+            b1 = 1.0f - cosW0;
+            b2 = b0;
+            a0 = 1.0f + alpha;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha;
+            break;
+        case BiquadType_HighPass:
+            b0 = (1.0f + cosW0) * 0.5f;
+            b1 = -(1.0f + cosW0);
+            b2 = b0;
+            a0 = 1.0f + alpha;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha;
+            break;
+        case BiquadType_Peak:
+            b0 = 1.0f + alpha * a;
+            b1 = -2.0f * cosW0;
+            b2 = 1.0f - alpha * a;
+            a0 = 1.0f + alpha / a;
+            a1 = -2.0f * cosW0;
+            a2 = 1.0f - alpha / a;
+            break;
+        case BiquadType_LowShelf:
+            b0 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 + shelf);
+            b1 = 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cosW0);
+            b2 = a * ((a + 1.0f) - (a - 1.0f) * cosW0 - shelf);
+            a0 = (a + 1.0f) + (a - 1.0f) * cosW0 + shelf;
+            a1 = -2.0f * ((a - 1.0f) + (a + 1.0f) * cosW0);
+            a2 = (a + 1.0f) + (a - 1.0f) * cosW0 - shelf;
+            break;
+        case BiquadType_HighShelf:
+            b0 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 + shelf);
+            b1 = -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cosW0);
+            b2 = a * ((a + 1.0f) + (a - 1.0f) * cosW0 - shelf);
+            a0 = (a + 1.0f) - (a - 1.0f) * cosW0 + shelf;
+            a1 = 2.0f * ((a - 1.0f) - (a + 1.0f) * cosW0);
+            a2 = (a + 1.0f) - (a - 1.0f) * cosW0 - shelf;
+            break;
+        default:
+            assert(false);
+            return;
+        }
+
+        Band& target = m_Bands[band];
+        target.target.b0 = b0 / a0;
+        target.target.b1 = b1 / a0;
+        target.target.b2 = b2 / a0;
+        target.target.a1 = a1 / a0;
+        target.target.a2 = a2 / a0;
+        target.isFlat = false;
+    }
+
+    void Equalizer::ClearBand(int band)
+    {
+        assert(0 <= band && band < BandCountMax);
+        // Glide to flat first, Process marks the band flat once it gets there.
+        m_Bands[band].target = MakeFlat();
+        m_Bands[band].isFlat = false;
+    }
+
+    void Equalizer::Reset()
+    {
+        for (int band = 0; band < BandCountMax; ++band)
+        {
+            Band& b = m_Bands[band];
+            b.current = b.target;
+            for (int ch = 0; ch < EffectChannelCount; ++ch)
+            {
+                b.z1[ch] = 0.0f;
+                b.z2[ch] = 0.0f;
+            }
+        }
+    }
+
+    void Equalizer::Process(float* const* pChannels, int frameCount)
+    {
+        assert(pChannels != nullptr);
+        assert(0 < frameCount && frameCount <= EffectFrameCountMax);
+
+        const Coefficients flat = MakeFlat();
+        for (int band = 0; band < BandCountMax; ++band)
+        {
+            Band& b = m_Bands[band];
+            if (b.isFlat)
+            {
+                continue;
+            }
+
+            // Glide from the current coefficients to the target over this block.
+            const Coefficients start = b.current;
+            const float scale = 1.0f / frameCount;
+            const Coefficients step =
+            {
+                (b.target.b0 - start.b0) * scale,
+                (b.target.b1 - start.b1) * scale,
+                (b.target.b2 - start.b2) * scale,
+                (b.target.a1 - start.a1) * scale,
+                (b.target.a2 - start.a2) * scale,
+            };
+            const bool isGliding = step.b0 != 0.0f || step.b1 != 0.0f || step.b2 != 0.0f || step.a1 != 0.0f || step.a2 != 0.0f;
+
+            for (int ch = 0; ch < EffectChannelCount; ++ch)
+            {
+                float* pSamples = pChannels[ch];
+                float z1 = b.z1[ch];
+                float z2 = b.z2[ch];
+                if (isGliding)
+                {
+                    Coefficients c = start;
+                    for (int i = 0; i < frameCount; ++i)
+                    {
+                        c.b0 += step.b0;
+                        c.b1 += step.b1;
+                        c.b2 += step.b2;
+                        c.a1 += step.a1;
+                        c.a2 += step.a2;
+                        const float x = pSamples[i];
+                        const float y = c.b0 * x + z1;
+                        z1 = c.b1 * x - c.a1 * y + z2;
+                        z2 = c.b2 * x - c.a2 * y;
+                        pSamples[i] = y;
+                    }
+                }
+                else
+                {
+                    const Coefficients c = start;
+                    for (int i = 0; i < frameCount; ++i)
+                    {
+                        const float x = pSamples[i];
+                        const float y = c.b0 * x + z1;
+                        z1 = c.b1 * x - c.a1 * y + z2;
+                        z2 = c.b2 * x - c.a2 * y;
+                        pSamples[i] = y;
+                    }
+                }
+                // A silent input lets the state decay towards denormals.
+                b.z1[ch] = std::fabs(z1) < AntiDenormal ? 0.0f : z1;
+                b.z2[ch] = std::fabs(z2) < AntiDenormal ? 0.0f : z2;
+            }
+            b.current = b.target;
+
+            if (std::memcmp(&b.current, &flat, sizeof(flat)) == 0)
+            {
+                b.isFlat = true;
+                for (int ch = 0; ch < EffectChannelCount; ++ch)
+                {
+                    b.z1[ch] = 0.0f;
+                    b.z2[ch] = 0.0f;
+                }
+            }
+        }
+    }
+
+    //
+    // Compressor
+    //
+
+    Compressor::Compressor(int sampleRate)
+        : m_SampleRate(sampleRate)
+        , m_Threshold(-12.0f)
+        , m_Slope(0.75f)
+        , m_AttackMilliSeconds(5.0f)
+        , m_ReleaseMilliSeconds(100.0f)
+        , m_Makeup(0.0f)
+    {
+        assert(sampleRate > 0);
+        Reset();
+    }
+
+    void Compressor::SetThreshold(float thresholdDb)
+    {
+        m_Threshold = thresholdDb;
+    }
+
+    void Compressor::SetRatio(float ratio)
+    {
+        assert(ratio >= 1.0f);
+        m_Slope = 1.0f - 1.0f / ratio;
+    }
+
+    void Compressor::SetAttack(float milliSeconds)
+    {
+        assert(milliSeconds >= 0.0f);
+        m_AttackMilliSeconds = milliSeconds;
+    }
+
+    void Compressor::SetRelease(float milliSeconds)
+    {
+        assert(milliSeconds >= 0.0f);
+        m_ReleaseMilliSeconds = milliSeconds;
+    }
+
+    void Compressor::SetMakeupGain(float gainDb)
+    {
+        m_Makeup = gainDb;
+    }
+
+    void Compressor::Reset()
+    {
+        m_Reduction = 0.0f;
+        m_ChunkGain = DecibelsToGain(m_Makeup);
+        m_AppliedGain = m_ChunkGain;
+        std::memset(m_Lookahead, 0, sizeof(m_Lookahead));
+    }
+
+    float Compressor::GetChunkCoefficient(float milliSeconds, int frameCount) const
+    {
+        // How much of the old value is left after frameCount frames of a one pole smoother.
+        const float timeFrameCount = milliSeconds * 0.001f * m_SampleRate;
+        return timeFrameCount < 1.0f ? 0.0f : std::exp(-static_cast<float>(frameCount) / timeFrameCount);
+    }
+
+    void Compressor::Process(float* const* pChannels, int frameCount)
+    {
+        assert(pChannels != nullptr);
+        assert(0 < frameCount && frameCount <= EffectFrameCountMax);
+
+        for (int offset = 0; offset < frameCount; offset += LookaheadFrameCount)
+        {
+            const int count = std::min(LookaheadFrameCount, frameCount - offset);
+
+            // The level of the chunk that just came in decides the gain of the one that plays.
+            float peak = 0.0f;
+            for (int ch = 0; ch < EffectChannelCount; ++ch)
+            {
+                const float* pIn = pChannels[ch] + offset;
+                std::memcpy(m_Lookahead[ch] + LookaheadFrameCount, pIn, sizeof(float) * count);
+                peak = std::max(peak, GetPeak(pIn, count));
+            }
+            const float level = 20.0f * std::log10(std::max(peak, 1e-9f));
+            const float over = level - m_Threshold;
+            const float reduction = over > 0.0f ? over * m_Slope : 0.0f;
+            const float coefficient = GetChunkCoefficient(reduction > m_Reduction ? m_AttackMilliSeconds : m_ReleaseMilliSeconds, count);
+            m_Reduction = reduction + (m_Reduction - reduction) * coefficient;
+
+            // Never more than the gain of the chunk playing now asked for, so its peaks stay under.
+            const float chunkGain = DecibelsToGain(m_Makeup - m_Reduction);
+            const float gain = std::min(chunkGain, m_ChunkGain);
+            const float step = (gain - m_AppliedGain) / count;
+            for (int ch = 0; ch < EffectChannelCount; ++ch)
+            {
+                ApplyGainRamp(pChannels[ch] + offset, m_Lookahead[ch], count, m_AppliedGain, step);
+                std::memmove(m_Lookahead[ch], m_Lookahead[ch] + count, sizeof(float) * LookaheadFrameCount);
+            }
+            m_ChunkGain = chunkGain;
+            m_AppliedGain = gain;
+        }
+    }
+
+    //
+    // Delay
+    //
+
+    Delay::Delay(int sampleRate, float maxDelayMilliSeconds)
+        : m_SampleRate(sampleRate)
+        , m_WritePosition(0)
+        , m_Feedback(0.0f)
+        , m_TargetFeedback(0.0f)
+        , m_Mix(0.0f)
+        , m_TargetMix(0.0f)
+    {
+        assert(sampleRate > 0);
+        assert(maxDelayMilliSeconds > 0.0f);
+        m_Length = std::max(1, MilliSecondsToFrames(sampleRate, maxDelayMilliSeconds)) + 1;
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            m_pBuffers[ch] = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * m_Length));
+            assert(m_pBuffers[ch] != nullptr);
+        }
+        m_DelayFrameCount = m_Length - 1;
+        m_TargetDelayFrameCount = m_DelayFrameCount;
+        Reset();
+    }
+
+    Delay::~Delay()
+    {
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            SimdUtil::AlignedFree(m_pBuffers[ch]);
+        }
+    }
+
+    void Delay::SetDelay(float milliSeconds)
+    {
+        m_TargetDelayFrameCount = std::min(std::max(1, MilliSecondsToFrames(m_SampleRate, milliSeconds)), m_Length - 1);
+    }
+
+    void Delay::SetFeedback(float feedback)
+    {
+        assert(0.0f <= feedback && feedback < 1.0f);
+        m_TargetFeedback = feedback;
+    }
+
+    void Delay::SetMix(float mix)
+    {
+        m_TargetMix = mix;
+    }
+
+    void Delay::Reset()
+    {
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            std::memset(m_pBuffers[ch], 0, sizeof(float) * m_Length);
+        }
+        m_DelayFrameCount = m_TargetDelayFrameCount;
+        m_Feedback = m_TargetFeedback;
+        m_Mix = m_TargetMix;
+    }
+
+    void Delay::Process(float* const* pChannels, int frameCount)
+    {
+        assert(pChannels != nullptr);
+        assert(0 < frameCount && frameCount <= EffectFrameCountMax);
+
+        // Everything glides over the block: the fade from the old tap to the new one, the
+        // feedback and the mix. Frame i of the block is at (i + 1) / frameCount of the way.
+        const int oldDelay = m_DelayFrameCount;
+        const int newDelay = m_TargetDelayFrameCount;
+        const float scale = 1.0f / frameCount;
+        const float fadeStep = oldDelay != newDelay ? scale : 0.0f;
+        const float feedbackStep = (m_TargetFeedback - m_Feedback) * scale;
+        const float mixStep = (m_TargetMix - m_Mix) * scale;
+        const Vec laneOffsets = SimdUtil::Load(LaneOffsets);
+
+        int writePosition = m_WritePosition;
+        for (int offset = 0; offset < frameCount;)
+        {
+            const int oldRead = (writePosition - oldDelay + m_Length) % m_Length;
+            const int newRead = (writePosition - newDelay + m_Length) % m_Length;
+            // A run must not wrap the ring, nor read frames it writes itself.
+            int count = frameCount - offset;
+            count = std::min(count, m_Length - writePosition);
+            count = std::min(count, std::min(m_Length - oldRead, m_Length - newRead));
+            count = std::min(count, std::min(oldDelay, newDelay));
+
+            for (int ch = 0; ch < EffectChannelCount; ++ch)
+            {
+                float* pSamples = pChannels[ch] + offset;
+                float* pWrite = m_pBuffers[ch] + writePosition;
+                const float* pOld = m_pBuffers[ch] + oldRead;
+                const float* pNew = m_pBuffers[ch] + newRead;
+
+                int i = 0;
+                for (; i + SimdUtil::LaneCount <= count; i += SimdUtil::LaneCount)
+                {
+                    const Vec frame = SimdUtil::Add(laneOffsets, SimdUtil::Set(static_cast<float>(offset + i + 1)));
+                    const Vec fade = SimdUtil::Mul(frame, SimdUtil::Set(fadeStep));
+                    const Vec feedback = SimdUtil::Add(SimdUtil::Set(m_Feedback), SimdUtil::Mul(frame, SimdUtil::Set(feedbackStep)));
+                    const Vec mix = SimdUtil::Add(SimdUtil::Set(m_Mix), SimdUtil::Mul(frame, SimdUtil::Set(mixStep)));
+                    const Vec oldTap = SimdUtil::LoadUnaligned(pOld + i);
+                    const Vec tap = SimdUtil::Add(oldTap, SimdUtil::Mul(SimdUtil::Sub(SimdUtil::LoadUnaligned(pNew + i), oldTap), fade));
+                    const Vec input = SimdUtil::LoadUnaligned(pSamples + i);
+                    SimdUtil::StoreUnaligned(pWrite + i, SimdUtil::Add(input, SimdUtil::Mul(feedback, tap)));
+                    SimdUtil::StoreUnaligned(pSamples + i, SimdUtil::Add(input, SimdUtil::Mul(mix, tap)));
+                }
+                for (; i < count; ++i)
+                {
+                    const float frame = static_cast<float>(offset + i + 1);
+                    const float tap = pOld[i] + (pNew[i] - pOld[i]) * (frame * fadeStep);
+                    const float input = pSamples[i];
+                    pWrite[i] = input + (m_Feedback + frame * feedbackStep) * tap;
+                    pSamples[i] = input + (m_Mix + frame * mixStep) * tap;
+                }
+            }
+
+            offset += count;
+            writePosition = (writePosition + count) % m_Length;
+        }
+
+        m_WritePosition = writePosition;
+        m_DelayFrameCount = newDelay;
+        m_Feedback = m_TargetFeedback;
+        m_Mix = m_TargetMix;
+    }
+
+    //
+    // Reverb
+    //
+
+    namespace {
+
+        // Line lengths of a medium room at 48000 Hz, all prime.
+        const int ReverbLineLengths[Reverb::LineCount] = { 1031, 1129, 1237, 1361, 1483, 1601, 1733, 1867 };
+        // The dry signal enters every line with alternating signs.
+        alignas(SimdUtil::Alignment) const float ReverbInputSigns[Reverb::LineCount] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+        alignas(SimdUtil::Alignment) const float ReverbLeftTaps[Reverb::LineCount] = { 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f };
+        alignas(SimdUtil::Alignment) const float ReverbRightTaps[Reverb::LineCount] = { 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, -1.0f };
+        const float ReverbInputGain = 0.25f;
+        const float ReverbOutputGain = 0.5f;
+
+        static_assert(Reverb::LineCount % SimdUtil::MaxLaneCount == 0, "The lines must fill whole vectors");
+
+    }
+
+    Reverb::Reverb(int sampleRate, float roomSize)
+        : m_SampleRate(sampleRate)
+        , m_Mix(0.3f)
+        , m_TargetMix(0.3f)
+    {
+        assert(sampleRate > 0);
+        assert(0.0f <= roomSize && roomSize <= 1.0f);
+
+        const float scale = (0.5f + roomSize) * sampleRate / 48000.0f;
+        int totalLength = 0;
+        for (int line = 0; line < LineCount; ++line)
+        {
+            int length = std::max(2, static_cast<int>(ReverbLineLengths[line] * scale));
+            while (!IsPrime(length))
+            {
+                ++length;
+            }
+            m_Lengths[line] = length;
+            totalLength += length;
+        }
+        m_pMemory = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * totalLength));
+        assert(m_pMemory != nullptr);
+        float* pLine = m_pMemory;
+        for (int line = 0; line < LineCount; ++line)
+        {
+            m_pLines[line] = pLine;
+            pLine += m_Lengths[line];
+        }
+
+        SetDecayTime(1.5f);
+        SetDamping(0.5f);
+        Reset();
+    }
+
+    Reverb::~Reverb()
+    {
+        SimdUtil::AlignedFree(m_pMemory);
+    }
+
+    void Reverb::SetDecayTime(float seconds)
+    {
+        assert(seconds > 0.0f);
+        // A line loses 60 dB over seconds, in as many trips as fit.
+        for (int line = 0; line < LineCount; ++line)
+        {
+            m_LineGains[line] = std::pow(10.0f, -3.0f * m_Lengths[line] / (seconds * m_SampleRate));
+        }
+    }
+
+    void Reverb::SetDamping(float damping)
+    {
+        assert(0.0f <= damping && damping <= 1.0f);
+        m_FilterCoefficient = 1.0f - 0.9f * damping;
+    }
+
+    void Reverb::SetMix(float mix)
+    {
+        assert(0.0f <= mix && mix <= 1.0f);
+        m_TargetMix = mix;
+    }
+
+    void Reverb::Reset()
+    {
+        int totalLength = 0;
+        for (int line = 0; line < LineCount; ++line)
+        {
+            totalLength += m_Lengths[line];
+            m_Positions[line] = 0;
+            m_Filters[line] = 0.0f;
+        }
+        std::memset(m_pMemory, 0, sizeof(float) * totalLength);
+        m_Mix = m_TargetMix;
+    }
+
+    void Reverb::Process(float* const* pChannels, int frameCount)
+    {
+        assert(pChannels != nullptr);
+        assert(0 < frameCount && frameCount <= EffectFrameCountMax);
+
+        float* pLeft = pChannels[0];
+        float* pRight = pChannels[1];
+        const float mixStep = (m_TargetMix - m_Mix) / frameCount;
+        const Vec filterCoefficient = SimdUtil::Set(m_FilterCoefficient);
+        const Vec householder = SimdUtil::Set(-2.0f / LineCount);
+
+        alignas(SimdUtil::Alignment) float taps[LineCount];
+        alignas(SimdUtil::Alignment) float feedback[LineCount];
+        for (int i = 0; i < frameCount; ++i)
+        {
+            for (int line = 0; line < LineCount; ++line)
+            {
+                taps[line] = m_pLines[line][m_Positions[line]];
+            }
+
+            // Damp and attenuate every line, and sum them for the Householder reflection.
+            Vec sum = SimdUtil::Set(0.0f);
+            Vec left = sum;
+            Vec right = sum;
+            for (int line = 0; line < LineCount; line += SimdUtil::LaneCount)
+            {
+                Vec filter = SimdUtil::LoadUnaligned(m_Filters + line);
+                filter = SimdUtil::Add(filter, SimdUtil::Mul(filterCoefficient, SimdUtil::Sub(SimdUtil::Load(taps + line), filter)));
+                SimdUtil::StoreUnaligned(m_Filters + line, filter);
+                const Vec damped = SimdUtil::Mul(filter, SimdUtil::LoadUnaligned(m_LineGains + line));
+                SimdUtil::Store(feedback + line, damped);
+                sum = SimdUtil::Add(sum, damped);
+                left = SimdUtil::Add(left, SimdUtil::Mul(filter, SimdUtil::Load(ReverbLeftTaps + line)));
+                right = SimdUtil::Add(right, SimdUtil::Mul(filter, SimdUtil::Load(ReverbRightTaps + line)));
+            }
+
+            const Vec reflection = SimdUtil::Mul(householder, SimdUtil::Set(SimdUtil::Sum(sum)));
+            const Vec input = SimdUtil::Set((pLeft[i] + pRight[i]) * ReverbInputGain + AntiDenormal);
+            for (int line = 0; line < LineCount; line += SimdUtil::LaneCount)
+            {
+                const Vec mixed = SimdUtil::Add(SimdUtil::Load(feedback + line), reflection);
+                SimdUtil::Store(feedback + line, SimdUtil::Add(mixed, SimdUtil::Mul(input, SimdUtil::Load(ReverbInputSigns + line))));
+            }
+            for (int line = 0; line < LineCount; ++line)
+            {
+                m_pLines[line][m_Positions[line]] = feedback[line];
+                m_Positions[line] = m_Positions[line] + 1 == m_Lengths[line] ? 0 : m_Positions[line] + 1;
+            }
+
+            const float mix = m_Mix + mixStep * static_cast<float>(i + 1);
+            const float wetLeft = SimdUtil::Sum(left) * ReverbOutputGain;
+            const float wetRight = SimdUtil::Sum(right) * ReverbOutputGain;
+            pLeft[i] += (wetLeft - pLeft[i]) * mix;
+            pRight[i] += (wetRight - pRight[i]) * mix;
+        }
+        m_Mix = m_TargetMix;
+    }
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace AUS {
+
+    // The effects work on blocks of planar stereo: pChannels[0] is left, pChannels[1] right, and
+    // each holds frameCount floats. Blocks are at most EffectFrameCountMax frames. Every effect
+    // allocates its state up front, takes parameter changes between blocks and glides to them
+    // within the next one, so nothing clicks. None of them is thread safe.
+    const int EffectChannelCount = 2;
+    const int EffectFrameCountMax = 256;
+
+    enum BiquadType
+    {
+        BiquadType_LowPass,
+        BiquadType_HighPass,
+        BiquadType_Peak,
+        BiquadType_LowShelf,
+        BiquadType_HighShelf
+    };
+
+    // A parametric equalizer of up to BandCountMax biquad bands, from the RBJ cookbook.
+    //
+    // A biquad is a recursion along time, so each channel runs a scalar transposed direct form II
+    // loop. A band that changes glides its coefficients over the next block; a band that was
+    // never set or was cleared costs nothing.
+    class Equalizer
+    {
+    public:
+        static const int BandCountMax = 4;
+
+        explicit Equalizer(int sampleRate);
+
+        // gainDb only shapes the peak and shelf types.
+        void SetBand(int band, BiquadType type, float frequency, float q, float gainDb);
+        // Returns the band to a flat response.
+        void ClearBand(int band);
+        void Reset();
+        void Process(float* const* pChannels, int frameCount);
+
+    private:
+        struct Coefficients
+        {
+            float b0;
+            float b1;
+            float b2;
+            float a1;
+            float a2;
+        };
+
+        struct Band
+        {
+            Coefficients current;
+            Coefficients target;
+            bool isFlat; // current and target both pass the signal untouched.
+            float z1[EffectChannelCount];
+            float z2[EffectChannelCount];
+        };
+
+        static Coefficients MakeFlat();
+
+        int m_SampleRate;
+        Band m_Bands[BandCountMax];
+    };
+
+    // A stereo linked peak compressor, a limiter when the ratio is high and the attack 0.
+    //
+    // The level is taken per chunk of LookaheadFrameCount frames with a SIMD peak search, and
+    // the gain glides across each chunk in a SIMD loop. The signal is delayed by one chunk, so
+    // a gain drop is complete before the peak that caused it plays: with a 0 attack no frame
+    // exceeds the threshold, as long as blocks are whole chunks.
+    class Compressor
+    {
+    public:
+        static const int LookaheadFrameCount = 16;
+
+        explicit Compressor(int sampleRate);
+
+        void SetThreshold(float thresholdDb);
+        // 1 leaves the signal alone, 20 or more behaves as a limiter.
+        void SetRatio(float ratio);
+        void SetAttack(float milliSeconds);
+        void SetRelease(float milliSeconds);
+        void SetMakeupGain(float gainDb);
+        // The gain reduction now, in dB, for a meter.
+        float GetGainReduction() const { return m_Reduction; }
+
+        void Reset();
+        void Process(float* const* pChannels, int frameCount);
+
+    private:
+        float GetChunkCoefficient(float milliSeconds, int frameCount) const;
+
+        int m_SampleRate;
+        float m_Threshold;
+        float m_Slope; // 1 - 1 / ratio.
+        float m_AttackMilliSeconds;
+        float m_ReleaseMilliSeconds;
+        float m_Makeup;
+        float m_Reduction;    // Smoothed gain reduction in dB.
+        float m_ChunkGain;    // Gain the last chunk asked for.
+        float m_AppliedGain;  // Gain at the end of the last chunk played.
+        // The chunk of each channel waiting to play, then room for the next one.
+        float m_Lookahead[EffectChannelCount][LookaheadFrameCount * 2];
+    };
+
+    // A feedback echo. The delay time can move while it plays: the old and new taps cross
+    // fade over the next block instead of jumping.
+    //
+    // The work goes in runs that neither wrap the ring nor reach the frames they write, so each
+    // run is one SIMD loop even with feedback.
+    class Delay
+    {
+    public:
+        Delay(int sampleRate, float maxDelayMilliSeconds);
+        ~Delay();
+
+        void SetDelay(float milliSeconds);
+        // Share of the echo fed back, below 1.
+        void SetFeedback(float feedback);
+        // Level of the echo added to the dry signal.
+        void SetMix(float mix);
+        void Reset();
+        void Process(float* const* pChannels, int frameCount);
+
+    private:
+        Delay(const Delay&);
+        Delay& operator=(const Delay&);
+
+        int m_SampleRate;
+        int m_Length; // Ring length per channel.
+        float* m_pBuffers[EffectChannelCount];
+        int m_WritePosition;
+        int m_DelayFrameCount;
+        int m_TargetDelayFrameCount;
+        float m_Feedback;
+        float m_TargetFeedback;
+        float m_Mix;
+        float m_TargetMix;
+    };
+
+    // A feedback delay network reverb of LineCount delay lines.
+    //
+    // Every line is a ring of a prime length, damped by a one pole low pass and mixed back
+    // into all the others through a Householder matrix, which only needs the sum of the lines.
+    // Each frame works on all the lines at once as SIMD vectors; the left output takes the
+    // even lines and the right the odd ones, so the tails are decorrelated.
+    class Reverb
+    {
+    public:
+        static const int LineCount = 8;
+
+        // roomSize runs from 0, a small room, to 1, a hall. It sets the line lengths for good.
+        Reverb(int sampleRate, float roomSize);
+        ~Reverb();
+
+        // Time for the tail to fall by 60 dB.
+        void SetDecayTime(float seconds);
+        // 0 keeps the highs, 1 darkens the tail quickly.
+        void SetDamping(float damping);
+        // Share of the output that is reverb.
+        void SetMix(float mix);
+        void Reset();
+        void Process(float* const* pChannels, int frameCount);
+
+    private:
+        Reverb(const Reverb&);
+        Reverb& operator=(const Reverb&);
+
+        int m_SampleRate;
+        float* m_pMemory;
+        float* m_pLines[LineCount];
+        int m_Lengths[LineCount];
+        int m_Positions[LineCount];
+        float m_Mix;
+        float m_TargetMix;
+        float m_LineGains[LineCount];
+        float m_Filters[LineCount]; // One pole low pass state of each line.
+        float m_FilterCoefficient;
+    };
+
+}
@@ -0,0 +1,363 @@
+#include "AudioOutFeeder.h"
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Assert.h>
+#include <nn/util/util_BitUtil.h>
+#include <nn/util/util_BytePtr.h>
+
+namespace AUS {
+
+    namespace {
+
+        // Measurement windows without trouble before the queue gets one buffer shorter.
+        const int CalmWindowCountToShrink = 3;
+
+        size_t GetBufferStride(size_t dataSize)
+        {
+            const size_t bufferSize = nn::util::align_up(dataSize, nn::audio::AudioOutBuffer::SizeGranularity);
+            return nn::util::align_up(bufferSize, nn::audio::AudioOutBuffer::AddressAlignment);
+        }
+
+        int GetBufferSampleCount(const AudioOutLatencySettings& settings, int sampleRate)
+        {
+            return sampleRate * settings.bufferMilliseconds / 1000;
+        }
+
+    }
+
+    AudioOutLatencySettings MakeAudioOutLatencySettings(AudioOutLatencyMode mode)
+    {
+        AudioOutLatencySettings settings;
+        switch (mode)
+        {
+        case AudioOutLatencyMode_Low:
+            settings.bufferMilliseconds = 5;
+            settings.bufferCountMin = 2;
+            settings.bufferCountMax = 12;
+            settings.bufferCountInitial = 3;
+            settings.isAdaptive = true;
+            break;
+        case AudioOutLatencyMode_Balanced:
+            settings.bufferMilliseconds = 10;
+            settings.bufferCountMin = 2;
+            settings.bufferCountMax = 8;
+            settings.bufferCountInitial = 4;
+            settings.isAdaptive = true;
+            break;
+        case AudioOutLatencyMode_Safe:
+            settings.bufferMilliseconds = 50;
+            settings.bufferCountMin = 4;
+            settings.bufferCountMax = 4;
+            settings.bufferCountInitial = 4;
+            settings.isAdaptive = false;
+            break;
+        default:
+            NN_UNEXPECTED_DEFAULT;
+        }
+        return settings;
+    }
+
+    AudioOutFeeder::AudioOutFeeder()
+        : m_pAudioOut(nullptr)
+        , m_pBufferEvent(nullptr)
+        , m_FillFunction(nullptr)
+        , m_CommandFunction(nullptr)
+        , m_pUserArg(nullptr)
+        , m_DataSize(0)
+        , m_BufferSampleCount(0)
+        , m_BufferMicroSeconds(0)
+        , m_IdleCount(0)
+        , m_QueuedCount(0)
+        , m_QueueDepth(0)
+        , m_WindowLength(1)
+        , m_IsFirstRefill(true)
+        , m_WindowLatenessMax(0)
+        , m_WindowRefillCount(0)
+        , m_WindowHasUnderrun(false)
+        , m_CalmWindowCount(0)
+        , m_IsInitialized(false)
+        , m_IsExiting(false)
+        , m_StatQueueDepth(0)
+        , m_StatJitterMicroSeconds(0)
+        , m_StatUnderrunCount(0)
+        , m_StatRefillCount(0)
+    {
+    }
+
+    AudioOutFeeder::~AudioOutFeeder()
+    {
+        NN_ASSERT(!m_IsInitialized);
+    }
+
+    size_t AudioOutFeeder::GetRequiredWorkBufferSize(const AudioOutLatencySettings& settings,
+        int sampleRate, int channelCount, nn::audio::SampleFormat format)
+    {
+        NN_ASSERT(0 < settings.bufferCountMax && settings.bufferCountMax <= BufferCountMax);
+        const size_t dataSize = GetBufferSampleCount(settings, sampleRate) * channelCount * nn::audio::GetSampleByteSize(format);
+        return nn::util::align_up(StackSize, nn::audio::AudioOutBuffer::AddressAlignment)
+            + GetBufferStride(dataSize) * settings.bufferCountMax;
+    }
+
+    void AudioOutFeeder::Initialize(nn::audio::AudioOut* pAudioOut, nn::os::SystemEvent* pBufferEvent,
+        const AudioOutLatencySettings& settings,
+        FillFunction fillFunction, CommandFunction commandFunction, void* pUserArg,
+        int coreNumber, void* pWorkBuffer, size_t workBufferSize)
+    {
+        NN_ASSERT(!m_IsInitialized);
+        NN_ASSERT_NOT_NULL(pAudioOut);
+        NN_ASSERT_NOT_NULL(pBufferEvent);
+        NN_ASSERT_NOT_NULL(fillFunction);
+        NN_ASSERT(settings.bufferMilliseconds > 0);
+        NN_ASSERT(1 <= settings.bufferCountMin && settings.bufferCountMin <= settings.bufferCountInitial);
+        NN_ASSERT(settings.bufferCountInitial <= settings.bufferCountMax && settings.bufferCountMax <= BufferCountMax);
+        NN_ASSERT((reinterpret_cast<uintptr_t>(pWorkBuffer) % nn::os::ThreadStackAlignment) == 0);
+
+        const int sampleRate = nn::audio::GetAudioOutSampleRate(pAudioOut);
+        const int channelCount = nn::audio::GetAudioOutChannelCount(pAudioOut);
+        const nn::audio::SampleFormat format = nn::audio::GetAudioOutSampleFormat(pAudioOut);
+        NN_ASSERT(workBufferSize >= GetRequiredWorkBufferSize(settings, sampleRate, channelCount, format));
+        NN_UNUSED(workBufferSize);
+
+        m_pAudioOut = pAudioOut;
+        m_pBufferEvent = pBufferEvent;
+        m_Settings = settings;
+        m_FillFunction = fillFunction;
+        m_CommandFunction = commandFunction;
+        m_pUserArg = pUserArg;
+        m_IsExiting.store(false);
+
+        m_BufferSampleCount = GetBufferSampleCount(settings, sampleRate);
+        m_BufferMicroSeconds = static_cast<int64_t>(m_BufferSampleCount) * 1000000 / sampleRate;
+        m_DataSize = m_BufferSampleCount * channelCount * nn::audio::GetSampleByteSize(format);
+        m_QueueDepth = settings.bufferCountInitial;
+        m_WindowLength = 1000 / settings.bufferMilliseconds > 1 ? 1000 / settings.bufferMilliseconds : 1;
+        m_WindowLatenessMax = 0;
+        m_WindowRefillCount = 0;
+        m_WindowHasUnderrun = false;
+        m_CalmWindowCount = 0;
+        m_StatQueueDepth.store(m_QueueDepth);
+        m_StatJitterMicroSeconds.store(0);
+        m_StatUnderrunCount.store(0);
+        m_StatRefillCount.store(0);
+        m_Telemetry.Initialize(sampleRate, m_BufferSampleCount);
+
+        // The stack comes first, then one buffer per possible queue slot.
+        void* pStack = pWorkBuffer;
+        nn::util::BytePtr pData(pWorkBuffer, nn::util::align_up(StackSize, nn::audio::AudioOutBuffer::AddressAlignment));
+        const size_t stride = GetBufferStride(m_DataSize);
+        const size_t bufferSize = nn::util::align_up(m_DataSize, nn::audio::AudioOutBuffer::SizeGranularity);
+        m_IdleCount = 0;
+        for (int i = settings.bufferCountMax - 1; i >= 0; --i)
+        {
+            nn::audio::SetAudioOutBufferInfo(&m_Buffers[i], pData.Get(), bufferSize, m_DataSize);
+            pData.Advance(stride);
+            m_IdleBuffers[m_IdleCount++] = i;
+        }
+        m_QueuedCount = 0;
+        AppendIdleBuffers();
+
+        // The thread wakes for a released buffer, a command or the exit request.
+        nn::os::InitializeEvent(&m_WakeEvent, false, nn::os::EventClearMode_AutoClear);
+        nn::os::InitializeMultiWait(&m_MultiWait);
+        nn::os::InitializeMultiWaitHolder(&m_BufferHolder, m_pBufferEvent->GetBase());
+        nn::os::InitializeMultiWaitHolder(&m_WakeHolder, &m_WakeEvent);
+        nn::os::LinkMultiWaitHolder(&m_MultiWait, &m_BufferHolder);
+        nn::os::LinkMultiWaitHolder(&m_MultiWait, &m_WakeHolder);
+
+        m_IsFirstRefill = true;
+        nn::Result result = nn::os::CreateThread(&m_Thread, ThreadMain, this, pStack, StackSize, ThreadPriority, coreNumber);
+        NN_ABORT_UNLESS(result.IsSuccess(), "Cannot create the audio feeder thread.");
+        nn::os::SetThreadName(&m_Thread, "AudioOutFeeder");
+        nn::os::StartThread(&m_Thread);
+        m_IsInitialized = true;
+    }
+
+    void AudioOutFeeder::Finalize()
+    {
+        if (!m_IsInitialized)
+        {
+            return;
+        }
+
+        m_IsExiting.store(true, std::memory_order_release);
+        nn::os::SignalEvent(&m_WakeEvent);
+        nn::os::WaitThread(&m_Thread);
+        nn::os::DestroyThread(&m_Thread);
+
+        nn::os::UnlinkMultiWaitHolder(&m_BufferHolder);
+        nn::os::UnlinkMultiWaitHolder(&m_WakeHolder);
+        nn::os::FinalizeMultiWaitHolder(&m_BufferHolder);
+        nn::os::FinalizeMultiWaitHolder(&m_WakeHolder);
+        nn::os::FinalizeMultiWait(&m_MultiWait);
+        nn::os::FinalizeEvent(&m_WakeEvent);
+        m_IsInitialized = false;
+    }
+
+    bool AudioOutFeeder::SendCommand(const AudioCommand& command)
+    {
+        NN_ASSERT(m_IsInitialized);
+        if (!m_Commands.Push(command))
+        {
+            return false;
+        }
+        nn::os::SignalEvent(&m_WakeEvent);
+        return true;
+    }
+
+    AudioOutStats AudioOutFeeder::GetStats() const
+    {
+        AudioOutStats stats;
+        stats.bufferSampleCount = m_BufferSampleCount;
+        stats.queueDepth = m_StatQueueDepth.load(std::memory_order_relaxed);
+        stats.latencyMicroSeconds = static_cast<int>(stats.queueDepth * m_BufferMicroSeconds);
+        stats.jitterMicroSeconds = m_StatJitterMicroSeconds.load(std::memory_order_relaxed);
+        stats.underrunCount = m_StatUnderrunCount.load(std::memory_order_relaxed);
+        stats.refillCount = m_StatRefillCount.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void AudioOutFeeder::ThreadMain(void* pArg)
+    {
+        static_cast<AudioOutFeeder*>(pArg)->Run();
+    }
+
+    void AudioOutFeeder::Run()
+    {
+        for (;;)
+        {
+            nn::os::MultiWaitHolderType* pHolder = nn::os::WaitAny(&m_MultiWait);
+            if (pHolder == &m_BufferHolder)
+            {
+                m_pBufferEvent->Clear();
+            }
+            else
+            {
+                nn::os::ClearEvent(&m_WakeEvent);
+            }
+            if (m_IsExiting.load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            ApplyCommands();
+            Refill();
+        }
+    }
+
+    void AudioOutFeeder::ApplyCommands()
+    {
+        AudioCommand command;
+        while (m_Commands.Pop(&command))
+        {
+            if (m_CommandFunction != nullptr)
+            {
+                m_CommandFunction(command, m_pUserArg);
+            }
+        }
+    }
+
+    void AudioOutFeeder::Refill()
+    {
+        int releasedCount = 0;
+        nn::audio::AudioOutBuffer* pBuffer = nn::audio::GetReleasedAudioOutBuffer(m_pAudioOut);
+        while (pBuffer)
+        {
+            if (releasedCount == 0)
+            {
+                m_Telemetry.RecordWake();
+            }
+            m_Telemetry.RecordRelease();
+            m_IdleBuffers[m_IdleCount++] = static_cast<int>(pBuffer - m_Buffers);
+            --m_QueuedCount;
+            ++releasedCount;
+            pBuffer = nn::audio::GetReleasedAudioOutBuffer(m_pAudioOut);
+        }
+        if (releasedCount == 0)
+        {
+            // Woken for a command only.
+            return;
+        }
+
+        // Every buffer came back before this refill, so the output had nothing left to play.
+        const bool isUnderrun = m_QueuedCount == 0;
+        if (isUnderrun)
+        {
+            m_StatUnderrunCount.fetch_add(1, std::memory_order_relaxed);
+            m_Telemetry.RecordUnderrun();
+        }
+
+        // How much later than one buffer period after the previous refill this one runs.
+        // The first refill has no previous one, the wait for StartAudioOut is not lateness.
+        const nn::os::Tick now = nn::os::GetSystemTick();
+        const int64_t interval = m_IsFirstRefill ? 0 : nn::os::ConvertToTimeSpan(now - m_LastRefillTick).GetMicroSeconds();
+        m_LastRefillTick = now;
+        m_IsFirstRefill = false;
+        Adapt(interval > m_BufferMicroSeconds ? interval - m_BufferMicroSeconds : 0, isUnderrun);
+
+        AppendIdleBuffers();
+    }
+
+    void AudioOutFeeder::AppendIdleBuffers()
+    {
+        // A shallower queue leaves the surplus buffers idle.
+        while (m_QueuedCount < m_QueueDepth && m_IdleCount > 0)
+        {
+            nn::audio::AudioOutBuffer* pBuffer = &m_Buffers[m_IdleBuffers[--m_IdleCount]];
+            m_FillFunction(nn::audio::GetAudioOutBufferDataPointer(pBuffer), m_DataSize, m_pUserArg);
+            nn::audio::AppendAudioOutBuffer(m_pAudioOut, pBuffer);
+            ++m_QueuedCount;
+            m_StatRefillCount.fetch_add(1, std::memory_order_relaxed);
+            m_Telemetry.RecordAppend(m_QueuedCount * m_BufferSampleCount);
+        }
+    }
+
+    void AudioOutFeeder::Adapt(int64_t latenessMicroSeconds, bool isUnderrun)
+    {
+        m_WindowLatenessMax = latenessMicroSeconds > m_WindowLatenessMax ? latenessMicroSeconds : m_WindowLatenessMax;
+        m_WindowHasUnderrun = m_WindowHasUnderrun || isUnderrun;
+
+        // An underrun grows the queue at once, everything else waits for the end of the window.
+        if (m_Settings.isAdaptive && isUnderrun && m_QueueDepth < m_Settings.bufferCountMax)
+        {
+            ++m_QueueDepth;
+            m_CalmWindowCount = 0;
+        }
+
+        if (++m_WindowRefillCount < m_WindowLength)
+        {
+            m_StatQueueDepth.store(m_QueueDepth, std::memory_order_relaxed);
+            return;
+        }
+
+        if (m_Settings.isAdaptive)
+        {
+            // The buffer playing, the one queued behind it and one more per period of the worst lateness.
+            const int64_t latePeriods = (m_WindowLatenessMax + m_BufferMicroSeconds - 1) / m_BufferMicroSeconds;
+            const int required = 2 + static_cast<int>(latePeriods);
+            if (required > m_QueueDepth)
+            {
+                m_QueueDepth = required < m_Settings.bufferCountMax ? required : m_Settings.bufferCountMax;
+                m_CalmWindowCount = 0;
+            }
+            else if (required < m_QueueDepth && !m_WindowHasUnderrun)
+            {
+                if (++m_CalmWindowCount >= CalmWindowCountToShrink && m_QueueDepth > m_Settings.bufferCountMin)
+                {
+                    --m_QueueDepth;
+                    m_CalmWindowCount = 0;
+                }
+            }
+            else
+            {
+                m_CalmWindowCount = 0;
+            }
+        }
+
+        m_StatQueueDepth.store(m_QueueDepth, std::memory_order_relaxed);
+        m_StatJitterMicroSeconds.store(static_cast<int>(m_WindowLatenessMax), std::memory_order_relaxed);
+        m_WindowLatenessMax = 0;
+        m_WindowRefillCount = 0;
+        m_WindowHasUnderrun = false;
+    }
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include <nn/os.h>
+#include <nn/audio.h>
+
+#include "AudioTelemetry.h"
+#include "SpscRing.h"
+
+namespace AUS {
+
+    enum AudioCommandType
+    {
+        AudioCommandType_SetWaveform,
+        AudioCommandType_SetFrequency,
+        AudioCommandType_SetAmplitude,
+        AudioCommandType_SetGain,
+        AudioCommandType_SetPan,
+        AudioCommandType_SetEffectEnabled
+    };
+
+    // A command from the game thread to the audio thread. value is the new waveform,
+    // frequency or amplitude of an oscillator voice, or the new gain or pan of a mixer voice.
+    // To switch an effect, voice is its slot in the effect chain and value is 1 for on, 0 for off.
+    struct AudioCommand
+    {
+        AudioCommandType type;
+        int voice;
+        float value;
+    };
+
+    enum AudioOutLatencyMode
+    {
+        AudioOutLatencyMode_Low,      // 5 ms buffers, for responsive sound effects.
+        AudioOutLatencyMode_Balanced, // 10 ms buffers.
+        AudioOutLatencyMode_Safe      // 50 ms buffers in a fixed queue of four, about 200 ms.
+    };
+
+    // How much audio the feeder keeps queued. The queue depth starts at bufferCountInitial and,
+    // when isAdaptive is set, moves between bufferCountMin and bufferCountMax with the measured
+    // refill jitter and underruns.
+    struct AudioOutLatencySettings
+    {
+        int bufferMilliseconds;
+        int bufferCountMin;
+        int bufferCountMax;
+        int bufferCountInitial;
+        bool isAdaptive;
+    };
+
+    AudioOutLatencySettings MakeAudioOutLatencySettings(AudioOutLatencyMode mode);
+
+    struct AudioOutStats
+    {
+        int bufferSampleCount;   // Frames per buffer.
+        int queueDepth;          // Buffers the feeder keeps appended.
+        int latencyMicroSeconds; // Audio queued at that depth.
+        int jitterMicroSeconds;  // Worst refill lateness past one buffer period, over the last window.
+        int underrunCount;       // Times the queue ran dry before a refill.
+        int refillCount;         // Buffers filled since Initialize.
+    };
+
+    // Refills an AudioOut from a thread of its own.
+    //
+    // The thread sleeps on the buffer event of the AudioOut and refills every released buffer
+    // as soon as it comes back, so playback does not depend on the render thread keeping up.
+    // The game thread talks to it through a lock-free command ring; the commands are applied
+    // on the audio thread right before the next refill, so the fill callback owns its state alone.
+    //
+    // The feeder owns the AudioOut buffers. It only appends as many as the current queue depth,
+    // the rest wait idle until the depth grows.
+    class AudioOutFeeder
+    {
+    public:
+        // Fills dataSize bytes of a buffer.
+        typedef void (*FillFunction)(void* pBuffer, size_t dataSize, void* pUserArg);
+        typedef void (*CommandFunction)(const AudioCommand& command, void* pUserArg);
+
+        static const int BufferCountMax = 16;
+        static const int CommandCountMax = 64;
+        static const size_t StackSize = 16 * 1024;
+        // Above the render thread, so a long frame never delays a refill.
+        static const int ThreadPriority = nn::os::DefaultThreadPriority - 2;
+
+        AudioOutFeeder();
+        ~AudioOutFeeder();
+
+        // The work buffer holds the thread stack and the audio buffers.
+        // It must be aligned to nn::os::ThreadStackAlignment.
+        static size_t GetRequiredWorkBufferSize(const AudioOutLatencySettings& settings,
+            int sampleRate, int channelCount, nn::audio::SampleFormat format);
+
+        // Fills and appends the first bufferCountInitial buffers, then starts the thread on coreNumber.
+        // Start the AudioOut afterwards.
+        void Initialize(nn::audio::AudioOut* pAudioOut, nn::os::SystemEvent* pBufferEvent,
+            const AudioOutLatencySettings& settings,
+            FillFunction fillFunction, CommandFunction commandFunction, void* pUserArg,
+            int coreNumber, void* pWorkBuffer, size_t workBufferSize);
+        void Finalize();
+
+        // Only call from one thread. Returns false when the ring is full.
+        bool SendCommand(const AudioCommand& command);
+
+        // Safe to call from any thread, the fields are read one by one.
+        AudioOutStats GetStats() const;
+        // Every wake, release, append and underrun of the feeder thread, timed. Safe to read
+        // from any thread.
+        const AudioTelemetry& GetTelemetry() const { return m_Telemetry; }
+        const AudioOutLatencySettings& GetSettings() const { return m_Settings; }
+
+    private:
+        AudioOutFeeder(const AudioOutFeeder&);
+        AudioOutFeeder& operator=(const AudioOutFeeder&);
+
+        static void ThreadMain(void* pArg);
+        void Run();
+        void ApplyCommands();
+        void Refill();
+        void AppendIdleBuffers();
+        void Adapt(int64_t latenessMicroSeconds, bool isUnderrun);
+
+        nn::audio::AudioOut* m_pAudioOut;
+        nn::os::SystemEvent* m_pBufferEvent;
+        AudioOutLatencySettings m_Settings;
+        FillFunction m_FillFunction;
+        CommandFunction m_CommandFunction;
+        void* m_pUserArg;
+
+        nn::audio::AudioOutBuffer m_Buffers[BufferCountMax];
+        size_t m_DataSize;
+        int m_BufferSampleCount;
+        int64_t m_BufferMicroSeconds;
+        int m_IdleBuffers[BufferCountMax];
+        int m_IdleCount;
+        int m_QueuedCount;
+
+        // Adaptation state, audio thread only.
+        int m_QueueDepth;
+        int m_WindowLength; // Refills per measurement window, about one second.
+        nn::os::Tick m_LastRefillTick;
+        bool m_IsFirstRefill;
+        int64_t m_WindowLatenessMax;
+        int m_WindowRefillCount;
+        bool m_WindowHasUnderrun;
+        int m_CalmWindowCount;
+
+        nn::os::ThreadType m_Thread;
+        nn::os::EventType m_WakeEvent;
+        nn::os::MultiWaitType m_MultiWait;
+        nn::os::MultiWaitHolderType m_BufferHolder;
+        nn::os::MultiWaitHolderType m_WakeHolder;
+        bool m_IsInitialized;
+        std::atomic<bool> m_IsExiting;
+
+        // Stats the audio thread publishes.
+        std::atomic<int> m_StatQueueDepth;
+        std::atomic<int> m_StatJitterMicroSeconds;
+        std::atomic<int> m_StatUnderrunCount;
+        std::atomic<int> m_StatRefillCount;
+        AudioTelemetry m_Telemetry;
+
+        SpscRing<AudioCommand, CommandCountMax> m_Commands;
+    };
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace AUS {
+
+    // A packed little endian 24-bit sample, the layout of nn::audio::SampleFormat_PcmInt24.
+    struct PcmInt24
+    {
+        uint8_t bytes[3];
+    };
+
+    // Conversions between normalized float samples in [-1, 1] and the PCM sample types.
+    // FromFloat saturates, so mixing headroom never wraps around.
+    // Every conversion is branch free apart from the clamps, so loops over them vectorize.
+    template <typename SampleT>
+    struct SampleTraits;
+
+    template <>
+    struct SampleTraits<int8_t>
+    {
+        static const int ByteSize = 1;
+
+        static int8_t FromFloat(float value)
+        {
+            float scaled = value * 128.0f;
+            scaled = scaled < -128.0f ? -128.0f : (scaled > 127.0f ? 127.0f : scaled);
+            return static_cast<int8_t>(scaled);
+        }
+
+        static float ToFloat(int8_t sample)
+        {
+            return static_cast<float>(sample) * (1.0f / 128.0f);
+        }
+    };
+
+    template <>
+    struct SampleTraits<int16_t>
+    {
+        static const int ByteSize = 2;
+
+        static int16_t FromFloat(float value)
+        {
+            float scaled = value * 32768.0f;
+            scaled = scaled < -32768.0f ? -32768.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+            return static_cast<int16_t>(scaled);
+        }
+
+        static float ToFloat(int16_t sample)
+        {
+            return static_cast<float>(sample) * (1.0f / 32768.0f);
+        }
+    };
+
+    template <>
+    struct SampleTraits<PcmInt24>
+    {
+        static const int ByteSize = 3;
+
+        static PcmInt24 FromFloat(float value)
+        {
+            float scaled = value * 8388608.0f;
+            scaled = scaled < -8388608.0f ? -8388608.0f : (scaled > 8388607.0f ? 8388607.0f : scaled);
+            return FromInt32(static_cast<int32_t>(scaled));
+        }
+
+        static float ToFloat(PcmInt24 sample)
+        {
+            return static_cast<float>(ToInt32(sample)) * (1.0f / 8388608.0f);
+        }
+
+        static PcmInt24 FromInt32(int32_t value)
+        {
+            PcmInt24 sample;
+            sample.bytes[0] = static_cast<uint8_t>(value);
+            sample.bytes[1] = static_cast<uint8_t>(value >> 8);
+            sample.bytes[2] = static_cast<uint8_t>(value >> 16);
+            return sample;
+        }
+
+        // Sign extends the 24-bit value.
+        static int32_t ToInt32(PcmInt24 sample)
+        {
+            uint32_t bits = static_cast<uint32_t>(sample.bytes[0])
+                | (static_cast<uint32_t>(sample.bytes[1]) << 8)
+                | (static_cast<uint32_t>(sample.bytes[2]) << 16);
+            return static_cast<int32_t>(bits << 8) >> 8;
+        }
+    };
+
+    template <>
+    struct SampleTraits<int32_t>
+    {
+        static const int ByteSize = 4;
+
+        static int32_t FromFloat(float value)
+        {
+            // 2^31 - 1 is not a float, anything from 2^31 on is clamped through the comparison.
+            float scaled = value * 2147483648.0f;
+            if (scaled >= 2147483648.0f)
+            {
+                return INT32_MAX;
+            }
+            scaled = scaled < -2147483648.0f ? -2147483648.0f : scaled;
+            return static_cast<int32_t>(scaled);
+        }
+
+        static float ToFloat(int32_t sample)
+        {
+            return static_cast<float>(sample) * (1.0f / 2147483648.0f);
+        }
+    };
+
+    template <>
+    struct SampleTraits<float>
+    {
+        static const int ByteSize = 4;
+
+        static float FromFloat(float value)
+        {
+            return value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+        }
+
+        static float ToFloat(float sample)
+        {
+            return sample;
+        }
+    };
+
+    static_assert(sizeof(PcmInt24) == 3, "PcmInt24 must be packed");
+
+}
@@ -0,0 +1,220 @@
+#include "AudioTelemetry.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+
+namespace AUS {
+
+    AudioTelemetry::AudioTelemetry()
+        : m_SampleRate(1)
+        , m_PeriodMicroSeconds(1)
+        , m_LatencyBinMicroSeconds(1)
+        , m_JitterBinMicroSeconds(1)
+        , m_StartTime(0)
+        , m_LastWakeTime(-1)
+        , m_WakeCount(0)
+        , m_LateWakeCount(0)
+        , m_UnderrunCount(0)
+        , m_QueuedFrameCount(0)
+        , m_PeakQueuedFrameCount(0)
+        , m_LastLatencyMicroSeconds(0)
+        , m_PeakLatencyMicroSeconds(0)
+        , m_LastJitterMicroSeconds(0)
+        , m_PeakJitterMicroSeconds(0)
+        , m_EventCount(0)
+    {
+        Initialize(1, 1);
+    }
+
+    void AudioTelemetry::Initialize(int sampleRate, int periodFrameCount)
+    {
+        assert(sampleRate > 0);
+        assert(periodFrameCount > 0);
+
+        m_SampleRate = sampleRate;
+        m_PeriodMicroSeconds = std::max(1, static_cast<int>(static_cast<int64_t>(periodFrameCount) * 1000000 / sampleRate));
+
+        // Latency spans eight periods, deeper than any queue the feeder starts with, and jitter
+        // spans two, where a wake is late enough to have missed a whole period.
+        m_LatencyBinMicroSeconds = std::max(1, m_PeriodMicroSeconds / 4);
+        m_JitterBinMicroSeconds = std::max(1, m_PeriodMicroSeconds / 16);
+        for (int i = 0; i < AudioHistogramBinCount; ++i)
+        {
+            m_LatencyCounts[i].store(0, std::memory_order_relaxed);
+            m_JitterCounts[i].store(0, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < EventCountMax; ++i)
+        {
+            m_Events[i].timeMicroSeconds.store(0, std::memory_order_relaxed);
+            m_Events[i].type.store(AudioEventType_Wake, std::memory_order_relaxed);
+            m_Events[i].queuedFrameCount.store(0, std::memory_order_relaxed);
+        }
+        m_StartTime = GetTime();
+        m_LastWakeTime = -1;
+        m_WakeCount.store(0, std::memory_order_relaxed);
+        m_LateWakeCount.store(0, std::memory_order_relaxed);
+        m_UnderrunCount.store(0, std::memory_order_relaxed);
+        m_QueuedFrameCount.store(0, std::memory_order_relaxed);
+        m_PeakQueuedFrameCount.store(0, std::memory_order_relaxed);
+        m_LastLatencyMicroSeconds.store(0, std::memory_order_relaxed);
+        m_PeakLatencyMicroSeconds.store(0, std::memory_order_relaxed);
+        m_LastJitterMicroSeconds.store(0, std::memory_order_relaxed);
+        m_PeakJitterMicroSeconds.store(0, std::memory_order_relaxed);
+        m_EventCount.store(0, std::memory_order_relaxed);
+    }
+
+    void AudioTelemetry::RecordWake()
+    {
+        const int64_t now = GetTime();
+        PushEvent(now, AudioEventType_Wake, 0);
+        m_WakeCount.store(m_WakeCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        // The first wake has no previous one to be late against.
+        if (m_LastWakeTime >= 0)
+        {
+            const int64_t interval = now - m_LastWakeTime;
+            const int jitter = static_cast<int>(std::min<int64_t>(std::abs(interval - m_PeriodMicroSeconds), INT32_MAX));
+            if (interval - m_PeriodMicroSeconds >= m_PeriodMicroSeconds / 2)
+            {
+                m_LateWakeCount.store(m_LateWakeCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            AddToHistogram(m_JitterCounts, m_JitterBinMicroSeconds, jitter);
+            m_LastJitterMicroSeconds.store(jitter, std::memory_order_relaxed);
+            if (jitter > m_PeakJitterMicroSeconds.load(std::memory_order_relaxed))
+            {
+                m_PeakJitterMicroSeconds.store(jitter, std::memory_order_relaxed);
+            }
+        }
+        m_LastWakeTime = now;
+    }
+
+    void AudioTelemetry::RecordRelease()
+    {
+        PushEvent(GetTime(), AudioEventType_Release, 0);
+    }
+
+    void AudioTelemetry::RecordAppend(int queuedFrameCount)
+    {
+        assert(queuedFrameCount >= 0);
+        PushEvent(GetTime(), AudioEventType_Append, queuedFrameCount);
+        m_QueuedFrameCount.store(queuedFrameCount, std::memory_order_relaxed);
+        if (queuedFrameCount > m_PeakQueuedFrameCount.load(std::memory_order_relaxed))
+        {
+            m_PeakQueuedFrameCount.store(queuedFrameCount, std::memory_order_relaxed);
+        }
+        RecordLatency(static_cast<int>(static_cast<int64_t>(queuedFrameCount) * 1000000 / m_SampleRate));
+    }
+
+    void AudioTelemetry::RecordUpdate()
+    {
+        const int64_t now = GetTime();
+        PushEvent(now, AudioEventType_Update, 0);
+        if (m_LastWakeTime >= 0)
+        {
+            RecordLatency(static_cast<int>(now - m_LastWakeTime));
+        }
+    }
+
+    void AudioTelemetry::RecordUnderrun()
+    {
+        PushEvent(GetTime(), AudioEventType_Underrun, 0);
+        m_UnderrunCount.store(m_UnderrunCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void AudioTelemetry::RecordLatency(int latencyMicroSeconds)
+    {
+        AddToHistogram(m_LatencyCounts, m_LatencyBinMicroSeconds, latencyMicroSeconds);
+        m_LastLatencyMicroSeconds.store(latencyMicroSeconds, std::memory_order_relaxed);
+        if (latencyMicroSeconds > m_PeakLatencyMicroSeconds.load(std::memory_order_relaxed))
+        {
+            m_PeakLatencyMicroSeconds.store(latencyMicroSeconds, std::memory_order_relaxed);
+        }
+    }
+
+    AudioTelemetryStats AudioTelemetry::GetStats() const
+    {
+        AudioTelemetryStats stats;
+        stats.periodMicroSeconds = m_PeriodMicroSeconds;
+        stats.wakeCount = m_WakeCount.load(std::memory_order_relaxed);
+        stats.lateWakeCount = m_LateWakeCount.load(std::memory_order_relaxed);
+        stats.underrunCount = m_UnderrunCount.load(std::memory_order_relaxed);
+        stats.queuedFrameCount = m_QueuedFrameCount.load(std::memory_order_relaxed);
+        stats.peakQueuedFrameCount = m_PeakQueuedFrameCount.load(std::memory_order_relaxed);
+        stats.lastLatencyMicroSeconds = m_LastLatencyMicroSeconds.load(std::memory_order_relaxed);
+        stats.peakLatencyMicroSeconds = m_PeakLatencyMicroSeconds.load(std::memory_order_relaxed);
+        stats.lastJitterMicroSeconds = m_LastJitterMicroSeconds.load(std::memory_order_relaxed);
+        stats.peakJitterMicroSeconds = m_PeakJitterMicroSeconds.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void AudioTelemetry::GetLatencyHistogram(AudioHistogram* pOutHistogram) const
+    {
+        CopyHistogram(pOutHistogram, m_LatencyCounts, m_LatencyBinMicroSeconds);
+    }
+
+    void AudioTelemetry::GetJitterHistogram(AudioHistogram* pOutHistogram) const
+    {
+        CopyHistogram(pOutHistogram, m_JitterCounts, m_JitterBinMicroSeconds);
+    }
+
+    int AudioTelemetry::GetEvents(AudioEvent* pOutEvents, int countMax) const
+    {
+        assert(pOutEvents != nullptr);
+        assert(countMax >= 0);
+
+        const int64_t end = m_EventCount.load(std::memory_order_acquire);
+        const int64_t begin = std::max<int64_t>(0, end - std::min(countMax, static_cast<int>(EventCountMax)));
+        for (int64_t i = begin; i < end; ++i)
+        {
+            const EventSlot& slot = m_Events[i % EventCountMax];
+            AudioEvent& event = pOutEvents[i - begin];
+            event.timeMicroSeconds = slot.timeMicroSeconds.load(std::memory_order_relaxed);
+            event.type = static_cast<AudioEventType>(slot.type.load(std::memory_order_relaxed));
+            event.queuedFrameCount = slot.queuedFrameCount.load(std::memory_order_relaxed);
+        }
+
+        // Drop the oldest events if the recorder wrapped onto them while they were copied. The
+        // recorder may also be halfway through writing event count into the slot of event
+        // count - EventCountMax, so the first safe event is the one after that.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const int64_t overwritten = m_EventCount.load(std::memory_order_relaxed) - EventCountMax;
+        const int64_t first = std::min(end, std::max(begin, overwritten + 1));
+        const int count = static_cast<int>(end - first);
+        std::copy(pOutEvents + (first - begin), pOutEvents + (end - begin), pOutEvents);
+        return count;
+    }
+
+    void AudioTelemetry::PushEvent(int64_t time, AudioEventType type, int queuedFrameCount)
+    {
+        const int64_t index = m_EventCount.load(std::memory_order_relaxed);
+        EventSlot& slot = m_Events[index % EventCountMax];
+        slot.timeMicroSeconds.store(time - m_StartTime, std::memory_order_relaxed);
+        slot.type.store(type, std::memory_order_relaxed);
+        slot.queuedFrameCount.store(queuedFrameCount, std::memory_order_relaxed);
+        m_EventCount.store(index + 1, std::memory_order_release);
+    }
+
+    void AudioTelemetry::AddToHistogram(std::atomic<int>* pCounts, int binMicroSeconds, int value)
+    {
+        const int bin = std::min(std::max(value, 0) / binMicroSeconds, AudioHistogramBinCount - 1);
+        pCounts[bin].store(pCounts[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void AudioTelemetry::CopyHistogram(AudioHistogram* pOutHistogram, const std::atomic<int>* pCounts, int binMicroSeconds)
+    {
+        assert(pOutHistogram != nullptr);
+        pOutHistogram->binMicroSeconds = binMicroSeconds;
+        for (int i = 0; i < AudioHistogramBinCount; ++i)
+        {
+            pOutHistogram->counts[i] = pCounts[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    int64_t AudioTelemetry::GetTime()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+}
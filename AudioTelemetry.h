@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+namespace AUS {
+
+    const int AudioHistogramBinCount = 32;
+
+    enum AudioEventType
+    {
+        AudioEventType_Wake,     // The audio thread woke for the device.
+        AudioEventType_Release,  // The device gave a buffer back.
+        AudioEventType_Append,   // A filled buffer went to the device.
+        AudioEventType_Update,   // The renderer took the parameters of its next frame.
+        AudioEventType_Underrun  // The device ran out of audio.
+    };
+
+    struct AudioEvent
+    {
+        int64_t timeMicroSeconds; // Since the telemetry was made.
+        AudioEventType type;
+        int queuedFrameCount;     // For an append, the frames the device holds after it.
+    };
+
+    // Counts per bin of binMicroSeconds; the last bin also takes everything above it.
+    struct AudioHistogram
+    {
+        int binMicroSeconds;
+        int counts[AudioHistogramBinCount];
+    };
+
+    struct AudioTelemetryStats
+    {
+        int periodMicroSeconds;      // Audio the device plays between two wakes.
+        int wakeCount;
+        int lateWakeCount;           // Wakes that came half a period or more late.
+        int underrunCount;
+        int queuedFrameCount;        // Frames queued after the last append.
+        int peakQueuedFrameCount;
+        int lastLatencyMicroSeconds;
+        int peakLatencyMicroSeconds;
+        int lastJitterMicroSeconds;
+        int peakJitterMicroSeconds;
+    };
+
+    // Timing of one audio pipeline, for finding dropouts that only happen in the field.
+    //
+    // The audio thread records every wake, every buffer the device releases and every append
+    // or renderer update, with a timestamp, into a ring of the last EventCountMax events.
+    // On top of the ring it keeps two histograms:
+    //  - Jitter, how far each wake lands from one period after the previous one.
+    //  - Latency. After an append it is the audio queued ahead of the device; after a renderer
+    //    update it is the time the update took from the wake, which must stay under a period.
+    //
+    // Record from one thread only. The getters are safe to call from any thread; they read the
+    // fields one by one, so the stats may mix two consecutive records.
+    class AudioTelemetry
+    {
+    public:
+        static const int EventCountMax = 256;
+
+        AudioTelemetry();
+
+        // periodFrameCount is what the device plays between two wakes: the frames of one
+        // AudioOut buffer, or of one renderer frame. Clears everything recorded so far, so
+        // call it before the audio thread starts.
+        void Initialize(int sampleRate, int periodFrameCount);
+
+        void RecordWake();
+        void RecordRelease();
+        // queuedFrameCount counts the appended buffer.
+        void RecordAppend(int queuedFrameCount);
+        void RecordUpdate();
+        void RecordUnderrun();
+
+        AudioTelemetryStats GetStats() const;
+        void GetLatencyHistogram(AudioHistogram* pOutHistogram) const;
+        void GetJitterHistogram(AudioHistogram* pOutHistogram) const;
+        // Copies up to countMax of the latest events, oldest first, and returns how many.
+        int GetEvents(AudioEvent* pOutEvents, int countMax) const;
+
+    private:
+        AudioTelemetry(const AudioTelemetry&);
+        AudioTelemetry& operator=(const AudioTelemetry&);
+
+        struct EventSlot
+        {
+            std::atomic<int64_t> timeMicroSeconds;
+            std::atomic<int> type;
+            std::atomic<int> queuedFrameCount;
+        };
+
+        static int64_t GetTime();
+        void PushEvent(int64_t time, AudioEventType type, int queuedFrameCount);
+        void RecordLatency(int latencyMicroSeconds);
+        static void AddToHistogram(std::atomic<int>* pCounts, int binMicroSeconds, int value);
+        static void CopyHistogram(AudioHistogram* pOutHistogram, const std::atomic<int>* pCounts, int binMicroSeconds);
+
+        int m_SampleRate;
+        int m_PeriodMicroSeconds;
+        int m_LatencyBinMicroSeconds;
+        int m_JitterBinMicroSeconds;
+        int64_t m_StartTime;
+
+        // Recording thread only.
+        int64_t m_LastWakeTime; // -1 before the first wake.
+
+        // Stats the recording thread publishes.
+        std::atomic<int> m_WakeCount;
+        std::atomic<int> m_LateWakeCount;
+        std::atomic<int> m_UnderrunCount;
+        std::atomic<int> m_QueuedFrameCount;
+        std::atomic<int> m_PeakQueuedFrameCount;
+        std::atomic<int> m_LastLatencyMicroSeconds;
+        std::atomic<int> m_PeakLatencyMicroSeconds;
+        std::atomic<int> m_LastJitterMicroSeconds;
+        std::atomic<int> m_PeakJitterMicroSeconds;
+        std::atomic<int> m_LatencyCounts[AudioHistogramBinCount];
+        std::atomic<int> m_JitterCounts[AudioHistogramBinCount];
+
+        EventSlot m_Events[EventCountMax];
+        std::atomic<int64_t> m_EventCount; // Events ever pushed; the ring holds the latest ones.
+    };
+
+}
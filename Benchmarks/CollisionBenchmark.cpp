@@ -0,0 +1,465 @@
+// Collision micro-benchmarks for a Linux host.
+//
+// Measures the scalar Circle/Rectangle tests against the batched kernels and the
+// broadphases for N = 10 .. 1M bodies over three distributions:
+//   uniform     bodies spread at a constant density
+//   clustered   bodies packed around a few centers
+//   adversarial every body overlaps every other one
+//
+// Every row reports the number of tests, ns per test and tests per second. For the
+// broadphases a test is one of the N * (N - 1) / 2 candidate pairs, so the rows
+// compare directly with the brute force row. Scalar and batched rows of the same
+// test must find the same number of hits; a mismatch is reported and the program
+// exits with 1.
+//
+// Usage: CollisionBenchmark [--format=csv|json] [--max-n=N] [--min-time=seconds] [--filter=text]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CircleBatch.h"
+#include "CollisionWorld.h"
+#include "DynamicAabbTree.h"
+#include "RectBatch.h"
+
+namespace
+{
+	enum Distribution
+	{
+		Distribution_Uniform,
+		Distribution_Clustered,
+		Distribution_Adversarial,
+		Distribution_Count
+	};
+
+	const char* GetDistributionName(Distribution distribution_)
+	{
+		switch (distribution_)
+		{
+		case Distribution_Uniform:
+			return "uniform";
+		case Distribution_Clustered:
+			return "clustered";
+		case Distribution_Adversarial:
+			return "adversarial";
+		default:
+			return "unknown";
+		}
+	}
+
+	struct Options
+	{
+		bool isJson;
+		int maxN;
+		double minTime;
+		std::string filter;
+	};
+
+	struct Result
+	{
+		std::string benchmark;
+		const char* distribution;
+		int n;
+		double testCount;
+		double seconds;
+		long long hitCount;
+	};
+
+	// Queries per measured repetition of the one-vs-many benchmarks.
+	const int QueryCount = 16;
+	// Largest N for the quadratic benchmarks.
+	const int BruteForceMaxN = 10000;
+	const int AdversarialBroadphaseMaxN = 2000;
+
+	volatile long long g_Sink;
+
+	void Generate(Distribution distribution_, int n_, std::vector<Circle>* pOutCircles)
+	{
+		std::mt19937 random(12345u + static_cast<unsigned int>(n_));
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		// About one body per 16 square units, so the uniform case keeps a few
+		// neighbors per body at every N.
+		const float side = std::sqrt(static_cast<float>(n_) * 16.0f);
+
+		pOutCircles->resize(n_);
+		if (distribution_ == Distribution_Uniform)
+		{
+			for (int i = 0; i < n_; ++i)
+			{
+				(*pOutCircles)[i] = Circle(unit(random) * side, unit(random) * side, 0.5f + unit(random) * 0.5f);
+			}
+		}
+		else if (distribution_ == Distribution_Clustered)
+		{
+			const int clusterCount = n_ < 64 ? 1 : n_ / 64;
+			std::vector<float> centerX(clusterCount);
+			std::vector<float> centerY(clusterCount);
+			for (int c = 0; c < clusterCount; ++c)
+			{
+				centerX[c] = unit(random) * side;
+				centerY[c] = unit(random) * side;
+			}
+			std::normal_distribution<float> spread(0.0f, 3.0f);
+			for (int i = 0; i < n_; ++i)
+			{
+				int c = static_cast<int>(random() % clusterCount);
+				(*pOutCircles)[i] = Circle(centerX[c] + spread(random), centerY[c] + spread(random), 0.5f + unit(random) * 0.5f);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < n_; ++i)
+			{
+				(*pOutCircles)[i] = Circle(unit(random), unit(random), 2.0f);
+			}
+		}
+	}
+
+	// Runs body_ until at least minTime_ seconds have passed and returns the time of one run.
+	template <typename TBody>
+	double Measure(double minTime_, TBody body_)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		body_();
+		long long runCount = 0;
+		const Clock::time_point start = Clock::now();
+		double elapsed = 0.0;
+		do
+		{
+			body_();
+			++runCount;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsed < minTime_);
+		return elapsed / static_cast<double>(runCount);
+	}
+
+	class Runner
+	{
+	public:
+		explicit Runner(const Options& options_) : m_Options(options_), m_MismatchCount(0) {}
+
+		template <typename TBody>
+		void Run(const char* pName_, Distribution distribution_, int n_, double testCount_, TBody body_)
+		{
+			if (!m_Options.filter.empty() && std::strstr(pName_, m_Options.filter.c_str()) == nullptr)
+			{
+				return;
+			}
+
+			long long hitCount = 0;
+			double seconds = Measure(m_Options.minTime, [&]()
+			{
+				hitCount = body_();
+				g_Sink = hitCount;
+			});
+
+			Result result;
+			result.benchmark = pName_;
+			result.distribution = GetDistributionName(distribution_);
+			result.n = n_;
+			result.testCount = testCount_;
+			result.seconds = seconds;
+			result.hitCount = hitCount;
+			m_Results.push_back(result);
+		}
+
+		// Checks that two rows of the current distribution and size found the same hits.
+		void Compare(const char* pScalarName_, const char* pBatchName_)
+		{
+			const Result* pScalar = Find(pScalarName_);
+			const Result* pBatch = Find(pBatchName_);
+			if (pScalar == nullptr || pBatch == nullptr)
+			{
+				return;
+			}
+			if (pScalar->hitCount != pBatch->hitCount)
+			{
+				std::fprintf(stderr, "mismatch: %s %s n=%d: %lld vs %lld hits\n",
+					pScalarName_, pBatchName_, pScalar->n, pScalar->hitCount, pBatch->hitCount);
+				++m_MismatchCount;
+			}
+		}
+
+		void Print() const
+		{
+			if (m_Options.isJson)
+			{
+				std::printf("[\n");
+				for (size_t i = 0; i < m_Results.size(); ++i)
+				{
+					const Result& r = m_Results[i];
+					std::printf("  {\"benchmark\": \"%s\", \"distribution\": \"%s\", \"n\": %d, \"tests\": %.0f, "
+						"\"ns_per_test\": %.4f, \"tests_per_second\": %.0f, \"hits\": %lld}%s\n",
+						r.benchmark.c_str(), r.distribution, r.n, r.testCount,
+						r.seconds * 1e9 / r.testCount, r.testCount / r.seconds, r.hitCount,
+						i + 1 < m_Results.size() ? "," : "");
+				}
+				std::printf("]\n");
+			}
+			else
+			{
+				std::printf("benchmark,distribution,n,tests,ns_per_test,tests_per_second,hits\n");
+				for (size_t i = 0; i < m_Results.size(); ++i)
+				{
+					const Result& r = m_Results[i];
+					std::printf("%s,%s,%d,%.0f,%.4f,%.0f,%lld\n",
+						r.benchmark.c_str(), r.distribution, r.n, r.testCount,
+						r.seconds * 1e9 / r.testCount, r.testCount / r.seconds, r.hitCount);
+				}
+			}
+		}
+
+		int GetMismatchCount() const { return m_MismatchCount; }
+
+	private:
+		// Looks for pName_ among the rows of the current distribution and size.
+		const Result* Find(const char* pName_) const
+		{
+			if (m_Results.empty())
+			{
+				return nullptr;
+			}
+			const Result& last = m_Results.back();
+			for (size_t i = m_Results.size(); i > 0; --i)
+			{
+				const Result& r = m_Results[i - 1];
+				if (r.n != last.n || r.distribution != last.distribution)
+				{
+					break;
+				}
+				if (r.benchmark == pName_)
+				{
+					return &r;
+				}
+			}
+			return nullptr;
+		}
+
+		const Options& m_Options;
+		std::vector<Result> m_Results;
+		int m_MismatchCount;
+	};
+
+	void RunSize(Runner* pRunner, Distribution distribution_, int n_)
+	{
+		std::vector<Circle> circles;
+		Generate(distribution_, n_, &circles);
+
+		CircleBatch circleBatch(n_);
+		RectBatch rectBatch(n_);
+		std::vector<Rectangle> rects(n_);
+		for (int i = 0; i < n_; ++i)
+		{
+			const Circle& c = circles[i];
+			rects[i] = Rectangle(c.x - c.r, c.y - c.r, c.x + c.r, c.y + c.r);
+			circleBatch.Add(c);
+			rectBatch.Add(rects[i]);
+		}
+		std::vector<uint32_t> mask(circleBatch.GetMaskWordCount() > 0 ? circleBatch.GetMaskWordCount() : 1);
+
+		// Queries are bodies of the set itself, so they land where the bodies are.
+		std::vector<Circle> queries(QueryCount);
+		for (int q = 0; q < QueryCount; ++q)
+		{
+			queries[q] = circles[static_cast<size_t>(q) * n_ / QueryCount];
+		}
+		const double oneVsManyTests = static_cast<double>(QueryCount) * n_;
+
+		pRunner->Run("circle_collide_scalar", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				Circle query = queries[q];
+				for (int i = 0; i < n_; ++i)
+				{
+					hits += query.Collide(circles[i]) ? 1 : 0;
+				}
+			}
+			return hits;
+		});
+		pRunner->Run("circle_collide_batch", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				hits += circleBatch.CollideOneVsMany(queries[q], mask.data());
+			}
+			return hits;
+		});
+		pRunner->Compare("circle_collide_scalar", "circle_collide_batch");
+
+		// inCircle has no batch kernel of its own, a radius 0 query circle is the same test.
+		pRunner->Run("circle_incircle_scalar", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				for (int i = 0; i < n_; ++i)
+				{
+					hits += circles[i].inCircle(queries[q].x, queries[q].y) ? 1 : 0;
+				}
+			}
+			return hits;
+		});
+		pRunner->Run("circle_incircle_batch", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				hits += circleBatch.CollideOneVsMany(Circle(queries[q].x, queries[q].y, 0.0f), mask.data());
+			}
+			return hits;
+		});
+		pRunner->Compare("circle_incircle_scalar", "circle_incircle_batch");
+
+		pRunner->Run("rect_inrect_scalar", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				for (int i = 0; i < n_; ++i)
+				{
+					hits += rects[i].inRect(queries[q].x, queries[q].y) ? 1 : 0;
+				}
+			}
+			return hits;
+		});
+		pRunner->Run("rect_inrect_batch", distribution_, n_, oneVsManyTests, [&]() -> long long
+		{
+			long long hits = 0;
+			for (int q = 0; q < QueryCount; ++q)
+			{
+				hits += rectBatch.ContainsPoint(queries[q].x, queries[q].y, mask.data());
+			}
+			return hits;
+		});
+		pRunner->Compare("rect_inrect_scalar", "rect_inrect_batch");
+
+		// Broadphases. The quadratic ones are skipped where they would run for minutes.
+		const double pairTests = static_cast<double>(n_) * (n_ - 1) / 2.0;
+		if (distribution_ == Distribution_Adversarial && n_ > AdversarialBroadphaseMaxN)
+		{
+			return;
+		}
+
+		if (n_ <= BruteForceMaxN)
+		{
+			pRunner->Run("pairs_brute_force", distribution_, n_, pairTests, [&]() -> long long
+			{
+				long long hits = 0;
+				for (int i = 0; i < n_; ++i)
+				{
+					Circle a = circles[i];
+					for (int j = i + 1; j < n_; ++j)
+					{
+						hits += a.Collide(circles[j]) ? 1 : 0;
+					}
+				}
+				return hits;
+			});
+			pRunner->Run("pairs_batch", distribution_, n_, pairTests, [&]() -> long long
+			{
+				// Every row tests all of the batch, so each pair is seen twice and
+				// every circle once against itself.
+				long long hits = 0;
+				for (int i = 0; i < n_; ++i)
+				{
+					hits += circleBatch.CollideOneVsMany(circles[i], mask.data());
+				}
+				return (hits - n_) / 2;
+			});
+			pRunner->Compare("pairs_brute_force", "pairs_batch");
+		}
+
+		CollisionWorld world(2.0f, 1 << 16);
+		for (int i = 0; i < n_; ++i)
+		{
+			world.Insert(circles[i]);
+		}
+		std::vector<CollisionPair> pairs;
+		pRunner->Run("pairs_spatial_hash", distribution_, n_, pairTests, [&]() -> long long
+		{
+			return world.FindPairs(&pairs);
+		});
+		pRunner->Compare("pairs_brute_force", "pairs_spatial_hash");
+
+		DynamicAabbTree tree(2 * n_, 0.1f);
+		for (int i = 0; i < n_; ++i)
+		{
+			tree.CreateProxy(circles[i]);
+		}
+		pRunner->Run("pairs_aabb_tree", distribution_, n_, pairTests, [&]() -> long long
+		{
+			return tree.FindPairs(&pairs);
+		});
+		pRunner->Compare("pairs_brute_force", "pairs_aabb_tree");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options* pOutOptions)
+	{
+		pOutOptions->isJson = false;
+		pOutOptions->maxN = 1000000;
+		pOutOptions->minTime = 0.05;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* pArg = argv[i];
+			if (std::strcmp(pArg, "--format=json") == 0)
+			{
+				pOutOptions->isJson = true;
+			}
+			else if (std::strcmp(pArg, "--format=csv") == 0)
+			{
+				pOutOptions->isJson = false;
+			}
+			else if (std::strncmp(pArg, "--max-n=", 8) == 0)
+			{
+				pOutOptions->maxN = std::atoi(pArg + 8);
+			}
+			else if (std::strncmp(pArg, "--min-time=", 11) == 0)
+			{
+				pOutOptions->minTime = std::atof(pArg + 11);
+			}
+			else if (std::strncmp(pArg, "--filter=", 9) == 0)
+			{
+				pOutOptions->filter = pArg + 9;
+			}
+			else
+			{
+				std::fprintf(stderr, "usage: %s [--format=csv|json] [--max-n=N] [--min-time=seconds] [--filter=text]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, &options))
+	{
+		return 2;
+	}
+
+	Runner runner(options);
+	for (int d = 0; d < Distribution_Count; ++d)
+	{
+		for (int n = 10; n <= options.maxN; n *= 10)
+		{
+			RunSize(&runner, static_cast<Distribution>(d), n);
+		}
+	}
+
+	runner.Print();
+	return runner.GetMismatchCount() == 0 ? 0 : 1;
+}
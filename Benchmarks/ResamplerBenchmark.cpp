@@ -0,0 +1,295 @@
+// Resampler micro-benchmarks for a Linux host.
+//
+// Converts a stereo stream between the rates the sample meets, the renderer rate of
+// 32000 Hz, CD rate content and the 48000 Hz device, at every quality setting.
+//
+// Every row reports ns per output frame and the share of one core it takes to keep up
+// with the device in real time. It also reports the error of a 1 kHz sine against the
+// ideal one, in dB under the signal; a row above the bound of its quality is reported
+// and the program exits with 1.
+//
+// Usage: ResamplerBenchmark [--format=csv|json] [--min-time=seconds] [--filter=text]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Resampler.h"
+
+namespace
+{
+	struct Options
+	{
+		bool isJson;
+		double minTime;
+		std::string filter;
+	};
+
+	struct Result
+	{
+		std::string benchmark;
+		int inputRate;
+		int outputRate;
+		const char* quality;
+		int tapCount;
+		bool isExact;
+		double seconds;
+		double errorDb;
+	};
+
+	const char* const QualityNames[] = { "low", "medium", "high" };
+	// Worst error of the 1 kHz sine each quality may show.
+	const double ErrorBoundsDb[] = { -50.0, -70.0, -90.0 };
+
+	const int ChannelCount = 2;
+	// Output frames per measured repetition, about 100 ms at the device rate.
+	const int FrameCount = 4800;
+	// Frames the device asks for at a time, an odd size so blocks straddle source blocks.
+	const int RenderFrameCount = 333;
+	const double SineFrequency = 1000.0;
+
+	volatile float g_Sink;
+
+	struct SineSource
+	{
+		int sampleRate;
+		long long frame;
+	};
+
+	void ReadSine(float* pOut_, int frameCount_, void* pUserArg_)
+	{
+		SineSource* pSource = static_cast<SineSource*>(pUserArg_);
+		const double step = 2.0 * 3.14159265358979323846 * SineFrequency / pSource->sampleRate;
+		for (int i = 0; i < frameCount_; ++i, ++pSource->frame)
+		{
+			const float value = static_cast<float>(0.5 * std::sin(step * static_cast<double>(pSource->frame)));
+			for (int ch = 0; ch < ChannelCount; ++ch)
+			{
+				pOut_[i * ChannelCount + ch] = value;
+			}
+		}
+	}
+
+	// The timed rows replay one block of noise, so they measure the resampler and not the source.
+	void ReadNoise(float* pOut_, int frameCount_, void* pUserArg_)
+	{
+		const std::vector<float>* pNoise = static_cast<const std::vector<float>*>(pUserArg_);
+		std::memcpy(pOut_, pNoise->data(), sizeof(float) * frameCount_ * ChannelCount);
+	}
+
+	void Render(AUS::Resampler* pResampler_, float* pOut_, int frameCount_)
+	{
+		for (int offset = 0; offset < frameCount_; offset += RenderFrameCount)
+		{
+			const int count = frameCount_ - offset < RenderFrameCount ? frameCount_ - offset : RenderFrameCount;
+			pResampler_->Render(pOut_ + offset * ChannelCount, count);
+		}
+	}
+
+	// Error of the resampled sine against the ideal one after the filter has settled.
+	double MeasureError(int inputRate_, int outputRate_, AUS::ResamplerQuality quality_)
+	{
+		SineSource source = { inputRate_, 0 };
+		AUS::Resampler resampler(inputRate_, outputRate_, ChannelCount, quality_, ReadSine, &source);
+		std::vector<float> output(static_cast<size_t>(FrameCount) * ChannelCount);
+		Render(&resampler, output.data(), FrameCount);
+
+		const double step = 2.0 * 3.14159265358979323846 * SineFrequency / outputRate_;
+		double error = 0.0;
+		double signal = 0.0;
+		for (int i = FrameCount / 4; i < FrameCount; ++i)
+		{
+			const double expected = 0.5 * std::sin(step * i);
+			for (int ch = 0; ch < ChannelCount; ++ch)
+			{
+				const double difference = output[i * ChannelCount + ch] - expected;
+				error += difference * difference;
+				signal += expected * expected;
+			}
+		}
+		return 10.0 * std::log10(error / signal + 1e-30);
+	}
+
+	// Runs body_ until at least minTime_ seconds have passed and returns the time of one run.
+	template <typename TBody>
+	double Measure(double minTime_, TBody body_)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		body_();
+		long long runCount = 0;
+		const Clock::time_point start = Clock::now();
+		double elapsed = 0.0;
+		do
+		{
+			body_();
+			++runCount;
+			elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		} while (elapsed < minTime_);
+		return elapsed / static_cast<double>(runCount);
+	}
+
+	class Runner
+	{
+	public:
+		explicit Runner(const Options& options_) : m_Options(options_), m_FailureCount(0) {}
+
+		void Run(int inputRate_, int outputRate_, AUS::ResamplerQuality quality_)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "resample_%d_%d_%s", inputRate_, outputRate_, QualityNames[quality_]);
+			if (!m_Options.filter.empty() && std::strstr(name, m_Options.filter.c_str()) == nullptr)
+			{
+				return;
+			}
+
+			std::vector<float> noise(static_cast<size_t>(AUS::Resampler::InputBlockFrameCount) * ChannelCount);
+			unsigned int state = 12345u;
+			for (size_t i = 0; i < noise.size(); ++i)
+			{
+				state = state * 1664525u + 1013904223u;
+				noise[i] = static_cast<float>(static_cast<int>(state >> 8) - (1 << 23)) * (0.5f / (1 << 23));
+			}
+			AUS::Resampler resampler(inputRate_, outputRate_, ChannelCount, quality_, ReadNoise, &noise);
+			std::vector<float> output(static_cast<size_t>(FrameCount) * ChannelCount);
+			const double seconds = Measure(m_Options.minTime, [&]()
+			{
+				Render(&resampler, output.data(), FrameCount);
+				g_Sink = output[FrameCount - 1];
+			});
+
+			Result result;
+			result.benchmark = name;
+			result.inputRate = inputRate_;
+			result.outputRate = outputRate_;
+			result.quality = QualityNames[quality_];
+			result.tapCount = resampler.GetTapCount();
+			result.isExact = resampler.IsExact();
+			result.seconds = seconds;
+			result.errorDb = MeasureError(inputRate_, outputRate_, quality_);
+			m_Results.push_back(result);
+
+			if (result.errorDb > ErrorBoundsDb[quality_])
+			{
+				std::fprintf(stderr, "too noisy: %s %.1f dB, bound %.1f dB\n", name, result.errorDb, ErrorBoundsDb[quality_]);
+				++m_FailureCount;
+			}
+		}
+
+		void Print() const
+		{
+			if (m_Options.isJson)
+			{
+				std::printf("[\n");
+				for (size_t i = 0; i < m_Results.size(); ++i)
+				{
+					const Result& r = m_Results[i];
+					std::printf("  {\"benchmark\": \"%s\", \"input_rate\": %d, \"output_rate\": %d, \"quality\": \"%s\", "
+						"\"taps\": %d, \"exact\": %s, \"ns_per_frame\": %.2f, \"core_percent\": %.3f, \"error_db\": %.1f}%s\n",
+						r.benchmark.c_str(), r.inputRate, r.outputRate, r.quality, r.tapCount, r.isExact ? "true" : "false",
+						GetNanoSecondsPerFrame(r), GetCorePercent(r), r.errorDb,
+						i + 1 < m_Results.size() ? "," : "");
+				}
+				std::printf("]\n");
+			}
+			else
+			{
+				std::printf("benchmark,input_rate,output_rate,quality,taps,exact,ns_per_frame,core_percent,error_db\n");
+				for (size_t i = 0; i < m_Results.size(); ++i)
+				{
+					const Result& r = m_Results[i];
+					std::printf("%s,%d,%d,%s,%d,%d,%.2f,%.3f,%.1f\n",
+						r.benchmark.c_str(), r.inputRate, r.outputRate, r.quality, r.tapCount, r.isExact ? 1 : 0,
+						GetNanoSecondsPerFrame(r), GetCorePercent(r), r.errorDb);
+				}
+			}
+		}
+
+		int GetFailureCount() const { return m_FailureCount; }
+
+	private:
+		static double GetNanoSecondsPerFrame(const Result& r_)
+		{
+			return r_.seconds * 1e9 / FrameCount;
+		}
+
+		// Share of one core spent producing one second of output in real time.
+		static double GetCorePercent(const Result& r_)
+		{
+			return r_.seconds / FrameCount * r_.outputRate * 100.0;
+		}
+
+		const Options& m_Options;
+		std::vector<Result> m_Results;
+		int m_FailureCount;
+	};
+
+	bool ParseOptions(int argc, char** argv, Options* pOutOptions)
+	{
+		pOutOptions->isJson = false;
+		pOutOptions->minTime = 0.05;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* pArg = argv[i];
+			if (std::strcmp(pArg, "--format=json") == 0)
+			{
+				pOutOptions->isJson = true;
+			}
+			else if (std::strcmp(pArg, "--format=csv") == 0)
+			{
+				pOutOptions->isJson = false;
+			}
+			else if (std::strncmp(pArg, "--min-time=", 11) == 0)
+			{
+				pOutOptions->minTime = std::atof(pArg + 11);
+			}
+			else if (std::strncmp(pArg, "--filter=", 9) == 0)
+			{
+				pOutOptions->filter = pArg + 9;
+			}
+			else
+			{
+				std::fprintf(stderr, "usage: %s [--format=csv|json] [--min-time=seconds] [--filter=text]\n", argv[0]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, &options))
+	{
+		return 2;
+	}
+
+	// The renderer rate and CD rate content to the device and back, and a device rate
+	// with no short ratio, which blends phases.
+	const int ratePairs[][2] =
+	{
+		{ 32000, 48000 },
+		{ 44100, 48000 },
+		{ 48000, 32000 },
+		{ 48000, 44100 },
+		{ 44100, 47999 },
+	};
+
+	Runner runner(options);
+	for (size_t i = 0; i < sizeof(ratePairs) / sizeof(ratePairs[0]); ++i)
+	{
+		for (int quality = AUS::ResamplerQuality_Low; quality <= AUS::ResamplerQuality_High; ++quality)
+		{
+			runner.Run(ratePairs[i][0], ratePairs[i][1], static_cast<AUS::ResamplerQuality>(quality));
+		}
+	}
+
+	runner.Print();
+	return runner.GetFailureCount() == 0 ? 0 : 1;
+}
@@ -13,13 +13,20 @@ Circle::~Circle()
 {
 }
 
-bool Circle::Collide(Circle other_)
+bool Circle::Collide(const Circle& other_)
 {
 	float xGap = x - other_.x;
 	float yGap = y - other_.y;
 	float rSum = r + other_.r;
 
-	if (((xGap * xGap) + (yGap * yGap)) <= (rSum * rSum))
+	// CircleBatch relies on getting exactly the same rounding, so this must not be
+	// fused into an FMA. Separate statements are not enough on their own, GCC
+	// contracts across them by default; both builds pass -ffp-contract=off.
+	float xSq = xGap * xGap;
+	float ySq = yGap * yGap;
+	float distSq = xSq + ySq;
+
+	if (distSq <= (rSum * rSum))
 	{
 		return true;
 	}
@@ -7,7 +7,7 @@ public:
 	Circle(float x_, float y_, float r_);
 	~Circle();
 
-	bool Collide(Circle other_);
+	bool Collide(const Circle& other_);
 	bool inCircle(float x_, float y_);
 
 	float x;
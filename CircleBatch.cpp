@@ -0,0 +1,208 @@
+#include <cassert>
+#include <cstring>
+
+#include "SimdUtil.h"
+#include "CircleBatch.h"
+
+namespace
+{
+	float* AllocateLane(int capacity_)
+	{
+		void* p = SimdUtil::AlignedAllocate(capacity_ * sizeof(float));
+		assert(p != nullptr);
+		std::memset(p, 0, capacity_ * sizeof(float));
+		return static_cast<float*>(p);
+	}
+
+	int PopCount(uint32_t v_)
+	{
+		v_ = v_ - ((v_ >> 1) & 0x55555555u);
+		v_ = (v_ & 0x33333333u) + ((v_ >> 2) & 0x33333333u);
+		return static_cast<int>((((v_ + (v_ >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+	}
+
+	// The kernel below mirrors Circle::Collide operation for operation
+	// (sub, sub, add, mul, mul, add, mul, compare) and never uses FMA, so every
+	// lane rounds exactly like the scalar test. That only holds while the scalar
+	// test is built with -ffp-contract=off too.
+	void CollideKernel(float cx_, float cy_, float cr_,
+		const float* pX_, const float* pY_, const float* pR_, int count_, uint32_t* pOutMask_)
+	{
+		const int wordCount = (count_ + 31) / 32;
+		std::memset(pOutMask_, 0, wordCount * sizeof(uint32_t));
+
+		int i = 0;
+#if defined(SIMD_AVX2)
+		{
+			const __m256 x = _mm256_set1_ps(cx_);
+			const __m256 y = _mm256_set1_ps(cy_);
+			const __m256 r = _mm256_set1_ps(cr_);
+			for (; i < count_; i += 8)
+			{
+				__m256 xGap = _mm256_sub_ps(x, _mm256_load_ps(pX_ + i));
+				__m256 yGap = _mm256_sub_ps(y, _mm256_load_ps(pY_ + i));
+				__m256 rSum = _mm256_add_ps(r, _mm256_load_ps(pR_ + i));
+				__m256 distSq = _mm256_add_ps(_mm256_mul_ps(xGap, xGap), _mm256_mul_ps(yGap, yGap));
+				__m256 hit = _mm256_cmp_ps(distSq, _mm256_mul_ps(rSum, rSum), _CMP_LE_OQ);
+				pOutMask_[i >> 5] |= static_cast<uint32_t>(_mm256_movemask_ps(hit)) << (i & 31);
+			}
+		}
+#elif defined(SIMD_SSE2)
+		{
+			const __m128 x = _mm_set1_ps(cx_);
+			const __m128 y = _mm_set1_ps(cy_);
+			const __m128 r = _mm_set1_ps(cr_);
+			for (; i < count_; i += 4)
+			{
+				__m128 xGap = _mm_sub_ps(x, _mm_load_ps(pX_ + i));
+				__m128 yGap = _mm_sub_ps(y, _mm_load_ps(pY_ + i));
+				__m128 rSum = _mm_add_ps(r, _mm_load_ps(pR_ + i));
+				__m128 distSq = _mm_add_ps(_mm_mul_ps(xGap, xGap), _mm_mul_ps(yGap, yGap));
+				__m128 hit = _mm_cmple_ps(distSq, _mm_mul_ps(rSum, rSum));
+				pOutMask_[i >> 5] |= static_cast<uint32_t>(_mm_movemask_ps(hit)) << (i & 31);
+			}
+		}
+#elif defined(SIMD_NEON)
+		{
+			const float32x4_t x = vdupq_n_f32(cx_);
+			const float32x4_t y = vdupq_n_f32(cy_);
+			const float32x4_t r = vdupq_n_f32(cr_);
+			for (; i < count_; i += 4)
+			{
+				float32x4_t xGap = vsubq_f32(x, vld1q_f32(pX_ + i));
+				float32x4_t yGap = vsubq_f32(y, vld1q_f32(pY_ + i));
+				float32x4_t rSum = vaddq_f32(r, vld1q_f32(pR_ + i));
+				float32x4_t distSq = vaddq_f32(vmulq_f32(xGap, xGap), vmulq_f32(yGap, yGap));
+				uint32x4_t hit = vcleq_f32(distSq, vmulq_f32(rSum, rSum));
+				pOutMask_[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+			}
+		}
+#else
+		for (; i < count_; ++i)
+		{
+			float xGap = cx_ - pX_[i];
+			float yGap = cy_ - pY_[i];
+			float rSum = cr_ + pR_[i];
+			float xSq = xGap * xGap;
+			float ySq = yGap * yGap;
+			float distSq = xSq + ySq;
+			if (distSq <= rSum * rSum)
+			{
+				pOutMask_[i >> 5] |= 1u << (i & 31);
+			}
+		}
+#endif
+
+		// The vector loops run into the padding, drop those lanes again.
+		if ((count_ & 31) != 0)
+		{
+			pOutMask_[wordCount - 1] &= (1u << (count_ & 31)) - 1;
+		}
+	}
+}
+
+CircleBatch::CircleBatch(int capacity_) : m_X(nullptr), m_Y(nullptr), m_R(nullptr), m_Count(0), m_Capacity(0)
+{
+	Reserve(capacity_);
+}
+
+CircleBatch::~CircleBatch()
+{
+	SimdUtil::AlignedFree(m_X);
+	SimdUtil::AlignedFree(m_Y);
+	SimdUtil::AlignedFree(m_R);
+}
+
+void CircleBatch::Reserve(int capacity_)
+{
+	capacity_ = SimdUtil::RoundUp(capacity_ > 0 ? capacity_ : 1, SimdUtil::MaxLaneCount);
+	if (capacity_ <= m_Capacity)
+	{
+		return;
+	}
+
+	float* x = AllocateLane(capacity_);
+	float* y = AllocateLane(capacity_);
+	float* r = AllocateLane(capacity_);
+	if (m_Count > 0)
+	{
+		std::memcpy(x, m_X, m_Count * sizeof(float));
+		std::memcpy(y, m_Y, m_Count * sizeof(float));
+		std::memcpy(r, m_R, m_Count * sizeof(float));
+	}
+	SimdUtil::AlignedFree(m_X);
+	SimdUtil::AlignedFree(m_Y);
+	SimdUtil::AlignedFree(m_R);
+
+	m_X = x;
+	m_Y = y;
+	m_R = r;
+	m_Capacity = capacity_;
+}
+
+void CircleBatch::Clear()
+{
+	m_Count = 0;
+}
+
+int CircleBatch::Add(const Circle& circle_)
+{
+	if (m_Count == m_Capacity)
+	{
+		Reserve(m_Capacity * 2);
+	}
+	Set(m_Count, circle_);
+	return m_Count++;
+}
+
+void CircleBatch::Set(int index_, const Circle& circle_)
+{
+	assert(0 <= index_ && index_ < m_Capacity);
+	m_X[index_] = circle_.x;
+	m_Y[index_] = circle_.y;
+	m_R[index_] = circle_.r;
+}
+
+Circle CircleBatch::Get(int index_) const
+{
+	assert(0 <= index_ && index_ < m_Count);
+	return Circle(m_X[index_], m_Y[index_], m_R[index_]);
+}
+
+int CircleBatch::CollideOneVsMany(const Circle& circle_, uint32_t* pOutMask) const
+{
+	if (m_Count == 0)
+	{
+		return 0;
+	}
+	CollideKernel(circle_.x, circle_.y, circle_.r, m_X, m_Y, m_R, m_Count, pOutMask);
+	return CountMaskBits(pOutMask, GetMaskWordCount());
+}
+
+int CircleBatch::CollideManyVsMany(const CircleBatch& other_, uint32_t* pOutMask) const
+{
+	const int stride = other_.GetMaskWordCount();
+	if (stride == 0)
+	{
+		return 0;
+	}
+
+	int hitCount = 0;
+	for (int i = 0; i < m_Count; ++i)
+	{
+		uint32_t* pRow = pOutMask + i * stride;
+		CollideKernel(m_X[i], m_Y[i], m_R[i], other_.m_X, other_.m_Y, other_.m_R, other_.m_Count, pRow);
+		hitCount += CountMaskBits(pRow, stride);
+	}
+	return hitCount;
+}
+
+int CountMaskBits(const uint32_t* pMask_, int wordCount_)
+{
+	int count = 0;
+	for (int i = 0; i < wordCount_; ++i)
+	{
+		count += PopCount(pMask_[i]);
+	}
+	return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Circle.h"
+
+//! Structure-of-arrays storage for many circles.
+//! x, y and r live in separate aligned arrays padded to SimdUtil::MaxLaneCount,
+//! so the overlap kernels can test 4 (SSE2, NEON) or 8 (AVX2) circles per instruction.
+//! Results are bitmasks, bit i of word i / 32 is set when circle i collides.
+//! Every kernel gives exactly the same answer as Circle::Collide.
+class CircleBatch
+{
+public:
+	explicit CircleBatch(int capacity_ = 0);
+	~CircleBatch();
+
+	void Reserve(int capacity_);
+	void Clear();
+
+	int Add(const Circle& circle_);
+	void Set(int index_, const Circle& circle_);
+	Circle Get(int index_) const;
+
+	int GetCount() const { return m_Count; }
+	int GetCapacity() const { return m_Capacity; }
+
+	//! Number of uint32_t words needed to hold one result bit per circle.
+	int GetMaskWordCount() const { return (m_Count + 31) / 32; }
+
+	const float* GetX() const { return m_X; }
+	const float* GetY() const { return m_Y; }
+	const float* GetR() const { return m_R; }
+
+	//! Tests circle_ against every circle in the batch.
+	//! pOutMask needs GetMaskWordCount() words. Returns the number of hits.
+	int CollideOneVsMany(const Circle& circle_, uint32_t* pOutMask) const;
+
+	//! Tests every circle of this batch against every circle of other_.
+	//! Row i starts at pOutMask + i * other_.GetMaskWordCount(). Returns the number of hits.
+	int CollideManyVsMany(const CircleBatch& other_, uint32_t* pOutMask) const;
+
+private:
+	CircleBatch(const CircleBatch&);
+	CircleBatch& operator=(const CircleBatch&);
+
+	float* m_X;
+	float* m_Y;
+	float* m_R;
+	int m_Count;
+	int m_Capacity;
+};
+
+//! Counts the set bits of a result mask.
+int CountMaskBits(const uint32_t* pMask_, int wordCount_);
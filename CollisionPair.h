@@ -0,0 +1,8 @@
+#pragma once
+
+//! A pair of overlapping bodies reported by a broadphase. a < b always holds.
+struct CollisionPair
+{
+	int a;
+	int b;
+};
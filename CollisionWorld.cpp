@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <stdint.h>
+
+#include "CollisionWorld.h"
+
+CollisionWorld::CollisionWorld(float cellSize_, int bucketCount_)
+	: m_CellSize(cellSize_)
+	, m_InvCellSize(1.0f / cellSize_)
+	, m_BucketMask(bucketCount_ - 1)
+	, m_StampBase(0)
+{
+	assert(cellSize_ > 0.0f);
+	assert(bucketCount_ > 0 && (bucketCount_ & (bucketCount_ - 1)) == 0);
+
+	m_BucketStart.resize(bucketCount_);
+	m_BucketEnd.resize(bucketCount_);
+	m_BucketStamp.resize(bucketCount_, -1);
+}
+
+CollisionWorld::~CollisionWorld()
+{
+}
+
+int CollisionWorld::Insert(const Circle& circle_)
+{
+	int id;
+	if (!m_FreeIds.empty())
+	{
+		id = m_FreeIds.back();
+		m_FreeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<int>(m_IdToDense.size());
+		m_IdToDense.push_back(-1);
+	}
+
+	m_IdToDense[id] = static_cast<int>(m_Circles.size());
+	m_Circles.push_back(circle_);
+	m_DenseToId.push_back(id);
+
+	return id;
+}
+
+void CollisionWorld::Move(int id_, float x_, float y_)
+{
+	assert(IsValid(id_));
+	Circle& circle = m_Circles[m_IdToDense[id_]];
+	circle.x = x_;
+	circle.y = y_;
+}
+
+void CollisionWorld::Update(int id_, const Circle& circle_)
+{
+	assert(IsValid(id_));
+	m_Circles[m_IdToDense[id_]] = circle_;
+}
+
+void CollisionWorld::Remove(int id_)
+{
+	assert(IsValid(id_));
+
+	// Swap the last body into the hole to keep the arrays dense.
+	int dense = m_IdToDense[id_];
+	int last = static_cast<int>(m_Circles.size()) - 1;
+	if (dense != last)
+	{
+		m_Circles[dense] = m_Circles[last];
+		m_DenseToId[dense] = m_DenseToId[last];
+		m_IdToDense[m_DenseToId[dense]] = dense;
+	}
+	m_Circles.pop_back();
+	m_DenseToId.pop_back();
+
+	m_IdToDense[id_] = -1;
+	m_FreeIds.push_back(id_);
+}
+
+bool CollisionWorld::IsValid(int id_) const
+{
+	return 0 <= id_ && id_ < static_cast<int>(m_IdToDense.size()) && m_IdToDense[id_] >= 0;
+}
+
+const Circle& CollisionWorld::GetCircle(int id_) const
+{
+	assert(IsValid(id_));
+	return m_Circles[m_IdToDense[id_]];
+}
+
+int CollisionWorld::GetBodyCount() const
+{
+	return static_cast<int>(m_Circles.size());
+}
+
+float CollisionWorld::GetCellSize() const
+{
+	return m_CellSize;
+}
+
+int CollisionWorld::CellCoord(float v_) const
+{
+	// Clamp before converting, a float out of the int range (or NaN) is undefined
+	// behaviour to convert. NaN fails both tests and lands on the low bound.
+	const float cell = std::floor(v_ * m_InvCellSize);
+	if (!(cell > static_cast<float>(-CellCoordMax)))
+	{
+		return -CellCoordMax;
+	}
+	if (cell > static_cast<float>(CellCoordMax))
+	{
+		return CellCoordMax;
+	}
+	return static_cast<int>(cell);
+}
+
+int CollisionWorld::BucketOf(int cx_, int cy_) const
+{
+	unsigned int h = (static_cast<unsigned int>(cx_) * 73856093u) ^ (static_cast<unsigned int>(cy_) * 19349663u);
+	return static_cast<int>(h & static_cast<unsigned int>(m_BucketMask));
+}
+
+void CollisionWorld::BuildGrid()
+{
+	const int bodyCount = GetBodyCount();
+
+	m_CellMinX.resize(bodyCount);
+	m_CellMinY.resize(bodyCount);
+	m_CellMaxX.resize(bodyCount);
+	m_CellMaxY.resize(bodyCount);
+	m_IsOversize.resize(bodyCount);
+	m_OversizeBodies.clear();
+	m_TouchedBuckets.clear();
+
+	// Each pass stamps with its own range of values, so a stamp left by an earlier
+	// pass or build never matches. Only when the values run out is every stamp reset.
+	if (m_StampBase > INT_MAX - 2 * bodyCount)
+	{
+		std::fill(m_BucketStamp.begin(), m_BucketStamp.end(), -1);
+		m_StampBase = 0;
+	}
+	const int countStamp = m_StampBase;
+	const int fillStamp = m_StampBase + bodyCount;
+	m_StampBase += 2 * bodyCount;
+
+	// Count pass. A body whose cells hash to the same bucket more than once is
+	// only counted once, the stamp remembers the last body added to each bucket.
+	// A bucket stamped before this pass is empty so far and is reset on first use.
+	for (int i = 0; i < bodyCount; ++i)
+	{
+		const Circle& c = m_Circles[i];
+		m_CellMinX[i] = CellCoord(c.x - c.r);
+		m_CellMinY[i] = CellCoord(c.y - c.r);
+		m_CellMaxX[i] = CellCoord(c.x + c.r);
+		m_CellMaxY[i] = CellCoord(c.y + c.r);
+
+		m_IsOversize[i] = m_CellMaxX[i] - m_CellMinX[i] >= OversizeCellSpan
+			|| m_CellMaxY[i] - m_CellMinY[i] >= OversizeCellSpan;
+		if (m_IsOversize[i])
+		{
+			m_OversizeBodies.push_back(i);
+			continue;
+		}
+
+		for (int cy = m_CellMinY[i]; cy <= m_CellMaxY[i]; ++cy)
+		{
+			for (int cx = m_CellMinX[i]; cx <= m_CellMaxX[i]; ++cx)
+			{
+				int bucket = BucketOf(cx, cy);
+				if (m_BucketStamp[bucket] < countStamp)
+				{
+					m_TouchedBuckets.push_back(bucket);
+					m_BucketEnd[bucket] = 0;
+				}
+				if (m_BucketStamp[bucket] != countStamp + i)
+				{
+					m_BucketStamp[bucket] = countStamp + i;
+					++m_BucketEnd[bucket];
+				}
+			}
+		}
+	}
+
+	// Lay the touched buckets out in bucket order, m_BucketEnd turns from the
+	// count into the fill cursor.
+	std::sort(m_TouchedBuckets.begin(), m_TouchedBuckets.end());
+	int entryCount = 0;
+	for (size_t t = 0; t < m_TouchedBuckets.size(); ++t)
+	{
+		const int bucket = m_TouchedBuckets[t];
+		const int n = m_BucketEnd[bucket];
+		m_BucketStart[bucket] = entryCount;
+		m_BucketEnd[bucket] = entryCount;
+		entryCount += n;
+	}
+	m_BucketEntries.resize(entryCount);
+
+	// Fill pass. Bodies are visited in dense order, so every bucket ends up sorted.
+	for (int i = 0; i < bodyCount; ++i)
+	{
+		if (m_IsOversize[i])
+		{
+			continue;
+		}
+		for (int cy = m_CellMinY[i]; cy <= m_CellMaxY[i]; ++cy)
+		{
+			for (int cx = m_CellMinX[i]; cx <= m_CellMaxX[i]; ++cx)
+			{
+				int bucket = BucketOf(cx, cy);
+				if (m_BucketStamp[bucket] != fillStamp + i)
+				{
+					m_BucketStamp[bucket] = fillStamp + i;
+					m_BucketEntries[m_BucketEnd[bucket]++] = i;
+				}
+			}
+		}
+	}
+}
+
+int CollisionWorld::FindPairs(std::vector<CollisionPair>* pOutPairs)
+{
+	assert(pOutPairs != nullptr);
+	pOutPairs->clear();
+
+	BuildGrid();
+	FindPairsInBuckets(0, GetBucketCount(), pOutPairs);
+
+	return static_cast<int>(pOutPairs->size());
+}
+
+int CollisionWorld::GetBucketCount() const
+{
+	return m_BucketMask + 1;
+}
+
+void CollisionWorld::SplitBuckets(int chunkCount_, int* pOutBounds) const
+{
+	assert(chunkCount_ > 0 && pOutBounds != nullptr);
+	const int bucketCount = GetBucketCount();
+	const int touchedCount = static_cast<int>(m_TouchedBuckets.size());
+
+	// A bucket with n entries costs about n * (n - 1) / 2 pair tests plus the
+	// entries themselves. The oversize bodies are tested against everything
+	// with the last bucket, so their cost comes after every touched bucket.
+	int64_t totalCost = static_cast<int64_t>(m_OversizeBodies.size()) * GetBodyCount();
+	for (int t = 0; t < touchedCount; ++t)
+	{
+		const int bucket = m_TouchedBuckets[t];
+		int64_t n = m_BucketEnd[bucket] - m_BucketStart[bucket];
+		totalCost += n * (n - 1) / 2 + n;
+	}
+
+	pOutBounds[0] = 0;
+	int64_t cost = 0;
+	int t = 0;
+	for (int chunk = 1; chunk < chunkCount_; ++chunk)
+	{
+		const int64_t target = totalCost * chunk / chunkCount_;
+		while (t < touchedCount && cost < target)
+		{
+			const int bucket = m_TouchedBuckets[t];
+			int64_t n = m_BucketEnd[bucket] - m_BucketStart[bucket];
+			cost += n * (n - 1) / 2 + n;
+			++t;
+		}
+		pOutBounds[chunk] = t < touchedCount ? m_TouchedBuckets[t] : bucketCount;
+	}
+	pOutBounds[chunkCount_] = bucketCount;
+}
+
+void CollisionWorld::FindPairsInBuckets(int bucketBegin_, int bucketEnd_, std::vector<CollisionPair>* pOutPairs) const
+{
+	assert(pOutPairs != nullptr);
+	assert(0 <= bucketBegin_ && bucketBegin_ <= bucketEnd_ && bucketEnd_ <= GetBucketCount());
+
+	std::vector<int>::const_iterator touched = std::lower_bound(m_TouchedBuckets.begin(), m_TouchedBuckets.end(), bucketBegin_);
+	for (; touched != m_TouchedBuckets.end() && *touched < bucketEnd_; ++touched)
+	{
+		const int bucket = *touched;
+		const int begin = m_BucketStart[bucket];
+		const int end = m_BucketEnd[bucket];
+		for (int j = begin; j < end; ++j)
+		{
+			const int a = m_BucketEntries[j];
+			// Circle::Collide is not const, so test through a copy.
+			Circle circleA = m_Circles[a];
+			for (int k = j + 1; k < end; ++k)
+			{
+				const int b = m_BucketEntries[k];
+
+				// Two bodies can share several cells, so a pair is only reported from
+				// the bucket of the first cell their ranges have in common. Bodies that
+				// only meet here through a hash collision have no common cell at all.
+				int ox = m_CellMinX[a] > m_CellMinX[b] ? m_CellMinX[a] : m_CellMinX[b];
+				int oy = m_CellMinY[a] > m_CellMinY[b] ? m_CellMinY[a] : m_CellMinY[b];
+				if (ox > m_CellMaxX[a] || ox > m_CellMaxX[b]
+					|| oy > m_CellMaxY[a] || oy > m_CellMaxY[b])
+				{
+					continue;
+				}
+				if (BucketOf(ox, oy) != bucket)
+				{
+					continue;
+				}
+
+				if (circleA.Collide(m_Circles[b]))
+				{
+					int idA = m_DenseToId[a];
+					int idB = m_DenseToId[b];
+					CollisionPair pair;
+					pair.a = idA < idB ? idA : idB;
+					pair.b = idA < idB ? idB : idA;
+					pOutPairs->push_back(pair);
+				}
+			}
+		}
+	}
+
+	if (bucketBegin_ < bucketEnd_ && bucketEnd_ == GetBucketCount())
+	{
+		FindOversizePairs(pOutPairs);
+	}
+}
+
+void CollisionWorld::FindOversizePairs(std::vector<CollisionPair>* pOutPairs) const
+{
+	const int bodyCount = GetBodyCount();
+	for (size_t o = 0; o < m_OversizeBodies.size(); ++o)
+	{
+		const int a = m_OversizeBodies[o];
+		Circle circleA = m_Circles[a];
+		for (int b = 0; b < bodyCount; ++b)
+		{
+			// A pair of two oversize bodies is reported from the first of them.
+			if (b == a || (m_IsOversize[b] && b < a))
+			{
+				continue;
+			}
+
+			if (circleA.Collide(m_Circles[b]))
+			{
+				int idA = m_DenseToId[a];
+				int idB = m_DenseToId[b];
+				CollisionPair pair;
+				pair.a = idA < idB ? idA : idB;
+				pair.b = idA < idB ? idB : idA;
+				pOutPairs->push_back(pair);
+			}
+		}
+	}
+}
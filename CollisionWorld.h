@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "Circle.h"
+#include "CollisionPair.h"
+
+//! Broadphase for Circle bodies built on a uniform spatial hash grid.
+//! Every body is bucketed into the cells its bounds touch, and only bodies that
+//! share a cell are handed to Circle::Collide, so the cost of FindPairs grows
+//! with the number of bodies and local density instead of the number of pairs.
+class CollisionWorld
+{
+public:
+	static const int InvalidBodyId = -1;
+	//! Cell coordinates are clamped to +-CellCoordMax, so far off or non finite
+	//! bodies still land in a bounded range of cells.
+	static const int CellCoordMax = 1 << 20;
+	//! A body spanning more cells than this on either axis is not bucketed, it is
+	//! tested against every other body instead.
+	static const int OversizeCellSpan = 8;
+
+	//! cellSize_ should be about the diameter of a typical body.
+	//! bucketCount_ must be a power of two.
+	explicit CollisionWorld(float cellSize_, int bucketCount_ = 4096);
+	~CollisionWorld();
+
+	int Insert(const Circle& circle_);
+	void Move(int id_, float x_, float y_);
+	void Update(int id_, const Circle& circle_);
+	void Remove(int id_);
+
+	bool IsValid(int id_) const;
+	const Circle& GetCircle(int id_) const;
+	int GetBodyCount() const;
+	float GetCellSize() const;
+
+	//! Rebuilds the grid from the current body positions and writes every
+	//! overlapping pair to pOutPairs. Returns the number of pairs.
+	int FindPairs(std::vector<CollisionPair>* pOutPairs);
+
+	//! Pieces of FindPairs for running the narrowphase in parallel.
+	//! After BuildGrid, FindPairsInBuckets only reads the world, so disjoint
+	//! bucket ranges can be processed on different threads. Appending the
+	//! results of consecutive ranges in order gives exactly the FindPairs output.
+	void BuildGrid();
+	int GetBucketCount() const;
+	//! Splits the buckets into chunkCount_ consecutive ranges of about the same
+	//! narrowphase cost. Range i is [pOutBounds[i], pOutBounds[i + 1]), pOutBounds
+	//! needs chunkCount_ + 1 entries.
+	void SplitBuckets(int chunkCount_, int* pOutBounds) const;
+	//! Appends the overlapping pairs owned by the buckets [bucketBegin_, bucketEnd_).
+	//! Pairs with an oversize body are owned by the last bucket.
+	void FindPairsInBuckets(int bucketBegin_, int bucketEnd_, std::vector<CollisionPair>* pOutPairs) const;
+
+private:
+	int CellCoord(float v_) const;
+	int BucketOf(int cx_, int cy_) const;
+	void FindOversizePairs(std::vector<CollisionPair>* pOutPairs) const;
+
+	float m_CellSize;
+	float m_InvCellSize;
+	int m_BucketMask;
+
+	// Bodies are kept dense so the grid build walks contiguous memory.
+	std::vector<Circle> m_Circles;
+	std::vector<int> m_DenseToId;
+	std::vector<int> m_IdToDense;
+	std::vector<int> m_FreeIds;
+
+	// Per-body cell range, filled by BuildGrid.
+	std::vector<int> m_CellMinX;
+	std::vector<int> m_CellMinY;
+	std::vector<int> m_CellMaxX;
+	std::vector<int> m_CellMaxY;
+	std::vector<char> m_IsOversize;
+	std::vector<int> m_OversizeBodies;
+
+	// Only the buckets in m_TouchedBuckets, sorted, hold bodies. Touched bucket b
+	// holds the dense indices m_BucketEntries[m_BucketStart[b] .. m_BucketEnd[b]),
+	// the other buckets keep stale ranges that are never read.
+	std::vector<int> m_BucketStart;
+	std::vector<int> m_BucketEnd;
+	std::vector<int> m_BucketEntries;
+	std::vector<int> m_TouchedBuckets;
+	// Stamps below m_StampBase are from earlier builds, so no bucket is cleared
+	// between builds.
+	std::vector<int> m_BucketStamp;
+	int m_StampBase;
+};
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "CollisionWorld.h"
+#include "ContactBatch.h"
+#include "ContactCache.h"
+
+ContactBatch::ContactBatch(int capacity_)
+{
+	Reserve(capacity_);
+}
+
+ContactBatch::~ContactBatch()
+{
+}
+
+void ContactBatch::Reserve(int capacity_)
+{
+	m_BodyA.reserve(capacity_);
+	m_BodyB.reserve(capacity_);
+	m_NormalX.reserve(capacity_);
+	m_NormalY.reserve(capacity_);
+	m_Depth.reserve(capacity_);
+	m_PointX.reserve(capacity_);
+	m_PointY.reserve(capacity_);
+	m_NormalImpulse.reserve(capacity_);
+	m_TangentImpulse.reserve(capacity_);
+	m_Order.reserve(capacity_);
+}
+
+void ContactBatch::Clear()
+{
+	m_BodyA.clear();
+	m_BodyB.clear();
+	m_NormalX.clear();
+	m_NormalY.clear();
+	m_Depth.clear();
+	m_PointX.clear();
+	m_PointY.clear();
+	m_NormalImpulse.clear();
+	m_TangentImpulse.clear();
+}
+
+void ContactBatch::Push(int a_, int b_, float normalX_, float normalY_, float depth_, float pointX_, float pointY_)
+{
+	m_BodyA.push_back(a_);
+	m_BodyB.push_back(b_);
+	m_NormalX.push_back(normalX_);
+	m_NormalY.push_back(normalY_);
+	m_Depth.push_back(depth_);
+	m_PointX.push_back(pointX_);
+	m_PointY.push_back(pointY_);
+	m_NormalImpulse.push_back(0.0f);
+	m_TangentImpulse.push_back(0.0f);
+}
+
+bool ContactBatch::AddCircleCircle(int a_, const Circle& circleA_, int b_, const Circle& circleB_)
+{
+	float dx = circleB_.x - circleA_.x;
+	float dy = circleB_.y - circleA_.y;
+	float rSum = circleA_.r + circleB_.r;
+	float xSq = dx * dx;
+	float ySq = dy * dy;
+	float distSq = xSq + ySq;
+	if (distSq > rSum * rSum)
+	{
+		return false;
+	}
+
+	float dist = std::sqrt(distSq);
+	float nx = 0.0f;
+	float ny = 1.0f;
+	if (dist > 0.0f)
+	{
+		// Concentric circles have no direction of their own, they separate along y.
+		nx = dx / dist;
+		ny = dy / dist;
+	}
+	float depth = rSum - dist;
+	float toPoint = circleA_.r - depth * 0.5f;
+	Push(a_, b_, nx, ny, depth, circleA_.x + nx * toPoint, circleA_.y + ny * toPoint);
+	return true;
+}
+
+bool ContactBatch::AddCircleRect(int a_, const Circle& circle_, int b_, const Rectangle& rect_)
+{
+	float nearX = circle_.x < rect_.x2 ? circle_.x : rect_.x2;
+	nearX = rect_.x1 > nearX ? rect_.x1 : nearX;
+	float nearY = circle_.y < rect_.y2 ? circle_.y : rect_.y2;
+	nearY = rect_.y1 > nearY ? rect_.y1 : nearY;
+
+	float dx = nearX - circle_.x;
+	float dy = nearY - circle_.y;
+	float xSq = dx * dx;
+	float ySq = dy * dy;
+	float distSq = xSq + ySq;
+	if (distSq > circle_.r * circle_.r)
+	{
+		return false;
+	}
+
+	if (distSq > 0.0f)
+	{
+		// Center outside the rectangle, the closest point is the contact.
+		float dist = std::sqrt(distSq);
+		float nx = dx / dist;
+		float ny = dy / dist;
+		float depth = circle_.r - dist;
+		Push(a_, b_, nx, ny, depth, nearX - nx * depth * 0.5f, nearY - ny * depth * 0.5f);
+		return true;
+	}
+
+	// Center inside, push out through the closest edge. The normal points into
+	// the rectangle, away from that edge.
+	const float toLeft = circle_.x - rect_.x1;
+	const float toRight = rect_.x2 - circle_.x;
+	const float toBottom = circle_.y - rect_.y1;
+	const float toTop = rect_.y2 - circle_.y;
+	float nx = 1.0f;
+	float ny = 0.0f;
+	float edgeDist = toLeft;
+	float edgeX = rect_.x1;
+	float edgeY = circle_.y;
+	if (toRight < edgeDist)
+	{
+		nx = -1.0f;
+		edgeDist = toRight;
+		edgeX = rect_.x2;
+	}
+	if (toBottom < edgeDist)
+	{
+		nx = 0.0f;
+		ny = 1.0f;
+		edgeDist = toBottom;
+		edgeX = circle_.x;
+		edgeY = rect_.y1;
+	}
+	if (toTop < edgeDist)
+	{
+		nx = 0.0f;
+		ny = -1.0f;
+		edgeDist = toTop;
+		edgeX = circle_.x;
+		edgeY = rect_.y2;
+	}
+	float depth = circle_.r + edgeDist;
+	Push(a_, b_, nx, ny, depth, edgeX + nx * depth * 0.5f, edgeY + ny * depth * 0.5f);
+	return true;
+}
+
+int ContactBatch::AddCirclePairs(const CollisionWorld& world_, const CollisionPair* pPairs_, int pairCount_)
+{
+	const int start = GetCount();
+	for (int i = 0; i < pairCount_; ++i)
+	{
+		const CollisionPair& pair = pPairs_[i];
+		AddCircleCircle(pair.a, world_.GetCircle(pair.a), pair.b, world_.GetCircle(pair.b));
+	}
+	return GetCount() - start;
+}
+
+void ContactBatch::SortByBody()
+{
+	const int count = GetCount();
+	m_Order.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		m_Order[i] = i;
+	}
+	const std::vector<int>& bodyA = m_BodyA;
+	const std::vector<int>& bodyB = m_BodyB;
+	std::sort(m_Order.begin(), m_Order.end(), [&](int l_, int r_)
+	{
+		if (bodyA[l_] != bodyA[r_])
+		{
+			return bodyA[l_] < bodyA[r_];
+		}
+		if (bodyB[l_] != bodyB[r_])
+		{
+			return bodyB[l_] < bodyB[r_];
+		}
+		return l_ < r_;
+	});
+
+	// Apply the permutation one cycle at a time, moving every field together.
+	for (int i = 0; i < count; ++i)
+	{
+		if (m_Order[i] < 0)
+		{
+			continue;
+		}
+		int current = i;
+		int source = m_Order[i];
+		while (source != i)
+		{
+			std::swap(m_BodyA[current], m_BodyA[source]);
+			std::swap(m_BodyB[current], m_BodyB[source]);
+			std::swap(m_NormalX[current], m_NormalX[source]);
+			std::swap(m_NormalY[current], m_NormalY[source]);
+			std::swap(m_Depth[current], m_Depth[source]);
+			std::swap(m_PointX[current], m_PointX[source]);
+			std::swap(m_PointY[current], m_PointY[source]);
+			std::swap(m_NormalImpulse[current], m_NormalImpulse[source]);
+			std::swap(m_TangentImpulse[current], m_TangentImpulse[source]);
+			m_Order[current] = -1;
+			current = source;
+			source = m_Order[source];
+		}
+		m_Order[current] = -1;
+	}
+}
+
+void ContactBatch::LoadImpulses(const ContactCache& cache_)
+{
+	for (int i = 0; i < GetCount(); ++i)
+	{
+		ContactImpulse impulse;
+		if (cache_.FindImpulse(m_BodyA[i], m_BodyB[i], &impulse))
+		{
+			m_NormalImpulse[i] = impulse.normal;
+			m_TangentImpulse[i] = impulse.tangent;
+		}
+		else
+		{
+			m_NormalImpulse[i] = 0.0f;
+			m_TangentImpulse[i] = 0.0f;
+		}
+	}
+}
+
+void ContactBatch::StoreImpulses(ContactCache* pCache_) const
+{
+	assert(pCache_ != nullptr);
+	for (int i = 0; i < GetCount(); ++i)
+	{
+		ContactImpulse impulse;
+		impulse.normal = m_NormalImpulse[i];
+		impulse.tangent = m_TangentImpulse[i];
+		pCache_->StoreImpulse(m_BodyA[i], m_BodyB[i], impulse);
+	}
+}
+
+ContactSolverSettings MakeDefaultContactSolverSettings()
+{
+	ContactSolverSettings settings;
+	settings.iterationCount = 8;
+	settings.deltaTime = 1.0f / 60.0f;
+	settings.friction = 0.2f;
+	settings.baumgarte = 0.2f;
+	settings.linearSlop = 0.005f;
+	return settings;
+}
+
+void SolveContacts(ContactBatch* pContacts_, float* pVelocityX_, float* pVelocityY_,
+	const float* pInvMass_, const ContactSolverSettings& settings_)
+{
+	assert(pContacts_ != nullptr);
+	assert(settings_.deltaTime > 0.0f);
+
+	const int count = pContacts_->GetCount();
+	const int* pBodyA = pContacts_->GetBodyA();
+	const int* pBodyB = pContacts_->GetBodyB();
+	const float* pNormalX = pContacts_->GetNormalX();
+	const float* pNormalY = pContacts_->GetNormalY();
+	const float* pDepth = pContacts_->GetDepth();
+	float* pNormalImpulse = pContacts_->GetNormalImpulse();
+	float* pTangentImpulse = pContacts_->GetTangentImpulse();
+	const float biasFactor = settings_.baumgarte / settings_.deltaTime;
+
+	// Warm start with the impulses of the previous frame.
+	for (int i = 0; i < count; ++i)
+	{
+		const int a = pBodyA[i];
+		const int b = pBodyB[i];
+		float px = pNormalX[i] * pNormalImpulse[i] - pNormalY[i] * pTangentImpulse[i];
+		float py = pNormalY[i] * pNormalImpulse[i] + pNormalX[i] * pTangentImpulse[i];
+		pVelocityX_[a] -= px * pInvMass_[a];
+		pVelocityY_[a] -= py * pInvMass_[a];
+		pVelocityX_[b] += px * pInvMass_[b];
+		pVelocityY_[b] += py * pInvMass_[b];
+	}
+
+	for (int iteration = 0; iteration < settings_.iterationCount; ++iteration)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			const int a = pBodyA[i];
+			const int b = pBodyB[i];
+			const float invMassSum = pInvMass_[a] + pInvMass_[b];
+			if (invMassSum <= 0.0f)
+			{
+				continue;
+			}
+			const float effectiveMass = 1.0f / invMassSum;
+			const float nx = pNormalX[i];
+			const float ny = pNormalY[i];
+			// The tangent is the normal turned a quarter turn counterclockwise.
+			const float tx = -ny;
+			const float ty = nx;
+
+			// Normal: the relative velocity along the normal must reach the
+			// separation speed that removes the penetration beyond the slop.
+			float rvx = pVelocityX_[b] - pVelocityX_[a];
+			float rvy = pVelocityY_[b] - pVelocityY_[a];
+			float vn = rvx * nx + rvy * ny;
+			float penetration = pDepth[i] - settings_.linearSlop;
+			float bias = penetration > 0.0f ? biasFactor * penetration : 0.0f;
+			float lambda = effectiveMass * (bias - vn);
+			float oldImpulse = pNormalImpulse[i];
+			float newImpulse = oldImpulse + lambda;
+			newImpulse = newImpulse > 0.0f ? newImpulse : 0.0f;
+			pNormalImpulse[i] = newImpulse;
+			lambda = newImpulse - oldImpulse;
+			pVelocityX_[a] -= nx * lambda * pInvMass_[a];
+			pVelocityY_[a] -= ny * lambda * pInvMass_[a];
+			pVelocityX_[b] += nx * lambda * pInvMass_[b];
+			pVelocityY_[b] += ny * lambda * pInvMass_[b];
+
+			// Friction, clamped by the normal impulse.
+			rvx = pVelocityX_[b] - pVelocityX_[a];
+			rvy = pVelocityY_[b] - pVelocityY_[a];
+			float vt = rvx * tx + rvy * ty;
+			float maxFriction = settings_.friction * newImpulse;
+			oldImpulse = pTangentImpulse[i];
+			newImpulse = oldImpulse - effectiveMass * vt;
+			newImpulse = newImpulse < -maxFriction ? -maxFriction : (newImpulse > maxFriction ? maxFriction : newImpulse);
+			pTangentImpulse[i] = newImpulse;
+			lambda = newImpulse - oldImpulse;
+			pVelocityX_[a] -= tx * lambda * pInvMass_[a];
+			pVelocityY_[a] -= ty * lambda * pInvMass_[a];
+			pVelocityX_[b] += tx * lambda * pInvMass_[b];
+			pVelocityY_[b] += ty * lambda * pInvMass_[b];
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "Circle.h"
+#include "CollisionPair.h"
+#include "Rectangle.h"
+
+class CollisionWorld;
+class ContactCache;
+
+//! Contact data for overlapping pairs, one array per field.
+//! The normal points from body a to body b, depth is the penetration along it and
+//! the point lies halfway between the two surfaces. The solver keeps its
+//! accumulated impulses next to the geometry so one pass touches one contact.
+class ContactBatch
+{
+public:
+	explicit ContactBatch(int capacity_ = 256);
+	~ContactBatch();
+
+	void Reserve(int capacity_);
+	void Clear();
+
+	//! Appends the contact between two circles if they overlap. Returns true when added.
+	bool AddCircleCircle(int a_, const Circle& circleA_, int b_, const Circle& circleB_);
+	//! Appends the contact between a circle (a) and a rectangle (b) if they overlap.
+	bool AddCircleRect(int a_, const Circle& circle_, int b_, const Rectangle& rect_);
+	//! Appends the contacts of pairs found by the world's broadphase. Returns the number added.
+	int AddCirclePairs(const CollisionWorld& world_, const CollisionPair* pPairs_, int pairCount_);
+
+	//! Orders the contacts by their first body, so the solver walks the body
+	//! velocities mostly forward.
+	void SortByBody();
+
+	//! Loads the impulses of the previous frame, contacts new to the cache start at zero.
+	void LoadImpulses(const ContactCache& cache_);
+	void StoreImpulses(ContactCache* pCache_) const;
+
+	int GetCount() const { return static_cast<int>(m_BodyA.size()); }
+	const int* GetBodyA() const { return m_BodyA.data(); }
+	const int* GetBodyB() const { return m_BodyB.data(); }
+	const float* GetNormalX() const { return m_NormalX.data(); }
+	const float* GetNormalY() const { return m_NormalY.data(); }
+	const float* GetDepth() const { return m_Depth.data(); }
+	const float* GetPointX() const { return m_PointX.data(); }
+	const float* GetPointY() const { return m_PointY.data(); }
+	float* GetNormalImpulse() { return m_NormalImpulse.data(); }
+	float* GetTangentImpulse() { return m_TangentImpulse.data(); }
+	const float* GetNormalImpulse() const { return m_NormalImpulse.data(); }
+	const float* GetTangentImpulse() const { return m_TangentImpulse.data(); }
+
+private:
+	ContactBatch(const ContactBatch&);
+	ContactBatch& operator=(const ContactBatch&);
+
+	void Push(int a_, int b_, float normalX_, float normalY_, float depth_, float pointX_, float pointY_);
+
+	std::vector<int> m_BodyA;
+	std::vector<int> m_BodyB;
+	std::vector<float> m_NormalX;
+	std::vector<float> m_NormalY;
+	std::vector<float> m_Depth;
+	std::vector<float> m_PointX;
+	std::vector<float> m_PointY;
+	std::vector<float> m_NormalImpulse;
+	std::vector<float> m_TangentImpulse;
+
+	std::vector<int> m_Order; //!< Scratch for SortByBody.
+};
+
+struct ContactSolverSettings
+{
+	int iterationCount;
+	float deltaTime;
+	float friction;
+	float baumgarte;  //!< Fraction of the penetration removed per step.
+	float linearSlop; //!< Penetration left alone, keeps resting contacts from jittering.
+};
+
+//! Default settings for a 60 Hz step.
+ContactSolverSettings MakeDefaultContactSolverSettings();
+
+//! Sequential impulse solver. Velocities and inverse masses are indexed by the
+//! body ids of the contacts, an inverse mass of 0 makes a body static.
+//! Starts from the impulses stored in the batch and leaves the accumulated ones there.
+void SolveContacts(ContactBatch* pContacts_, float* pVelocityX_, float* pVelocityY_,
+	const float* pInvMass_, const ContactSolverSettings& settings_);
@@ -0,0 +1,203 @@
+#include <cassert>
+
+#include "ContactCache.h"
+
+ContactCache::ContactCache(int capacity_)
+	: m_Capacity(capacity_)
+	, m_ContactCount(0)
+	, m_OverflowCount(0)
+	, m_Frame(0)
+{
+	assert(capacity_ > 0);
+
+	// The table is kept at most half full so probe sequences stay short.
+	int slotCount = 16;
+	while (slotCount < capacity_ * 2)
+	{
+		slotCount *= 2;
+	}
+	Slot empty;
+	empty.key = EmptyKey;
+	empty.frame = 0;
+	empty.live = -1;
+	empty.impulse.normal = 0.0f;
+	empty.impulse.tangent = 0.0f;
+	m_Slots.assign(slotCount, empty);
+	m_SlotMask = slotCount - 1;
+	m_LiveSlots.reserve(capacity_);
+
+	m_BeginEvents.reserve(capacity_);
+	m_PersistEvents.reserve(capacity_);
+	m_EndEvents.reserve(capacity_);
+}
+
+ContactCache::~ContactCache()
+{
+}
+
+void ContactCache::Update(const std::vector<CollisionPair>& pairs_)
+{
+	Update(pairs_.data(), static_cast<int>(pairs_.size()));
+}
+
+void ContactCache::Update(const CollisionPair* pPairs_, int pairCount_)
+{
+	assert(pPairs_ != nullptr || pairCount_ == 0);
+
+	++m_Frame;
+	m_BeginEvents.clear();
+	m_PersistEvents.clear();
+	m_EndEvents.clear();
+	m_OverflowCount = 0;
+
+	for (int i = 0; i < pairCount_; ++i)
+	{
+		const CollisionPair& pair = pPairs_[i];
+		const uint64_t key = MakeKey(pair.a, pair.b);
+
+		int slot = HomeOf(key);
+		while (m_Slots[slot].key != EmptyKey && m_Slots[slot].key != key)
+		{
+			slot = (slot + 1) & m_SlotMask;
+		}
+
+		Slot& entry = m_Slots[slot];
+		if (entry.key == key)
+		{
+			// A pair listed twice in one frame is only reported once.
+			if (entry.frame != m_Frame)
+			{
+				entry.frame = m_Frame;
+				m_PersistEvents.push_back(pair);
+			}
+			continue;
+		}
+
+		if (m_ContactCount == m_Capacity)
+		{
+			++m_OverflowCount;
+			continue;
+		}
+		entry.key = key;
+		entry.frame = m_Frame;
+		entry.live = static_cast<int>(m_LiveSlots.size());
+		m_LiveSlots.push_back(slot);
+		entry.impulse.normal = 0.0f;
+		entry.impulse.tangent = 0.0f;
+		++m_ContactCount;
+		m_BeginEvents.push_back(pair);
+	}
+
+	// Contacts not seen this frame have ended. They are collected first and
+	// removed afterwards, since removal moves other entries around.
+	for (int i = 0; i < static_cast<int>(m_LiveSlots.size()); ++i)
+	{
+		const Slot& entry = m_Slots[m_LiveSlots[i]];
+		if (entry.frame != m_Frame)
+		{
+			CollisionPair pair;
+			pair.a = static_cast<int>(entry.key >> 32);
+			pair.b = static_cast<int>(entry.key & 0xffffffffu);
+			m_EndEvents.push_back(pair);
+		}
+	}
+	for (int i = 0; i < GetEndCount(); ++i)
+	{
+		RemoveSlot(FindSlot(MakeKey(m_EndEvents[i].a, m_EndEvents[i].b)));
+	}
+}
+
+void ContactCache::Clear()
+{
+	Update(nullptr, 0);
+}
+
+bool ContactCache::Contains(int a_, int b_) const
+{
+	return FindSlot(MakeKey(a_, b_)) >= 0;
+}
+
+bool ContactCache::FindImpulse(int a_, int b_, ContactImpulse* pOutImpulse) const
+{
+	int slot = FindSlot(MakeKey(a_, b_));
+	if (slot < 0)
+	{
+		return false;
+	}
+	*pOutImpulse = m_Slots[slot].impulse;
+	return true;
+}
+
+void ContactCache::StoreImpulse(int a_, int b_, const ContactImpulse& impulse_)
+{
+	int slot = FindSlot(MakeKey(a_, b_));
+	if (slot >= 0)
+	{
+		m_Slots[slot].impulse = impulse_;
+	}
+}
+
+uint64_t ContactCache::MakeKey(int a_, int b_)
+{
+	uint32_t lo = static_cast<uint32_t>(a_ < b_ ? a_ : b_);
+	uint32_t hi = static_cast<uint32_t>(a_ < b_ ? b_ : a_);
+	return (static_cast<uint64_t>(lo) << 32) | hi;
+}
+
+int ContactCache::HomeOf(uint64_t key_) const
+{
+	// 64-bit finalizer of MurmurHash3, consecutive ids spread over the whole table.
+	uint64_t h = key_;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return static_cast<int>(h & static_cast<uint64_t>(m_SlotMask));
+}
+
+int ContactCache::FindSlot(uint64_t key_) const
+{
+	int slot = HomeOf(key_);
+	while (m_Slots[slot].key != EmptyKey)
+	{
+		if (m_Slots[slot].key == key_)
+		{
+			return slot;
+		}
+		slot = (slot + 1) & m_SlotMask;
+	}
+	return -1;
+}
+
+void ContactCache::RemoveSlot(int slot_)
+{
+	assert(slot_ >= 0);
+
+	const int live = m_Slots[slot_].live;
+	m_LiveSlots[live] = m_LiveSlots.back();
+	m_Slots[m_LiveSlots[live]].live = live;
+	m_LiveSlots.pop_back();
+
+	// Backward shift deletion: entries after the hole move back when their home
+	// slot allows it, so lookups never need tombstones.
+	int hole = slot_;
+	int next = (hole + 1) & m_SlotMask;
+	while (m_Slots[next].key != EmptyKey)
+	{
+		int home = HomeOf(m_Slots[next].key);
+		// Distance from the home slot to next and to the hole, along the probe direction.
+		int toNext = (next - home) & m_SlotMask;
+		int toHole = (hole - home) & m_SlotMask;
+		if (toHole < toNext)
+		{
+			m_Slots[hole] = m_Slots[next];
+			m_LiveSlots[m_Slots[hole].live] = hole;
+			hole = next;
+		}
+		next = (next + 1) & m_SlotMask;
+	}
+	m_Slots[hole].key = EmptyKey;
+	m_Slots[hole].live = -1;
+	--m_ContactCount;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "CollisionPair.h"
+
+//! Accumulated solver impulses of a contact, kept across frames to warm-start the solver.
+struct ContactImpulse
+{
+	float normal;
+	float tangent;
+};
+
+//! Remembers which pairs were touching last frame and turns the pair list of a
+//! broadphase into begin, persist and end events.
+//! Pairs live in an open addressing table with linear probing, keyed by the two
+//! body ids. All memory is allocated by the constructor: when more than
+//! capacity_ pairs touch at once the extra pairs are not tracked and only counted.
+class ContactCache
+{
+public:
+	explicit ContactCache(int capacity_ = 1024);
+	~ContactCache();
+
+	//! Feeds the pairs touching this frame, a < b as written by the broadphases.
+	//! The event arrays are replaced by the transitions since the previous call.
+	void Update(const CollisionPair* pPairs_, int pairCount_);
+	void Update(const std::vector<CollisionPair>& pairs_);
+	//! Ends every contact, they show up as end events.
+	void Clear();
+
+	const CollisionPair* GetBeginEvents() const { return m_BeginEvents.data(); }
+	int GetBeginCount() const { return static_cast<int>(m_BeginEvents.size()); }
+	const CollisionPair* GetPersistEvents() const { return m_PersistEvents.data(); }
+	int GetPersistCount() const { return static_cast<int>(m_PersistEvents.size()); }
+	const CollisionPair* GetEndEvents() const { return m_EndEvents.data(); }
+	int GetEndCount() const { return static_cast<int>(m_EndEvents.size()); }
+
+	int GetContactCount() const { return m_ContactCount; }
+	int GetCapacity() const { return m_Capacity; }
+	//! Pairs dropped by the last Update because the cache was full.
+	int GetOverflowCount() const { return m_OverflowCount; }
+
+	bool Contains(int a_, int b_) const;
+	//! Impulses stored for a live contact, zero for a contact that just began.
+	bool FindImpulse(int a_, int b_, ContactImpulse* pOutImpulse) const;
+	void StoreImpulse(int a_, int b_, const ContactImpulse& impulse_);
+
+private:
+	ContactCache(const ContactCache&);
+	ContactCache& operator=(const ContactCache&);
+
+	static const uint64_t EmptyKey = ~static_cast<uint64_t>(0);
+
+	struct Slot
+	{
+		uint64_t key;
+		uint32_t frame; //!< Last Update that saw the pair.
+		int live;       //!< Index of the slot in m_LiveSlots.
+		ContactImpulse impulse;
+	};
+
+	static uint64_t MakeKey(int a_, int b_);
+	int HomeOf(uint64_t key_) const;
+	int FindSlot(uint64_t key_) const;
+	void RemoveSlot(int slot_);
+
+	std::vector<Slot> m_Slots;
+	//! Occupied slots in no particular order, so Update walks the contacts
+	//! instead of the whole table. Removal swaps the last one into the gap.
+	std::vector<int> m_LiveSlots;
+	int m_SlotMask;
+	int m_Capacity;
+	int m_ContactCount;
+	int m_OverflowCount;
+	uint32_t m_Frame;
+
+	std::vector<CollisionPair> m_BeginEvents;
+	std::vector<CollisionPair> m_PersistEvents;
+	std::vector<CollisionPair> m_EndEvents;
+};
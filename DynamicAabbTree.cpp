@@ -0,0 +1,478 @@
+#include <cmath>
+
+#include "DynamicAabbTree.h"
+
+DynamicAabbTree::DynamicAabbTree(int nodeCapacity_, float margin_)
+	: m_Root(NullNode)
+	, m_FreeList(NullNode)
+	, m_ProxyCount(0)
+	, m_Margin(margin_)
+{
+	m_Nodes.reserve(nodeCapacity_ > 0 ? nodeCapacity_ : 1);
+}
+
+DynamicAabbTree::~DynamicAabbTree()
+{
+}
+
+int DynamicAabbTree::CreateProxy(const Circle& circle_, int userData_)
+{
+	int leaf = CreateLeaf(ShapeType_Circle, userData_);
+	m_Nodes[leaf].circle = circle_;
+	m_Nodes[leaf].aabb = AabbInflate(MakeAabb(circle_), m_Margin);
+	InsertLeaf(leaf);
+	return leaf;
+}
+
+int DynamicAabbTree::CreateProxy(const Rectangle& rect_, int userData_)
+{
+	int leaf = CreateLeaf(ShapeType_Rectangle, userData_);
+	m_Nodes[leaf].rect = rect_;
+	m_Nodes[leaf].aabb = AabbInflate(MakeAabb(rect_), m_Margin);
+	InsertLeaf(leaf);
+	return leaf;
+}
+
+void DynamicAabbTree::DestroyProxy(int proxyId_)
+{
+	assert(0 <= proxyId_ && proxyId_ < static_cast<int>(m_Nodes.size()) && m_Nodes[proxyId_].IsLeaf());
+	RemoveLeaf(proxyId_);
+	FreeNode(proxyId_);
+	--m_ProxyCount;
+}
+
+bool DynamicAabbTree::MoveProxy(int proxyId_, const Circle& circle_)
+{
+	assert(GetShapeType(proxyId_) == ShapeType_Circle);
+	m_Nodes[proxyId_].circle = circle_;
+	return UpdateLeaf(proxyId_);
+}
+
+bool DynamicAabbTree::MoveProxy(int proxyId_, const Rectangle& rect_)
+{
+	assert(GetShapeType(proxyId_) == ShapeType_Rectangle);
+	m_Nodes[proxyId_].rect = rect_;
+	return UpdateLeaf(proxyId_);
+}
+
+DynamicAabbTree::ShapeType DynamicAabbTree::GetShapeType(int proxyId_) const
+{
+	assert(0 <= proxyId_ && proxyId_ < static_cast<int>(m_Nodes.size()) && m_Nodes[proxyId_].height == 0);
+	return m_Nodes[proxyId_].type;
+}
+
+const Circle& DynamicAabbTree::GetCircle(int proxyId_) const
+{
+	assert(GetShapeType(proxyId_) == ShapeType_Circle);
+	return m_Nodes[proxyId_].circle;
+}
+
+const Rectangle& DynamicAabbTree::GetRectangle(int proxyId_) const
+{
+	assert(GetShapeType(proxyId_) == ShapeType_Rectangle);
+	return m_Nodes[proxyId_].rect;
+}
+
+int DynamicAabbTree::GetUserData(int proxyId_) const
+{
+	return m_Nodes[proxyId_].userData;
+}
+
+const Aabb& DynamicAabbTree::GetFatAabb(int proxyId_) const
+{
+	return m_Nodes[proxyId_].aabb;
+}
+
+int DynamicAabbTree::GetHeight() const
+{
+	return m_Root == NullNode ? 0 : m_Nodes[m_Root].height;
+}
+
+bool DynamicAabbTree::TestOverlap(int proxyId_, const Circle& circle_) const
+{
+	const Node& node = m_Nodes[proxyId_];
+	if (node.type == ShapeType_Circle)
+	{
+		Circle circle = node.circle;
+		return circle.Collide(circle_);
+	}
+	return node.rect.Collide(circle_);
+}
+
+int DynamicAabbTree::FindPairs(std::vector<CollisionPair>* pOutPairs) const
+{
+	assert(pOutPairs != nullptr);
+	pOutPairs->clear();
+
+	// Every leaf queries the tree with its own bounds and keeps the partners with a
+	// higher id, so each pair is found once.
+	for (int i = 0; i < static_cast<int>(m_Nodes.size()); ++i)
+	{
+		const Node& leaf = m_Nodes[i];
+		if (leaf.height != 0)
+		{
+			continue;
+		}
+		QueryRegion(leaf.aabb, [&](int other_) -> bool
+		{
+			if (other_ > i && ShapesOverlap(leaf, m_Nodes[other_]))
+			{
+				CollisionPair pair;
+				pair.a = i;
+				pair.b = other_;
+				pOutPairs->push_back(pair);
+			}
+			return true;
+		});
+	}
+
+	return static_cast<int>(pOutPairs->size());
+}
+
+bool DynamicAabbTree::RayAabb(float x_, float y_, float dx_, float dy_, float maxFraction_, const Aabb& aabb_, float* pOutFraction)
+{
+	float tEnter = 0.0f;
+	float tExit = maxFraction_;
+
+	const float p[2] = { x_, y_ };
+	const float d[2] = { dx_, dy_ };
+	const float lo[2] = { aabb_.minX, aabb_.minY };
+	const float hi[2] = { aabb_.maxX, aabb_.maxY };
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (d[axis] == 0.0f)
+		{
+			if (p[axis] < lo[axis] || hi[axis] < p[axis])
+			{
+				return false;
+			}
+			continue;
+		}
+		float inv = 1.0f / d[axis];
+		float t0 = (lo[axis] - p[axis]) * inv;
+		float t1 = (hi[axis] - p[axis]) * inv;
+		if (t0 > t1)
+		{
+			float tmp = t0;
+			t0 = t1;
+			t1 = tmp;
+		}
+		tEnter = t0 > tEnter ? t0 : tEnter;
+		tExit = t1 < tExit ? t1 : tExit;
+		if (tEnter > tExit)
+		{
+			return false;
+		}
+	}
+
+	*pOutFraction = tEnter;
+	return true;
+}
+
+bool DynamicAabbTree::RayShape(const Node& node_, float x_, float y_, float dx_, float dy_, float maxFraction_, float* pOutFraction)
+{
+	if (node_.type == ShapeType_Rectangle)
+	{
+		const Rectangle& rect = node_.rect;
+		return RayAabb(x_, y_, dx_, dy_, maxFraction_, MakeAabb(rect), pOutFraction);
+	}
+
+	const Circle& circle = node_.circle;
+	float mx = x_ - circle.x;
+	float my = y_ - circle.y;
+	float c = mx * mx + my * my - circle.r * circle.r;
+	if (c <= 0.0f)
+	{
+		// The segment starts inside the circle.
+		*pOutFraction = 0.0f;
+		return true;
+	}
+	float a = dx_ * dx_ + dy_ * dy_;
+	float b = mx * dx_ + my * dy_;
+	float disc = b * b - a * c;
+	if (a <= 0.0f || b >= 0.0f || disc < 0.0f)
+	{
+		return false;
+	}
+	float t = (-b - std::sqrt(disc)) / a;
+	if (t > maxFraction_)
+	{
+		return false;
+	}
+	*pOutFraction = t;
+	return true;
+}
+
+bool DynamicAabbTree::ShapesOverlap(const Node& a_, const Node& b_)
+{
+	if (a_.type == ShapeType_Circle && b_.type == ShapeType_Circle)
+	{
+		Circle circle = a_.circle;
+		return circle.Collide(b_.circle);
+	}
+	if (a_.type == ShapeType_Rectangle && b_.type == ShapeType_Rectangle)
+	{
+		return a_.rect.Overlap(b_.rect);
+	}
+	return a_.type == ShapeType_Rectangle ? a_.rect.Collide(b_.circle) : b_.rect.Collide(a_.circle);
+}
+
+Aabb DynamicAabbTree::ShapeAabb(const Node& node_)
+{
+	return node_.type == ShapeType_Circle ? MakeAabb(node_.circle) : MakeAabb(node_.rect);
+}
+
+int DynamicAabbTree::AllocateNode()
+{
+	if (m_FreeList == NullNode)
+	{
+		// Grow the pool and thread the new nodes onto the free list.
+		int oldCount = static_cast<int>(m_Nodes.size());
+		int newCount = oldCount > 0 ? oldCount * 2 : 16;
+		m_Nodes.resize(newCount);
+		for (int i = oldCount; i < newCount; ++i)
+		{
+			m_Nodes[i].parent = i + 1 < newCount ? i + 1 : NullNode;
+			m_Nodes[i].height = -1;
+		}
+		m_FreeList = oldCount;
+	}
+
+	int nodeId = m_FreeList;
+	Node& node = m_Nodes[nodeId];
+	m_FreeList = node.parent;
+	node.parent = NullNode;
+	node.child1 = NullNode;
+	node.child2 = NullNode;
+	node.height = 0;
+	node.userData = 0;
+	return nodeId;
+}
+
+void DynamicAabbTree::FreeNode(int nodeId_)
+{
+	m_Nodes[nodeId_].parent = m_FreeList;
+	m_Nodes[nodeId_].height = -1;
+	m_FreeList = nodeId_;
+}
+
+int DynamicAabbTree::CreateLeaf(ShapeType type_, int userData_)
+{
+	int leaf = AllocateNode();
+	m_Nodes[leaf].type = type_;
+	m_Nodes[leaf].userData = userData_;
+	++m_ProxyCount;
+	return leaf;
+}
+
+bool DynamicAabbTree::UpdateLeaf(int leaf_)
+{
+	Aabb aabb = ShapeAabb(m_Nodes[leaf_]);
+	if (AabbContains(m_Nodes[leaf_].aabb, aabb))
+	{
+		// Still inside the fat bounds, the tree does not change.
+		return false;
+	}
+
+	RemoveLeaf(leaf_);
+	m_Nodes[leaf_].aabb = AabbInflate(aabb, m_Margin);
+	InsertLeaf(leaf_);
+	return true;
+}
+
+void DynamicAabbTree::InsertLeaf(int leaf_)
+{
+	if (m_Root == NullNode)
+	{
+		m_Root = leaf_;
+		m_Nodes[leaf_].parent = NullNode;
+		return;
+	}
+
+	// Walk down to the sibling that makes the tree grow the least, using the
+	// surface area heuristic (perimeter in 2D).
+	const Aabb leafAabb = m_Nodes[leaf_].aabb;
+	int index = m_Root;
+	while (!m_Nodes[index].IsLeaf())
+	{
+		const Node& node = m_Nodes[index];
+		float area = AabbHalfPerimeter(node.aabb);
+		float combinedArea = AabbHalfPerimeter(AabbUnion(node.aabb, leafAabb));
+
+		// Cost of making a new parent for this node and the leaf.
+		float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down.
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		const int children[2] = { node.child1, node.child2 };
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = m_Nodes[children[c]];
+			float unionArea = AabbHalfPerimeter(AabbUnion(child.aabb, leafAabb));
+			childCost[c] = child.IsLeaf()
+				? unionArea + inheritanceCost
+				: unionArea - AabbHalfPerimeter(child.aabb) + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+		{
+			break;
+		}
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	const int sibling = index;
+	const int oldParent = m_Nodes[sibling].parent;
+	const int newParent = AllocateNode();
+	m_Nodes[newParent].parent = oldParent;
+	m_Nodes[newParent].aabb = AabbUnion(leafAabb, m_Nodes[sibling].aabb);
+	m_Nodes[newParent].height = m_Nodes[sibling].height + 1;
+	m_Nodes[newParent].child1 = sibling;
+	m_Nodes[newParent].child2 = leaf_;
+	m_Nodes[sibling].parent = newParent;
+	m_Nodes[leaf_].parent = newParent;
+
+	if (oldParent != NullNode)
+	{
+		if (m_Nodes[oldParent].child1 == sibling)
+		{
+			m_Nodes[oldParent].child1 = newParent;
+		}
+		else
+		{
+			m_Nodes[oldParent].child2 = newParent;
+		}
+	}
+	else
+	{
+		m_Root = newParent;
+	}
+
+	RefitFrom(m_Nodes[leaf_].parent);
+}
+
+void DynamicAabbTree::RemoveLeaf(int leaf_)
+{
+	if (leaf_ == m_Root)
+	{
+		m_Root = NullNode;
+		return;
+	}
+
+	// The sibling takes the place of the parent.
+	const int parent = m_Nodes[leaf_].parent;
+	const int grandParent = m_Nodes[parent].parent;
+	const int sibling = m_Nodes[parent].child1 == leaf_ ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+	if (grandParent != NullNode)
+	{
+		if (m_Nodes[grandParent].child1 == parent)
+		{
+			m_Nodes[grandParent].child1 = sibling;
+		}
+		else
+		{
+			m_Nodes[grandParent].child2 = sibling;
+		}
+		m_Nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		RefitFrom(grandParent);
+	}
+	else
+	{
+		m_Root = sibling;
+		m_Nodes[sibling].parent = NullNode;
+		FreeNode(parent);
+	}
+}
+
+void DynamicAabbTree::RefitFrom(int nodeId_)
+{
+	// Walk back to the root, rebalancing and refitting every ancestor.
+	int index = nodeId_;
+	while (index != NullNode)
+	{
+		index = Balance(index);
+
+		Node& node = m_Nodes[index];
+		const Node& child1 = m_Nodes[node.child1];
+		const Node& child2 = m_Nodes[node.child2];
+		node.height = 1 + (child1.height > child2.height ? child1.height : child2.height);
+		node.aabb = AabbUnion(child1.aabb, child2.aabb);
+
+		index = node.parent;
+	}
+}
+
+int DynamicAabbTree::Balance(int iA_)
+{
+	// Rotates the taller grandchild up when the children of A differ in height by
+	// more than one. Returns the node now at A's position.
+	Node& a = m_Nodes[iA_];
+	if (a.IsLeaf() || a.height < 2)
+	{
+		return iA_;
+	}
+
+	const int iB = a.child1;
+	const int iC = a.child2;
+	const int balance = m_Nodes[iC].height - m_Nodes[iB].height;
+	if (balance >= -1 && balance <= 1)
+	{
+		return iA_;
+	}
+
+	// Promote the taller child (up) and move A down beside its taller grandchild.
+	const int iUp = balance > 1 ? iC : iB;
+	const int iStay = balance > 1 ? iB : iC;
+	Node& up = m_Nodes[iUp];
+	const int iF = up.child1;
+	const int iG = up.child2;
+	Node& f = m_Nodes[iF];
+	Node& g = m_Nodes[iG];
+
+	up.child1 = iA_;
+	up.parent = a.parent;
+	a.parent = iUp;
+
+	if (up.parent != NullNode)
+	{
+		if (m_Nodes[up.parent].child1 == iA_)
+		{
+			m_Nodes[up.parent].child1 = iUp;
+		}
+		else
+		{
+			m_Nodes[up.parent].child2 = iUp;
+		}
+	}
+	else
+	{
+		m_Root = iUp;
+	}
+
+	// The taller grandchild stays under up, the shorter one replaces up under A.
+	const int iHigh = f.height > g.height ? iF : iG;
+	const int iLow = f.height > g.height ? iG : iF;
+	up.child2 = iHigh;
+	if (balance > 1)
+	{
+		a.child2 = iLow;
+	}
+	else
+	{
+		a.child1 = iLow;
+	}
+	m_Nodes[iLow].parent = iA_;
+
+	const Node& stay = m_Nodes[iStay];
+	const Node& low = m_Nodes[iLow];
+	const Node& high = m_Nodes[iHigh];
+	a.aabb = AabbUnion(stay.aabb, low.aabb);
+	a.height = 1 + (stay.height > low.height ? stay.height : low.height);
+	up.aabb = AabbUnion(a.aabb, high.aabb);
+	up.height = 1 + (a.height > high.height ? a.height : high.height);
+
+	return iUp;
+}
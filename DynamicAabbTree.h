@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "Aabb.h"
+#include "Circle.h"
+#include "CollisionPair.h"
+#include "Rectangle.h"
+
+//! Dynamic bounding volume hierarchy for scenes mixing Circle and Rectangle shapes
+//! of very different sizes, where a uniform grid degrades.
+//! Leaves store the shape and a fattened AABB, so small movements only touch the
+//! leaf and larger ones reinsert it. Inserts and removals rebalance the tree with
+//! rotations, keeping region queries and ray casts at O(log n).
+//! Nodes come from a pool that only grows when it runs out, there is no heap
+//! traffic per insert once it has reached its working size.
+class DynamicAabbTree
+{
+public:
+	static const int NullNode = -1;
+
+	enum ShapeType
+	{
+		ShapeType_Circle,
+		ShapeType_Rectangle
+	};
+
+	//! margin_ is how far the leaf bounds are fattened on every side.
+	explicit DynamicAabbTree(int nodeCapacity_ = 256, float margin_ = 0.1f);
+	~DynamicAabbTree();
+
+	int CreateProxy(const Circle& circle_, int userData_ = 0);
+	int CreateProxy(const Rectangle& rect_, int userData_ = 0);
+	void DestroyProxy(int proxyId_);
+
+	//! Updates the shape. Returns true when it left its fat bounds and was reinserted.
+	bool MoveProxy(int proxyId_, const Circle& circle_);
+	bool MoveProxy(int proxyId_, const Rectangle& rect_);
+
+	ShapeType GetShapeType(int proxyId_) const;
+	const Circle& GetCircle(int proxyId_) const;
+	const Rectangle& GetRectangle(int proxyId_) const;
+	int GetUserData(int proxyId_) const;
+	const Aabb& GetFatAabb(int proxyId_) const;
+
+	int GetProxyCount() const { return m_ProxyCount; }
+	int GetHeight() const;
+
+	//! Calls callback_(proxyId) for every leaf whose fat bounds overlap aabb_.
+	//! The callback returns false to stop the query.
+	template <typename TCallback>
+	void QueryRegion(const Aabb& aabb_, TCallback callback_) const
+	{
+		int stack[StackCapacity];
+		int top = 0;
+		if (m_Root != NullNode)
+		{
+			stack[top++] = m_Root;
+		}
+		while (top > 0)
+		{
+			const int id = stack[--top];
+			const Node& node = m_Nodes[id];
+			if (!AabbOverlap(node.aabb, aabb_))
+			{
+				continue;
+			}
+			if (node.IsLeaf())
+			{
+				if (!callback_(id))
+				{
+					return;
+				}
+			}
+			else
+			{
+				assert(top + 2 <= StackCapacity);
+				stack[top++] = node.child1;
+				stack[top++] = node.child2;
+			}
+		}
+	}
+
+	//! Like QueryRegion, but only reports shapes that really overlap circle_, for sensing radii.
+	template <typename TCallback>
+	void QueryCircle(const Circle& circle_, TCallback callback_) const
+	{
+		const DynamicAabbTree* pTree = this;
+		QueryRegion(MakeAabb(circle_), [&](int id_) -> bool
+		{
+			return !pTree->TestOverlap(id_, circle_) || callback_(id_);
+		});
+	}
+
+	//! Casts the segment (x1_, y1_) - (x2_, y2_) against the exact shapes.
+	//! callback_(proxyId, fraction) gets every hit with its fraction along the segment
+	//! and returns the new maximum fraction: the hit fraction to find the closest hit,
+	//! the current maximum to collect all hits, or 0 to stop.
+	template <typename TCallback>
+	void RayCast(float x1_, float y1_, float x2_, float y2_, TCallback callback_) const
+	{
+		const float dx = x2_ - x1_;
+		const float dy = y2_ - y1_;
+		float maxFraction = 1.0f;
+
+		int stack[StackCapacity];
+		int top = 0;
+		if (m_Root != NullNode)
+		{
+			stack[top++] = m_Root;
+		}
+		while (top > 0)
+		{
+			const int id = stack[--top];
+			const Node& node = m_Nodes[id];
+			float fraction;
+			if (!RayAabb(x1_, y1_, dx, dy, maxFraction, node.aabb, &fraction))
+			{
+				continue;
+			}
+			if (node.IsLeaf())
+			{
+				if (!RayShape(node, x1_, y1_, dx, dy, maxFraction, &fraction))
+				{
+					continue;
+				}
+				float value = callback_(id, fraction);
+				if (value <= 0.0f)
+				{
+					return;
+				}
+				maxFraction = value < maxFraction ? value : maxFraction;
+			}
+			else
+			{
+				assert(top + 2 <= StackCapacity);
+				stack[top++] = node.child1;
+				stack[top++] = node.child2;
+			}
+		}
+	}
+
+	//! Exact shape test between a proxy and a circle.
+	bool TestOverlap(int proxyId_, const Circle& circle_) const;
+
+	//! Writes every pair of proxies whose shapes overlap. Returns the number of pairs.
+	int FindPairs(std::vector<CollisionPair>* pOutPairs) const;
+
+private:
+	static const int StackCapacity = 256;
+
+	struct Node
+	{
+		Aabb aabb;       //!< Fat bounds for leaves, union of the children otherwise.
+		int parent;      //!< Next free node while the node is in the free list.
+		int child1;
+		int child2;
+		int height;      //!< 0 for leaves, -1 for free nodes.
+		ShapeType type;
+		int userData;
+		Circle circle;
+		Rectangle rect;
+
+		bool IsLeaf() const { return child1 == NullNode; }
+	};
+
+	static bool RayAabb(float x_, float y_, float dx_, float dy_, float maxFraction_, const Aabb& aabb_, float* pOutFraction);
+	static bool RayShape(const Node& node_, float x_, float y_, float dx_, float dy_, float maxFraction_, float* pOutFraction);
+	static bool ShapesOverlap(const Node& a_, const Node& b_);
+	static Aabb ShapeAabb(const Node& node_);
+
+	int AllocateNode();
+	void FreeNode(int nodeId_);
+	int CreateLeaf(ShapeType type_, int userData_);
+	bool UpdateLeaf(int leaf_);
+	void InsertLeaf(int leaf_);
+	void RemoveLeaf(int leaf_);
+	int Balance(int nodeId_);
+	void RefitFrom(int nodeId_);
+
+	std::vector<Node> m_Nodes;
+	int m_Root;
+	int m_FreeList;
+	int m_ProxyCount;
+	float m_Margin;
+};
@@ -0,0 +1,310 @@
+#include "EffectChain.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    namespace {
+
+        using SimdUtil::Vec;
+
+        // p[i] *= start + step * (i + 1).
+        void ScaleRamp(float* p, int count, float start, float step)
+        {
+            alignas(SimdUtil::Alignment) static const float FrameOffsets[SimdUtil::MaxLaneCount] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+            const Vec startVec = SimdUtil::Set(start);
+            const Vec stepVec = SimdUtil::Set(step);
+            const Vec laneCount = SimdUtil::Set(static_cast<float>(SimdUtil::LaneCount));
+            Vec frame = SimdUtil::Load(FrameOffsets);
+            int i = 0;
+            for (; i + SimdUtil::LaneCount <= count; i += SimdUtil::LaneCount)
+            {
+                const Vec gain = SimdUtil::Add(startVec, SimdUtil::Mul(stepVec, frame));
+                SimdUtil::StoreUnaligned(p + i, SimdUtil::Mul(SimdUtil::LoadUnaligned(p + i), gain));
+                frame = SimdUtil::Add(frame, laneCount);
+            }
+            for (; i < count; ++i)
+            {
+                p[i] *= start + step * static_cast<float>(i + 1);
+            }
+        }
+
+        // pOut[i] += pIn[i] * (start + step * (i + 1)).
+        void AddRamp(float* pOut, const float* pIn, int count, float start, float step)
+        {
+            alignas(SimdUtil::Alignment) static const float FrameOffsets[SimdUtil::MaxLaneCount] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+            const Vec startVec = SimdUtil::Set(start);
+            const Vec stepVec = SimdUtil::Set(step);
+            const Vec laneCount = SimdUtil::Set(static_cast<float>(SimdUtil::LaneCount));
+            Vec frame = SimdUtil::Load(FrameOffsets);
+            int i = 0;
+            for (; i + SimdUtil::LaneCount <= count; i += SimdUtil::LaneCount)
+            {
+                const Vec gain = SimdUtil::Add(startVec, SimdUtil::Mul(stepVec, frame));
+                const Vec sum = SimdUtil::Add(SimdUtil::LoadUnaligned(pOut + i), SimdUtil::Mul(SimdUtil::LoadUnaligned(pIn + i), gain));
+                SimdUtil::StoreUnaligned(pOut + i, sum);
+                frame = SimdUtil::Add(frame, laneCount);
+            }
+            for (; i < count; ++i)
+            {
+                pOut[i] += pIn[i] * (start + step * static_cast<float>(i + 1));
+            }
+        }
+
+        int GetLatency(EffectType type)
+        {
+            return type == EffectType_Compressor ? Compressor::LookaheadFrameCount : 0;
+        }
+
+    }
+
+    EffectChain::EffectChain(int slotCountMax)
+        : m_Slots(slotCountMax)
+        , m_SlotCount(0)
+    {
+        assert(slotCountMax > 0);
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            m_pDry[ch] = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * (EffectFrameCountMax + LatencyFrameCountMax)));
+            assert(m_pDry[ch] != nullptr);
+        }
+    }
+
+    EffectChain::~EffectChain()
+    {
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            SimdUtil::AlignedFree(m_pDry[ch]);
+        }
+    }
+
+    int EffectChain::Add(Equalizer* pEqualizer)
+    {
+        return AddSlot(EffectType_Equalizer, pEqualizer);
+    }
+
+    int EffectChain::Add(Compressor* pCompressor)
+    {
+        return AddSlot(EffectType_Compressor, pCompressor);
+    }
+
+    int EffectChain::Add(Delay* pDelay)
+    {
+        return AddSlot(EffectType_Delay, pDelay);
+    }
+
+    int EffectChain::Add(Reverb* pReverb)
+    {
+        return AddSlot(EffectType_Reverb, pReverb);
+    }
+
+    int EffectChain::AddSlot(EffectType type, void* pEffect)
+    {
+        assert(pEffect != nullptr);
+        if (m_SlotCount == static_cast<int>(m_Slots.size()))
+        {
+            return InvalidSlot;
+        }
+        const int slot = m_SlotCount++;
+        Slot& s = m_Slots[slot];
+        s.type = type;
+        s.pEffect = pEffect;
+        s.mix = 1.0f;
+        s.targetMix = 1.0f;
+        s.latency = GetLatency(type);
+        std::memset(s.history, 0, sizeof(s.history));
+        s.blockCount.store(0, std::memory_order_relaxed);
+        s.lastBlockNanoSeconds.store(0, std::memory_order_relaxed);
+        s.peakBlockNanoSeconds.store(0, std::memory_order_relaxed);
+        s.totalNanoSeconds.store(0, std::memory_order_relaxed);
+        return slot;
+    }
+
+    void EffectChain::SetEnabled(int slot, bool isEnabled)
+    {
+        assert(0 <= slot && slot < m_SlotCount);
+        m_Slots[slot].targetMix = isEnabled ? 1.0f : 0.0f;
+    }
+
+    bool EffectChain::IsEnabled(int slot) const
+    {
+        assert(0 <= slot && slot < m_SlotCount);
+        return m_Slots[slot].targetMix != 0.0f;
+    }
+
+    EffectType EffectChain::GetType(int slot) const
+    {
+        assert(0 <= slot && slot < m_SlotCount);
+        return m_Slots[slot].type;
+    }
+
+    void EffectChain::ResetEffect(Slot* pSlot)
+    {
+        switch (pSlot->type)
+        {
+        case EffectType_Equalizer:
+            static_cast<Equalizer*>(pSlot->pEffect)->Reset();
+            break;
+        case EffectType_Compressor:
+            static_cast<Compressor*>(pSlot->pEffect)->Reset();
+            break;
+        case EffectType_Delay:
+            static_cast<Delay*>(pSlot->pEffect)->Reset();
+            break;
+        case EffectType_Reverb:
+            static_cast<Reverb*>(pSlot->pEffect)->Reset();
+            break;
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+    // Fills m_pDry with the input delayed by the latency of the effect and keeps the frames
+    // the delay holds back for the next block.
+    void EffectChain::LoadDry(Slot* pSlot, float* const* pChannels, int frameCount)
+    {
+        const int latency = pSlot->latency;
+        for (int ch = 0; ch < EffectChannelCount; ++ch)
+        {
+            std::memcpy(m_pDry[ch], pSlot->history[ch], sizeof(float) * latency);
+            std::memcpy(m_pDry[ch] + latency, pChannels[ch], sizeof(float) * frameCount);
+            std::memcpy(pSlot->history[ch], m_pDry[ch] + frameCount, sizeof(float) * latency);
+        }
+    }
+
+    void EffectChain::ProcessEffect(Slot* pSlot, float* const* pChannels, int frameCount)
+    {
+        switch (pSlot->type)
+        {
+        case EffectType_Equalizer:
+            static_cast<Equalizer*>(pSlot->pEffect)->Process(pChannels, frameCount);
+            break;
+        case EffectType_Compressor:
+            static_cast<Compressor*>(pSlot->pEffect)->Process(pChannels, frameCount);
+            break;
+        case EffectType_Delay:
+            static_cast<Delay*>(pSlot->pEffect)->Process(pChannels, frameCount);
+            break;
+        case EffectType_Reverb:
+            static_cast<Reverb*>(pSlot->pEffect)->Process(pChannels, frameCount);
+            break;
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+    void EffectChain::Process(float* const* pChannels, int frameCount)
+    {
+        assert(pChannels != nullptr);
+        assert(0 < frameCount && frameCount <= EffectFrameCountMax);
+
+        for (int slot = 0; slot < m_SlotCount; ++slot)
+        {
+            Slot& s = m_Slots[slot];
+            if (s.mix == 0.0f && s.targetMix == 0.0f)
+            {
+                if (s.latency > 0)
+                {
+                    LoadDry(&s, pChannels, frameCount);
+                    for (int ch = 0; ch < EffectChannelCount; ++ch)
+                    {
+                        std::memcpy(pChannels[ch], m_pDry[ch], sizeof(float) * frameCount);
+                    }
+                }
+                continue;
+            }
+
+            const int64_t startTime = GetTime();
+            if (s.mix == 1.0f && s.targetMix == 1.0f)
+            {
+                if (s.latency > 0)
+                {
+                    // Only to keep the history for when the effect fades out.
+                    LoadDry(&s, pChannels, frameCount);
+                }
+                ProcessEffect(&s, pChannels, frameCount);
+            }
+            else
+            {
+                const float step = (s.targetMix - s.mix) / frameCount;
+                const bool isFadingIn = s.mix == 0.0f;
+                if (isFadingIn)
+                {
+                    ResetEffect(&s);
+                    if (s.latency > 0)
+                    {
+                        // Prime the lookahead with the frames the dry signal still holds, so the
+                        // effect plays in step with it from the first frame.
+                        float* pPrime[EffectChannelCount];
+                        for (int ch = 0; ch < EffectChannelCount; ++ch)
+                        {
+                            std::memcpy(m_pDry[ch], s.history[ch], sizeof(float) * s.latency);
+                            pPrime[ch] = m_pDry[ch];
+                        }
+                        ProcessEffect(&s, pPrime, s.latency);
+                    }
+                }
+                LoadDry(&s, pChannels, frameCount);
+
+                // An effect that adds no latency gets its input faded in, so whatever it builds
+                // up, an echo or a tail, starts from silence. Others and effects going away fade
+                // their output.
+                if (isFadingIn && s.latency == 0)
+                {
+                    for (int ch = 0; ch < EffectChannelCount; ++ch)
+                    {
+                        ScaleRamp(pChannels[ch], frameCount, s.mix, step);
+                    }
+                    ProcessEffect(&s, pChannels, frameCount);
+                }
+                else
+                {
+                    ProcessEffect(&s, pChannels, frameCount);
+                    for (int ch = 0; ch < EffectChannelCount; ++ch)
+                    {
+                        ScaleRamp(pChannels[ch], frameCount, s.mix, step);
+                    }
+                }
+                for (int ch = 0; ch < EffectChannelCount; ++ch)
+                {
+                    AddRamp(pChannels[ch], m_pDry[ch], frameCount, 1.0f - s.mix, -step);
+                }
+                s.mix = s.targetMix;
+            }
+            const int cost = static_cast<int>(GetTime() - startTime);
+
+            s.lastBlockNanoSeconds.store(cost, std::memory_order_relaxed);
+            if (cost > s.peakBlockNanoSeconds.load(std::memory_order_relaxed))
+            {
+                s.peakBlockNanoSeconds.store(cost, std::memory_order_relaxed);
+            }
+            s.totalNanoSeconds.store(s.totalNanoSeconds.load(std::memory_order_relaxed) + cost, std::memory_order_relaxed);
+            s.blockCount.store(s.blockCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+    EffectStats EffectChain::GetStats(int slot) const
+    {
+        assert(0 <= slot && slot < m_SlotCount);
+        const Slot& s = m_Slots[slot];
+        EffectStats stats;
+        stats.blockCount = s.blockCount.load(std::memory_order_acquire);
+        stats.lastBlockNanoSeconds = s.lastBlockNanoSeconds.load(std::memory_order_relaxed);
+        stats.peakBlockNanoSeconds = s.peakBlockNanoSeconds.load(std::memory_order_relaxed);
+        const int64_t total = s.totalNanoSeconds.load(std::memory_order_relaxed);
+        stats.averageBlockNanoSeconds = stats.blockCount == 0 ? 0 : static_cast<int>(total / stats.blockCount);
+        return stats;
+    }
+
+    int64_t EffectChain::GetTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+}
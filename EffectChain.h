@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "AudioEffects.h"
+
+namespace AUS {
+
+    enum EffectType
+    {
+        EffectType_Equalizer,
+        EffectType_Compressor,
+        EffectType_Delay,
+        EffectType_Reverb
+    };
+
+    // What one effect of a chain costs. Bypassed blocks are not counted.
+    // At the 1020 MHz of the device CPU a nanosecond is about one cycle.
+    struct EffectStats
+    {
+        int blockCount;              // Blocks the effect ran on.
+        int lastBlockNanoSeconds;    // Cost of the last block.
+        int peakBlockNanoSeconds;    // Worst block since the chain was made.
+        int averageBlockNanoSeconds;
+    };
+
+    // Runs a row of effects over blocks of planar stereo, in the order they were added.
+    //
+    // Any effect can be switched on or off while the chain plays. An effect coming back starts
+    // from a clean state and its input fades in over the next block, so a delay or a reverb
+    // builds its tail from silence; one going away cross fades to the dry signal over the next
+    // block. A bypassed effect costs nothing, except that the lookahead of a compressor is still
+    // applied to the dry signal, so switching it never moves the audio in time.
+    // Every effect is timed on its own, so its stats show what each insert costs.
+    //
+    // The chain is not thread safe, drive it from the audio thread. GetStats is safe anywhere.
+    class EffectChain
+    {
+    public:
+        static const int InvalidSlot = -1;
+
+        explicit EffectChain(int slotCountMax);
+        ~EffectChain();
+
+        // The effects stay owned by the caller and start enabled. Add them before the chain
+        // plays. Returns InvalidSlot when the chain is full.
+        int Add(Equalizer* pEqualizer);
+        int Add(Compressor* pCompressor);
+        int Add(Delay* pDelay);
+        int Add(Reverb* pReverb);
+
+        void SetEnabled(int slot, bool isEnabled);
+        bool IsEnabled(int slot) const;
+        EffectType GetType(int slot) const;
+        int GetSlotCount() const { return m_SlotCount; }
+
+        // Runs every enabled effect in place. frameCount is at most EffectFrameCountMax.
+        void Process(float* const* pChannels, int frameCount);
+
+        EffectStats GetStats(int slot) const;
+
+    private:
+        EffectChain(const EffectChain&);
+        EffectChain& operator=(const EffectChain&);
+
+        // The most latency an effect adds, the lookahead of a compressor.
+        static const int LatencyFrameCountMax = Compressor::LookaheadFrameCount;
+
+        struct Slot
+        {
+            EffectType type;
+            void* pEffect;
+            float mix;       // 0 bypassed, 1 fully on.
+            float targetMix;
+            int latency;     // Frames the effect delays the signal by.
+            float history[EffectChannelCount][LatencyFrameCountMax]; // The last latency frames of input.
+
+            // Stats the audio thread publishes.
+            std::atomic<int> blockCount;
+            std::atomic<int> lastBlockNanoSeconds;
+            std::atomic<int> peakBlockNanoSeconds;
+            std::atomic<int64_t> totalNanoSeconds;
+        };
+
+        int AddSlot(EffectType type, void* pEffect);
+        void ResetEffect(Slot* pSlot);
+        void LoadDry(Slot* pSlot, float* const* pChannels, int frameCount);
+        void ProcessEffect(Slot* pSlot, float* const* pChannels, int frameCount);
+        static int64_t GetTime();
+
+        std::vector<Slot> m_Slots;
+        int m_SlotCount;
+        // The input of an effect delayed by its latency, with room for the latency after it.
+        float* m_pDry[EffectChannelCount];
+    };
+
+}
@@ -0,0 +1,154 @@
+#include "CollisionWorld.h"
+#include "ContactBatch.h"
+#include "EntityStore.h"
+
+EntityStore::EntityStore(int capacity_)
+	: m_AliveCount(0)
+	, m_Players(&m_Generations)
+	, m_Positions(&m_Generations)
+	, m_Velocities(&m_Generations)
+	, m_Shapes(&m_Generations)
+{
+	m_Generations.reserve(capacity_);
+	m_FreeIndices.reserve(capacity_);
+	m_Players.Reserve(capacity_);
+	m_Positions.Reserve(capacity_);
+	m_Velocities.Reserve(capacity_);
+	m_Shapes.Reserve(capacity_);
+}
+
+EntityStore::~EntityStore()
+{
+}
+
+Entity EntityStore::Create()
+{
+	Entity entity;
+	if (!m_FreeIndices.empty())
+	{
+		entity.index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = static_cast<int>(m_Generations.size());
+		m_Generations.push_back(0);
+	}
+	entity.generation = m_Generations[entity.index];
+
+	++m_AliveCount;
+	return entity;
+}
+
+void EntityStore::Destroy(Entity entity_)
+{
+	assert(IsAlive(entity_));
+
+	// The CollisionWorld body of a shape belongs to the caller and is not removed here.
+	m_Players.Remove(entity_.index);
+	m_Positions.Remove(entity_.index);
+	m_Velocities.Remove(entity_.index);
+	m_Shapes.Remove(entity_.index);
+
+	// Bumping the generation invalidates every handle to the old entity.
+	++m_Generations[entity_.index];
+	m_FreeIndices.push_back(entity_.index);
+	--m_AliveCount;
+}
+
+bool EntityStore::IsAlive(Entity entity_) const
+{
+	return 0 <= entity_.index && entity_.index < static_cast<int>(m_Generations.size())
+		&& m_Generations[entity_.index] == entity_.generation;
+}
+
+void EntityStore::UpdatePlayers()
+{
+	ComponentPool<Velocity>& velocities = m_Velocities;
+	ForEach(m_Players, [&](int index_, Player& player_)
+	{
+		if (velocities.Has(index_))
+		{
+			Velocity& velocity = velocities.Get(index_);
+			velocity.x = player_.GetMoveX();
+			velocity.y = player_.GetMoveY();
+		}
+	});
+}
+
+void EntityStore::Integrate(float deltaTime_)
+{
+	ComponentPool<Position>& positions = m_Positions;
+	ForEach(m_Velocities, [&](int index_, Velocity& velocity_)
+	{
+		if (positions.Has(index_))
+		{
+			Position& position = positions.Get(index_);
+			position.x += velocity_.x * deltaTime_;
+			position.y += velocity_.y * deltaTime_;
+		}
+	});
+}
+
+void EntityStore::SyncShapes(CollisionWorld* pWorld_) const
+{
+	const CircleShape* pShapes = m_Shapes.GetData();
+	const int* pIndices = m_Shapes.GetIndices();
+	for (int i = 0; i < m_Shapes.GetCount(); ++i)
+	{
+		if (pShapes[i].bodyId == CollisionWorld::InvalidBodyId || !m_Positions.Has(pIndices[i]))
+		{
+			continue;
+		}
+		const Position& position = m_Positions.Get(pIndices[i]);
+		pWorld_->Move(pShapes[i].bodyId, position.x, position.y);
+	}
+}
+
+void EntityStore::SolveContacts(ContactBatch* pContacts_, const ContactSolverSettings& settings_)
+{
+	// Gather the bodies the contacts can refer to into arrays indexed by body id.
+	const CircleShape* pShapes = m_Shapes.GetData();
+	const int* pIndices = m_Shapes.GetIndices();
+	int bodyCount = 0;
+	for (int i = 0; i < m_Shapes.GetCount(); ++i)
+	{
+		bodyCount = pShapes[i].bodyId >= bodyCount ? pShapes[i].bodyId + 1 : bodyCount;
+	}
+	// Bodies without an entity stay static.
+	for (int i = 0; i < pContacts_->GetCount(); ++i)
+	{
+		bodyCount = pContacts_->GetBodyA()[i] >= bodyCount ? pContacts_->GetBodyA()[i] + 1 : bodyCount;
+		bodyCount = pContacts_->GetBodyB()[i] >= bodyCount ? pContacts_->GetBodyB()[i] + 1 : bodyCount;
+	}
+	m_BodyVelocityX.assign(bodyCount, 0.0f);
+	m_BodyVelocityY.assign(bodyCount, 0.0f);
+	m_BodyInvMass.assign(bodyCount, 0.0f);
+	for (int i = 0; i < m_Shapes.GetCount(); ++i)
+	{
+		const int body = pShapes[i].bodyId;
+		if (body == CollisionWorld::InvalidBodyId || !m_Velocities.Has(pIndices[i]))
+		{
+			continue;
+		}
+		const Velocity& velocity = m_Velocities.Get(pIndices[i]);
+		m_BodyVelocityX[body] = velocity.x;
+		m_BodyVelocityY[body] = velocity.y;
+		m_BodyInvMass[body] = 1.0f / (pShapes[i].r * pShapes[i].r);
+	}
+
+	pContacts_->SortByBody();
+	::SolveContacts(pContacts_, m_BodyVelocityX.data(), m_BodyVelocityY.data(), m_BodyInvMass.data(), settings_);
+
+	for (int i = 0; i < m_Shapes.GetCount(); ++i)
+	{
+		const int body = pShapes[i].bodyId;
+		if (body == CollisionWorld::InvalidBodyId || !m_Velocities.Has(pIndices[i]))
+		{
+			continue;
+		}
+		Velocity& velocity = m_Velocities.Get(pIndices[i]);
+		velocity.x = m_BodyVelocityX[body];
+		velocity.y = m_BodyVelocityY[body];
+	}
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "Player.h"
+
+class CollisionWorld;
+class ContactBatch;
+struct ContactSolverSettings;
+
+//! Handle to an entity. The generation tells a live entity apart from an older
+//! one that used the same slot.
+struct Entity
+{
+	int index;
+	int generation;
+};
+
+const Entity NullEntity = { -1, 0 };
+
+struct Position
+{
+	float x;
+	float y;
+};
+
+struct Velocity
+{
+	float x;
+	float y;
+};
+
+//! Circle collider. bodyId_ is the body in the CollisionWorld that follows the entity.
+struct CircleShape
+{
+	float r;
+	int bodyId;
+};
+
+//! Dense storage for one component type, a sparse set indexed by entity slot.
+//! The components themselves are packed without holes, so systems walk them in
+//! memory order. Removal moves the last component into the gap.
+//! pGenerations_ is the generation of every slot, owned by the EntityStore, so
+//! Add can refuse a handle to an entity that no longer lives.
+template <typename T>
+class ComponentPool
+{
+public:
+	explicit ComponentPool(const std::vector<int>* pGenerations_) : m_pGenerations(pGenerations_)
+	{
+		assert(pGenerations_ != nullptr);
+	}
+
+	bool Has(int index_) const
+	{
+		return 0 <= index_ && index_ < static_cast<int>(m_IndexToDense.size()) && m_IndexToDense[index_] >= 0;
+	}
+
+	T& Get(int index_)
+	{
+		assert(Has(index_));
+		return m_Dense[m_IndexToDense[index_]];
+	}
+
+	const T& Get(int index_) const
+	{
+		assert(Has(index_));
+		return m_Dense[m_IndexToDense[index_]];
+	}
+
+	T& Add(Entity entity_, const T& component_)
+	{
+		const int index = entity_.index;
+		assert(0 <= index && index < static_cast<int>(m_pGenerations->size())
+			&& (*m_pGenerations)[index] == entity_.generation);
+		assert(!Has(index));
+		if (index >= static_cast<int>(m_IndexToDense.size()))
+		{
+			m_IndexToDense.resize(index + 1, -1);
+		}
+		m_IndexToDense[index] = static_cast<int>(m_Dense.size());
+		m_Dense.push_back(component_);
+		m_DenseToIndex.push_back(index);
+		return m_Dense.back();
+	}
+
+	void Remove(int index_)
+	{
+		if (!Has(index_))
+		{
+			return;
+		}
+		const int dense = m_IndexToDense[index_];
+		const int last = static_cast<int>(m_Dense.size()) - 1;
+		if (dense != last)
+		{
+			m_Dense[dense] = m_Dense[last];
+			m_DenseToIndex[dense] = m_DenseToIndex[last];
+			m_IndexToDense[m_DenseToIndex[dense]] = dense;
+		}
+		m_Dense.pop_back();
+		m_DenseToIndex.pop_back();
+		m_IndexToDense[index_] = -1;
+	}
+
+	void Reserve(int capacity_)
+	{
+		m_Dense.reserve(capacity_);
+		m_DenseToIndex.reserve(capacity_);
+		m_IndexToDense.reserve(capacity_);
+	}
+
+	int GetCount() const { return static_cast<int>(m_Dense.size()); }
+	T* GetData() { return m_Dense.data(); }
+	const T* GetData() const { return m_Dense.data(); }
+	//! Entity slot of every dense component.
+	const int* GetIndices() const { return m_DenseToIndex.data(); }
+
+private:
+	ComponentPool(const ComponentPool&);
+	ComponentPool& operator=(const ComponentPool&);
+
+	const std::vector<int>* m_pGenerations;
+	std::vector<T> m_Dense;
+	std::vector<int> m_DenseToIndex;
+	std::vector<int> m_IndexToDense;
+};
+
+//! Entity storage with one contiguous array per component type.
+//! Entities are slots with a generation; components are added and removed per
+//! entity, and the systems below walk the dense arrays instead of chasing
+//! per-object pointers.
+class EntityStore
+{
+public:
+	explicit EntityStore(int capacity_ = 256);
+	~EntityStore();
+
+	Entity Create();
+	//! Removes every component of the entity and frees the slot.
+	void Destroy(Entity entity_);
+	bool IsAlive(Entity entity_) const;
+	int GetEntityCount() const { return m_AliveCount; }
+
+	ComponentPool<Player>& GetPlayers() { return m_Players; }
+	ComponentPool<Position>& GetPositions() { return m_Positions; }
+	ComponentPool<Velocity>& GetVelocities() { return m_Velocities; }
+	ComponentPool<CircleShape>& GetShapes() { return m_Shapes; }
+	const ComponentPool<Player>& GetPlayers() const { return m_Players; }
+	const ComponentPool<Position>& GetPositions() const { return m_Positions; }
+	const ComponentPool<Velocity>& GetVelocities() const { return m_Velocities; }
+	const ComponentPool<CircleShape>& GetShapes() const { return m_Shapes; }
+
+	//! Calls function_(entityIndex, component) for every component in pool_, in dense order.
+	template <typename T, typename TFunction>
+	static void ForEach(ComponentPool<T>& pool_, TFunction function_)
+	{
+		T* pData = pool_.GetData();
+		const int* pIndices = pool_.GetIndices();
+		const int count = pool_.GetCount();
+		for (int i = 0; i < count; ++i)
+		{
+			function_(pIndices[i], pData[i]);
+		}
+	}
+
+	//! Systems. A frame runs UpdatePlayers, SyncShapes, the broadphase,
+	//! SolveContacts and then Integrate.
+	//! Player input sets the velocity of its entity.
+	void UpdatePlayers();
+	//! Moves every entity that has a position by its velocity.
+	void Integrate(float deltaTime_);
+	//! Moves the CollisionWorld bodies of every shape to the entity position.
+	void SyncShapes(CollisionWorld* pWorld_) const;
+	//! Resolves the contacts between shapes, whose body ids are CollisionWorld ids.
+	//! Shapes of entities with a velocity are dynamic with a mass proportional to
+	//! their area, the others are static. Only the velocities change, Integrate
+	//! moves the entities apart.
+	void SolveContacts(ContactBatch* pContacts_, const ContactSolverSettings& settings_);
+
+private:
+	EntityStore(const EntityStore&);
+	EntityStore& operator=(const EntityStore&);
+
+	std::vector<int> m_Generations;
+	std::vector<int> m_FreeIndices;
+	int m_AliveCount;
+
+	ComponentPool<Player> m_Players;
+	ComponentPool<Position> m_Positions;
+	ComponentPool<Velocity> m_Velocities;
+	ComponentPool<CircleShape> m_Shapes;
+
+	// Per-body scratch for SolveContacts, indexed by CollisionWorld id.
+	std::vector<float> m_BodyVelocityX;
+	std::vector<float> m_BodyVelocityY;
+	std::vector<float> m_BodyInvMass;
+};
@@ -145,9 +145,52 @@
 // Vibe
 #include "NpadController.h"
 
+#include "AudioOutFeeder.h"
+#include "AudioSampleTraits.h"
+#include "AudioTelemetry.h"
 #include "Circle.h"
+#include "CollisionWorld.h"
+#include "ContactBatch.h"
+#include "ContactCache.h"
+#include "EffectChain.h"
+#include "EntityStore.h"
+#include "Mixer.h"
+#include "OscillatorBank.h"
+#include "ParallelNarrowphase.h"
+#include "Resampler.h"
+#include "StaticShape.h"
 
 namespace {
+    ///////////////////////////////////////////////
+    // Level
+    ///////////////////////////////////////////////
+
+    // Trigger zones are baked into a read-only table and validated at build time.
+    constexpr StaticRectangle g_TriggerZones[] =
+    {
+        StaticRectangle(-4.0f, -1.0f, -2.0f, 1.0f),
+        StaticRectangle(2.0f, -1.0f, 4.0f, 1.0f),
+        StaticRectangle(-1.0f, 4.0f, 1.0f, 6.0f),
+    };
+    const int TriggerZoneCount = sizeof(g_TriggerZones) / sizeof(g_TriggerZones[0]);
+
+    constexpr bool TriggerZonesAreDisjoint()
+    {
+        for (int i = 0; i < TriggerZoneCount; ++i)
+        {
+            for (int j = i + 1; j < TriggerZoneCount; ++j)
+            {
+                if (g_TriggerZones[i].Overlap(g_TriggerZones[j]))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(TriggerZonesAreDisjoint(), "Trigger zones must not overlap");
+    static_assert(!g_TriggerZones[0].Collide(StaticCircle(0.0f, 0.0f, 1.0f)), "The spawn circle must start outside the triggers");
+
     ///////////////////////////////////////////////
     // AudioEffect
     ///////////////////////////////////////////////
@@ -217,116 +260,164 @@ namespace {
     }
 
     //
-    // The square waveform generating function that supports nn::audio::SampleFormat_PcmInt8. Not yet implemented.
+    // Square wave voices, mixed into one mono voice of the mixer.
     //
-    void GenerateSquareWaveInt8(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
-    {
-        NN_UNUSED(buffer);
-        NN_UNUSED(channelCount);
-        NN_UNUSED(sampleRate);
-        NN_UNUSED(sampleCount);
-        NN_UNUSED(amplitude);
-        NN_ABORT("Not implemented yet\n");
-    }
+    const int SquareWaveVoiceCount = 6;
+    const float SquareWaveFrequencies[SquareWaveVoiceCount] = { 415.0f, 698.0f, 554.0f, 104.0f, 349.0f, 277.0f };
 
     //
-    // The square waveform generating function that supports nn::audio::SampleFormat_PcmInt16.
+    // The oscillators and the mixer run at the rate the content is made for. A device that
+    // opens at another rate gets the mix through a resampler.
     //
-    void GenerateSquareWaveInt16(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
-    {
-        static int s_TotalSampleCount[6] = { 0 };
-        const int frequencies[6] = { 415, 698, 554, 104, 349, 277 };
-
-        int16_t* buf = reinterpret_cast<int16_t*>(buffer);
-        for (int ch = 0; ch < channelCount; ch++)
-        {
-            int waveLength = sampleRate / frequencies[ch]; // Length of the waveform for one period (in sample count units).
-
-            for (int sample = 0; sample < sampleCount; sample++)
-            {
-                int16_t value = static_cast<int16_t>(s_TotalSampleCount[ch] < (waveLength / 2) ? amplitude : -amplitude);
-                buf[sample * channelCount + ch] = value;
-                s_TotalSampleCount[ch]++;
-                if (s_TotalSampleCount[ch] == waveLength)
-                {
-                    s_TotalSampleCount[ch] = 0;
-                }
-            }
-        }
-    }
+    const int MixSampleRate = 48000;
 
     //
-    // The square waveform generating function that supports nn::audio::SampleFormat_PcmInt24. Not yet implemented.
+    // Mixer render function that plays the oscillator bank.
     //
-    void GenerateSquareWaveInt24(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
+    void RenderOscillatorBank(float* pOut, int frameCount, void* pUserArg)
     {
-        NN_UNUSED(buffer);
-        NN_UNUSED(channelCount);
-        NN_UNUSED(sampleRate);
-        NN_UNUSED(sampleCount);
-        NN_UNUSED(amplitude);
-        NN_ABORT("Not implemented yet\n");
+        std::fill(pOut, pOut + frameCount, 0.0f);
+        static_cast<AUS::OscillatorBank*>(pUserArg)->Render(pOut, 1, frameCount);
     }
 
     //
-    // The square waveform generating function that supports nn::audio::SampleFormat_PcmInt32. Not yet implemented.
+    // Function to mix the voices of the mixer into a buffer of the output format.
     //
-    void GenerateSquareWaveInt32(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
+    void MixWave(nn::audio::SampleFormat format, AUS::Mixer* pMixer, void* buffer, int channelCount, int sampleCount)
     {
-        NN_UNUSED(buffer);
-        NN_UNUSED(channelCount);
-        NN_UNUSED(sampleRate);
-        NN_UNUSED(sampleCount);
-        NN_UNUSED(amplitude);
-        NN_ABORT("Not implemented yet\n");
+        NN_ASSERT_NOT_NULL(pMixer);
+        NN_ASSERT_NOT_NULL(buffer);
+        switch (format)
+        {
+        case nn::audio::SampleFormat_PcmInt8:
+            pMixer->Mix(static_cast<int8_t*>(buffer), channelCount, sampleCount);
+            break;
+        case nn::audio::SampleFormat_PcmInt16:
+            pMixer->Mix(static_cast<int16_t*>(buffer), channelCount, sampleCount);
+            break;
+        case nn::audio::SampleFormat_PcmInt24:
+            pMixer->Mix(static_cast<AUS::PcmInt24*>(buffer), channelCount, sampleCount);
+            break;
+        case nn::audio::SampleFormat_PcmInt32:
+            pMixer->Mix(static_cast<int32_t*>(buffer), channelCount, sampleCount);
+            break;
+        case nn::audio::SampleFormat_PcmFloat:
+            pMixer->Mix(static_cast<float*>(buffer), channelCount, sampleCount);
+            break;
+        default:
+            NN_UNEXPECTED_DEFAULT;
+        }
     }
 
     //
-    // The square waveform generating function that supports nn::audio::SampleFormat_PcmFloat. Not yet implemented.
+    // Function to convert float samples into a buffer of the output format.
     //
-    void GenerateSquareWaveFloat(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
+    template <typename SampleT>
+    void ConvertWave(SampleT* pOut, const float* pIn, int count)
     {
-        NN_UNUSED(buffer);
-        NN_UNUSED(channelCount);
-        NN_UNUSED(sampleRate);
-        NN_UNUSED(sampleCount);
-        NN_UNUSED(amplitude);
-        NN_ABORT("Not implemented yet\n");
+        for (int i = 0; i < count; ++i)
+        {
+            pOut[i] = AUS::SampleTraits<SampleT>::FromFloat(pIn[i]);
+        }
     }
 
-    //
-    // Returns the square waveform generating function supported by the sample format.
-    //
-    typedef void (*GenerateSquareWaveFunction)(void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude);
-    GenerateSquareWaveFunction GetGenerateSquareWaveFunction(nn::audio::SampleFormat format)
+    void ConvertWave(nn::audio::SampleFormat format, void* buffer, const float* pSamples, int count)
     {
+        NN_ASSERT_NOT_NULL(buffer);
         switch (format)
         {
         case nn::audio::SampleFormat_PcmInt8:
-            return GenerateSquareWaveInt8;
+            ConvertWave(static_cast<int8_t*>(buffer), pSamples, count);
+            break;
         case nn::audio::SampleFormat_PcmInt16:
-            return GenerateSquareWaveInt16;
+            ConvertWave(static_cast<int16_t*>(buffer), pSamples, count);
+            break;
         case nn::audio::SampleFormat_PcmInt24:
-            return GenerateSquareWaveInt24;
+            ConvertWave(static_cast<AUS::PcmInt24*>(buffer), pSamples, count);
+            break;
         case nn::audio::SampleFormat_PcmInt32:
-            return GenerateSquareWaveInt32;
+            ConvertWave(static_cast<int32_t*>(buffer), pSamples, count);
+            break;
         case nn::audio::SampleFormat_PcmFloat:
-            return GenerateSquareWaveFloat;
+            ConvertWave(static_cast<float*>(buffer), pSamples, count);
+            break;
         default:
             NN_UNEXPECTED_DEFAULT;
         }
     }
 
     //
-    // Function to create a square waveform.
+    // The mix the AudioOutFeeder thread plays. Only that thread touches it once playback starts.
     //
-    void GenerateSquareWave(nn::audio::SampleFormat format, void* buffer, int channelCount, int sampleRate, int sampleCount, int amplitude)
+    struct WaveStream
+    {
+        AUS::Mixer* pMixer;
+        AUS::OscillatorBank* pBank;
+        AUS::EffectChain* pEffectChain;
+        nn::audio::SampleFormat format;
+        int channelCount;
+        int rampFrameCount; // Gain and pan changes glide over this many frames.
+        AUS::Resampler* pResampler; // nullptr when the device runs at MixSampleRate.
+        float* pResampleBuffer;     // Mixer::BlockFrameCount frames at the device rate.
+    };
+
+    void ReadWaveStreamMix(float* pOut, int frameCount, void* pUserArg)
     {
-        NN_ASSERT_NOT_NULL(buffer);
-        GenerateSquareWaveFunction func = GetGenerateSquareWaveFunction(format);
-        if (func)
+        WaveStream* pStream = static_cast<WaveStream*>(pUserArg);
+        pStream->pMixer->Mix(pOut, pStream->channelCount, frameCount);
+    }
+
+    void FillWaveStream(void* pBuffer, size_t dataSize, void* pUserArg)
+    {
+        WaveStream* pStream = static_cast<WaveStream*>(pUserArg);
+        const size_t frameSize = pStream->channelCount * nn::audio::GetSampleByteSize(pStream->format);
+        NN_ASSERT(dataSize % frameSize == 0);
+        const int frameCount = static_cast<int>(dataSize / frameSize);
+
+        // Runs on the feeder thread, so it shows on the meter of core 2.
+        NN_PERF_SET_COLOR(nn::util::Color4u8::Red());
+        NN_PERF_BEGIN_MEASURE_NAME("AudioFill");
+        if (pStream->pResampler == nullptr)
+        {
+            MixWave(pStream->format, pStream->pMixer, pBuffer, pStream->channelCount, frameCount);
+        }
+        else
+        {
+            for (int offset = 0; offset < frameCount; offset += AUS::Mixer::BlockFrameCount)
+            {
+                const int count = std::min(frameCount - offset, static_cast<int>(AUS::Mixer::BlockFrameCount));
+                pStream->pResampler->Render(pStream->pResampleBuffer, count);
+                ConvertWave(pStream->format, static_cast<char*>(pBuffer) + offset * frameSize, pStream->pResampleBuffer, count * pStream->channelCount);
+            }
+        }
+        NN_PERF_END_MEASURE();
+    }
+
+    void ApplyWaveStreamCommand(const AUS::AudioCommand& command, void* pUserArg)
+    {
+        WaveStream* pStream = static_cast<WaveStream*>(pUserArg);
+        switch (command.type)
         {
-            func(buffer, channelCount, sampleRate, sampleCount, amplitude);
+        case AUS::AudioCommandType_SetWaveform:
+            pStream->pBank->SetWaveform(command.voice, static_cast<AUS::Waveform>(static_cast<int>(command.value)));
+            break;
+        case AUS::AudioCommandType_SetFrequency:
+            pStream->pBank->SetFrequency(command.voice, command.value);
+            break;
+        case AUS::AudioCommandType_SetAmplitude:
+            pStream->pBank->SetAmplitude(command.voice, command.value);
+            break;
+        case AUS::AudioCommandType_SetGain:
+            pStream->pMixer->SetGain(command.voice, command.value, pStream->rampFrameCount);
+            break;
+        case AUS::AudioCommandType_SetPan:
+            pStream->pMixer->SetPan(command.voice, command.value, pStream->rampFrameCount);
+            break;
+        case AUS::AudioCommandType_SetEffectEnabled:
+            pStream->pEffectChain->SetEnabled(command.voice, command.value != 0.0f);
+            break;
+        default:
+            NN_UNEXPECTED_DEFAULT;
         }
     }
 
@@ -521,6 +612,8 @@ namespace {
     int g_RenderHeight = 0;
 
     nns::gfx::PrimitiveRenderer::MeterDrawer g_MeterDrawer;
+    // Timing of the AudioOut feeder, drawn next to the load meter while it plays.
+    const AUS::AudioTelemetry* g_pAudioTelemetry = nullptr;
 
     //-----------------------------------------------------------------------------
     // Memory
@@ -1348,7 +1441,8 @@ void* meterMemory;
 void InitializeLoadMeter()
 {
     nn::perf::LoadMeterCenterInfo info;
-    info.SetCoreCount(1);
+    // Core 2 runs the AudioOut feeder next to the narrowphase worker.
+    info.SetCoreCount(3);
     info.SetCpuBufferCount(2);
     info.SetGpuBufferCount(3);
     info.SetCpuSectionCountMax(64);
@@ -1566,6 +1660,67 @@ int CreateUserMesh(nns::gfx::PrimitiveRenderer::PrimitiveMesh* pMeshBuffer, bool
     return numIndices;
 } //NOLINT(impl/function_size)
 
+//---------------------------------------------------------------
+// Draw the AudioOut telemetry: counters, then the latency and jitter histograms.
+//---------------------------------------------------------------
+void DrawAudioHistogram(nn::gfx::CommandBuffer* pCommandBuffer, const AUS::AudioHistogram& histogram, float x, float y, float height)
+{
+    const float barStep = 8.f;
+    int countMax = 1;
+    for (int i = 0; i < AUS::AudioHistogramBinCount; ++i)
+    {
+        countMax = std::max(countMax, histogram.counts[i]);
+    }
+    // Log scale, so a single late wake among thousands still shows.
+    const float scale = height / std::log(1.f + static_cast<float>(countMax));
+    g_pPrimitiveRenderer->Draw2DLine(pCommandBuffer, x, y, x + barStep * AUS::AudioHistogramBinCount, y);
+    for (int i = 0; i < AUS::AudioHistogramBinCount; ++i)
+    {
+        if (histogram.counts[i] > 0)
+        {
+            const float barHeight = std::max(1.f, std::log(1.f + static_cast<float>(histogram.counts[i])) * scale);
+            const float barX = x + barStep * i + barStep / 2;
+            g_pPrimitiveRenderer->Draw2DLine(pCommandBuffer, barX, y, barX, y - barHeight);
+        }
+    }
+}
+
+void DrawAudioTelemetry(nn::gfx::CommandBuffer* pCommandBuffer)
+{
+    if (g_pAudioTelemetry == nullptr)
+    {
+        return;
+    }
+    const AUS::AudioTelemetryStats stats = g_pAudioTelemetry->GetStats();
+    AUS::AudioHistogram latency;
+    AUS::AudioHistogram jitter;
+    g_pAudioTelemetry->GetLatencyHistogram(&latency);
+    g_pAudioTelemetry->GetJitterHistogram(&jitter);
+
+    const float x = static_cast<float>(g_RenderWidth) - 320.f;
+    const float y = 32.f;
+    const float histogramHeight = 48.f;
+    g_Writer.SetTextColor(nn::util::Color4u8::White());
+    g_Writer.SetCursor(x, y);
+    g_Writer.Print("AudioOut %d wakes, %d late, %d underruns\n", stats.wakeCount, stats.lateWakeCount, stats.underrunCount);
+    g_Writer.Print("latency %d us, peak %d us\n", stats.lastLatencyMicroSeconds, stats.peakLatencyMicroSeconds);
+    g_Writer.Print("jitter %d us, peak %d us\n", stats.lastJitterMicroSeconds, stats.peakJitterMicroSeconds);
+    g_Writer.SetCursor(x, y + 72.f + histogramHeight);
+    g_Writer.Print("latency 0-%d ms", latency.binMicroSeconds * AUS::AudioHistogramBinCount / 1000);
+    g_Writer.SetCursor(x, y + 96.f + histogramHeight * 2);
+    g_Writer.Print("jitter 0-%d us", jitter.binMicroSeconds * AUS::AudioHistogramBinCount);
+    g_Writer.SetTextColor(nn::util::Color4u8::Black());
+
+    const nn::util::Uint8x4 green = { { 0, 255, 0, 255 } };
+    const nn::util::Uint8x4 yellow = { { 255, 255, 0, 255 } };
+    g_pPrimitiveRenderer->SetLineWidth(6.f);
+    g_pPrimitiveRenderer->SetColor(green);
+    DrawAudioHistogram(pCommandBuffer, latency, x, y + 72.f + histogramHeight, histogramHeight);
+    g_pPrimitiveRenderer->SetColor(yellow);
+    DrawAudioHistogram(pCommandBuffer, jitter, x, y + 96.f + histogramHeight * 2, histogramHeight);
+    g_pPrimitiveRenderer->SetLineWidth(1.f);
+}
+
 //---------------------------------------------------------------
 // Generate the commands.
 //---------------------------------------------------------------
@@ -2156,6 +2311,7 @@ bool MakeCommand(int frame, int bufferIndex)
             g_MeterDrawer.SetWidth(g_RenderWidth - 64.f);
             g_MeterDrawer.Draw(pCommandBuffer, g_pPrimitiveRenderer, pFrameMeter);
         }
+        DrawAudioTelemetry(pCommandBuffer);
 
         // Draw text.
         g_Writer.Draw(pCommandBuffer);
@@ -2311,9 +2467,31 @@ extern "C" void nnMain()
     // 
     /////////////////////////////////////////////////////////////////////////////
 
-    Circle cirA(0, 0, 1);
-    Circle cirB(0, 2, 1);
-    Circle cirC(0, 3, 1);
+    // Circles are tested through the spatial hash instead of pair by pair.
+    CollisionWorld collisionWorld(2.0f);
+    std::vector<CollisionPair> collisionPairs;
+    ContactCache contactCache;
+    ContactBatch contacts;
+    const ContactSolverSettings solverSettings = MakeDefaultContactSolverSettings();
+
+    // Game objects live in the entity store, the first circle is driven by player 1.
+    EntityStore entityStore;
+    const Circle spawnCircles[] = { Circle(0, 0, 1), Circle(0, 2, 1), Circle(0, 3, 1) };
+    const int spawnCount = static_cast<int>(NN_ARRAY_SIZE(spawnCircles));
+    for (int i = 0; i < spawnCount; ++i)
+    {
+        Entity entity = entityStore.Create();
+        Position position = { spawnCircles[i].x, spawnCircles[i].y };
+        CircleShape shape = { spawnCircles[i].r, collisionWorld.Insert(spawnCircles[i]) };
+        entityStore.GetPositions().Add(entity, position);
+        entityStore.GetShapes().Add(entity, shape);
+        if (i == 0)
+        {
+            Velocity velocity = { 0.0f, 0.0f };
+            entityStore.GetVelocities().Add(entity, velocity);
+            entityStore.GetPlayers().Add(entity, Player(0, 4.0f));
+        }
+    }
 
     Init();
     InitializeFs();
@@ -2353,6 +2531,15 @@ extern "C" void nnMain()
     // AudioEffect
     ///////////////////////////////////////////////
     nn::mem::StandardAllocator allocator(g_HeapBuffer, sizeof(g_HeapBuffer));
+
+    // The narrowphase runs on cores 1 and 2 next to the main thread on core 0.
+    const int collisionWorkerCount = 2;
+    ParallelNarrowphase narrowphase;
+    size_t narrowphaseBufferSize = ParallelNarrowphase::GetRequiredWorkBufferSize(collisionWorkerCount);
+    void* narrowphaseBuffer = allocator.Allocate(narrowphaseBufferSize, nn::os::ThreadStackAlignment);
+    NN_ASSERT_NOT_NULL(narrowphaseBuffer);
+    narrowphase.Initialize(collisionWorkerCount, 1, narrowphaseBuffer, narrowphaseBufferSize);
+
     nn::audio::AudioOut audioOut;
 
     // Open audio output with the specified sampling rate and number of channels.
@@ -2377,27 +2564,75 @@ extern "C" void nnMain()
     int channelCount = nn::audio::GetAudioOutChannelCount(&audioOut);
     int sampleRate = nn::audio::GetAudioOutSampleRate(&audioOut);
     nn::audio::SampleFormat sampleFormat = nn::audio::GetAudioOutSampleFormat(&audioOut);
-    // This sample assumes that the sample format is 16-bit.
-    NN_ASSERT(sampleFormat == nn::audio::SampleFormat_PcmInt16);
 
-    // Prepare parameters for the buffer.
-    const int frameRate = 20;                             // 20 fps
-    const int frameSampleCount = sampleRate / frameRate;  // 50 milliseconds (in samples)
-    const size_t dataSize = frameSampleCount * channelCount * nn::audio::GetSampleByteSize(sampleFormat);
-    const size_t bufferSize = nn::util::align_up(dataSize, nn::audio::AudioOutBuffer::SizeGranularity);
-    const int bufferCount = 4;
-    const int amplitude = std::numeric_limits<int16_t>::max() / 16;
-
-    nn::audio::AudioOutBuffer audioOutBuffer[bufferCount];
-    void* outBuffer[bufferCount];
-    for (int i = 0; i < bufferCount; ++i)
-    {
-        outBuffer[i] = allocator.Allocate(bufferSize, nn::audio::AudioOutBuffer::AddressAlignment);
-        NN_ASSERT(outBuffer[i]);
-        GenerateSquareWave(sampleFormat, outBuffer[i], channelCount, sampleRate, frameSampleCount, amplitude);
-        nn::audio::SetAudioOutBufferInfo(&audioOutBuffer[i], outBuffer[i], bufferSize, dataSize);
-        nn::audio::AppendAudioOutBuffer(&audioOut, &audioOutBuffer[i]);
-    }
+    // Pick the buffer length and queue depth. Low starts at 15 ms of queued audio and grows the queue
+    // only when refills come late; Safe is the fixed 4 x 50 ms queue.
+    const AUS::AudioOutLatencySettings latencySettings = AUS::MakeAudioOutLatencySettings(AUS::AudioOutLatencyMode_Low);
+    const float amplitude = 1.0f / 16.0f;
+
+    // The square wave chord plays as one voice of the mixer, so it can be panned as a whole.
+    AUS::OscillatorBank oscillatorBank(MixSampleRate, SquareWaveVoiceCount);
+    for (int voice = 0; voice < SquareWaveVoiceCount; ++voice)
+    {
+        oscillatorBank.AddVoice(AUS::Waveform_Square, SquareWaveFrequencies[voice], amplitude, 0);
+    }
+    AUS::Mixer mixer(MixSampleRate, 16);
+    const int waveVoice = mixer.AddRenderVoice(RenderOscillatorBank, &oscillatorBank);
+    // Fade in over the first 50 ms.
+    mixer.SetGain(waveVoice, 0.0f, 0);
+    mixer.SetGain(waveVoice, 1.0f, MixSampleRate / 20);
+
+    // The mix goes through a light EQ, an echo and a room, and a limiter that keeps the sum off
+    // the clip point. ZL and ZR switch the echo and the room while the chord plays.
+    AUS::Equalizer equalizer(MixSampleRate);
+    equalizer.SetBand(0, AUS::BiquadType_HighPass, 40.0f, 0.707f, 0.0f);
+    equalizer.SetBand(1, AUS::BiquadType_HighShelf, 6000.0f, 0.707f, -3.0f);
+    AUS::Delay echo(MixSampleRate, 500.0f);
+    echo.SetDelay(300.0f);
+    echo.SetFeedback(0.35f);
+    echo.SetMix(0.3f);
+    AUS::Reverb room(MixSampleRate, 0.6f);
+    room.SetDecayTime(1.8f);
+    room.SetMix(0.25f);
+    AUS::Compressor limiter(MixSampleRate);
+    limiter.SetThreshold(-1.0f);
+    limiter.SetRatio(50.0f);
+    limiter.SetAttack(0.0f);
+    limiter.SetRelease(80.0f);
+    AUS::EffectChain effectChain(4);
+    effectChain.Add(&equalizer);
+    const int echoSlot = effectChain.Add(&echo);
+    const int roomSlot = effectChain.Add(&room);
+    effectChain.Add(&limiter);
+    effectChain.SetEnabled(echoSlot, false);
+    effectChain.SetEnabled(roomSlot, false);
+    mixer.SetEffectChain(&effectChain);
+    bool isEchoEnabled = false;
+    bool isRoomEnabled = false;
+
+    // The feeder fills the first buffers here, then refills them on its own thread next to the
+    // narrowphase worker on core 2.
+    WaveStream waveStream = { &mixer, &oscillatorBank, &effectChain, sampleFormat, channelCount, MixSampleRate / 100, nullptr, nullptr };
+
+    // When the device fell back to another rate, convert the mix on the feeder thread.
+    AUS::Resampler resampler(MixSampleRate, sampleRate, channelCount, AUS::ResamplerQuality_High, ReadWaveStreamMix, &waveStream);
+    std::vector<float> resampleBuffer(AUS::Mixer::BlockFrameCount * channelCount);
+    if (sampleRate != MixSampleRate)
+    {
+        NN_LOG("AudioOut runs at %d Hz, resampling the mix from %d Hz with %d taps.\n", sampleRate, MixSampleRate, resampler.GetTapCount());
+        waveStream.pResampler = &resampler;
+        waveStream.pResampleBuffer = resampleBuffer.data();
+    }
+    const int voiceCount = oscillatorBank.GetVoiceCount();
+    int waveform = AUS::Waveform_Square;
+    float wavePan = 0.0f;
+    AUS::AudioOutFeeder audioOutFeeder;
+    size_t audioOutFeederBufferSize = AUS::AudioOutFeeder::GetRequiredWorkBufferSize(latencySettings, sampleRate, channelCount, sampleFormat);
+    void* audioOutFeederBuffer = allocator.Allocate(audioOutFeederBufferSize, nn::os::ThreadStackAlignment);
+    NN_ASSERT_NOT_NULL(audioOutFeederBuffer);
+    audioOutFeeder.Initialize(&audioOut, &systemEvent, latencySettings, FillWaveStream, ApplyWaveStreamCommand, &waveStream,
+        2, audioOutFeederBuffer, audioOutFeederBufferSize);
+    g_pAudioTelemetry = &audioOutFeeder.GetTelemetry();
 
     // Start playback.
     NN_ABORT_UNLESS(
@@ -2470,52 +2705,126 @@ extern "C" void nnMain()
                 // Display the Npad input state.
             }
 
-            if (currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::B>())
+            if (currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::B>()
+                && !oldNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::B>())
             {
                 ///////////////////////////////
                 // AUDIO Update
                 ///////////////////////////////
-                // Get the buffer that completed playback.
-                nn::audio::AudioOutBuffer* pAudioOutBuffer = nullptr;
-
-                pAudioOutBuffer = nn::audio::GetReleasedAudioOutBuffer(&audioOut);
-                while (pAudioOutBuffer)
+                // Switch every voice to the next waveform. The feeder thread applies it before its next refill.
+                waveform = (waveform + 1) % AUS::Waveform_Count;
+                for (int voice = 0; voice < voiceCount; ++voice)
                 {
-                    // Create square waveform data and register it again.
-                    void* pOutBuffer = nn::audio::GetAudioOutBufferDataPointer(pAudioOutBuffer);
-                    NN_ASSERT(nn::audio::GetAudioOutBufferDataSize(pAudioOutBuffer) == frameSampleCount * channelCount * nn::audio::GetSampleByteSize(sampleFormat));
-                    GenerateSquareWave(sampleFormat, pOutBuffer, channelCount, sampleRate, frameSampleCount, amplitude);
-                    nn::audio::AppendAudioOutBuffer(&audioOut, pAudioOutBuffer);
-
-                    pAudioOutBuffer = nn::audio::GetReleasedAudioOutBuffer(&audioOut);
+                    AUS::AudioCommand command = { AUS::AudioCommandType_SetWaveform, voice, static_cast<float>(waveform) };
+                    if (!audioOutFeeder.SendCommand(command))
+                    {
+                        NN_LOG("Audio command ring is full\n");
+                    }
+                }
+            }
+            if ((currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::L>()
+                    && !oldNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::L>())
+                || (currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::R>()
+                    && !oldNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::R>()))
+            {
+                // Pan the chord a step to the left or right, the mixer glides there over 10 ms.
+                const float panStep = currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::L>() ? -0.5f : 0.5f;
+                wavePan = std::max(-1.0f, std::min(1.0f, wavePan + panStep));
+                AUS::AudioCommand command = { AUS::AudioCommandType_SetPan, waveVoice, wavePan };
+                if (!audioOutFeeder.SendCommand(command))
+                {
+                    NN_LOG("Audio command ring is full\n");
+                }
+            }
+            if ((currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::ZL>()
+                    && !oldNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::ZL>())
+                || (currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::ZR>()
+                    && !oldNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::ZR>()))
+            {
+                // ZL switches the echo, ZR the room. The chain fades them over one block.
+                const bool isEcho = currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::ZL>();
+                bool& isEnabled = isEcho ? isEchoEnabled : isRoomEnabled;
+                isEnabled = !isEnabled;
+                AUS::AudioCommand command = { AUS::AudioCommandType_SetEffectEnabled, isEcho ? echoSlot : roomSlot, isEnabled ? 1.0f : 0.0f };
+                if (!audioOutFeeder.SendCommand(command))
+                {
+                    NN_LOG("Audio command ring is full\n");
                 }
-
             }
             if (currentNpadJoyDualState[i].buttons.Test<nn::hid::NpadButton::X>())
             {
-                NN_LOG("Circle 1 and Circle 2");
-                if(cirA.Collide(cirB))
-                    NN_LOG("Collide!!!");
-                else
-                    NN_LOG("Not Collide");
-
-                NN_LOG("Circle 2 and Circle 3");
-                if (cirB.Collide(cirC))
-                    NN_LOG("Collide!!!");
-                else
-                    NN_LOG("Not Collide");
-
-
-                NN_LOG("Circle 1 and Circle 3");
-                if (cirA.Collide(cirC))
-                    NN_LOG("Collide!!!");
-                else
-                    NN_LOG("Not Collide");
-
+                NN_LOG("%d contacts\n", contactCache.GetContactCount());
+                const AUS::AudioOutStats audioStats = audioOutFeeder.GetStats();
+                NN_LOG("Audio: %d x %d samples queued (%d us), jitter %d us, %d underruns\n",
+                    audioStats.queueDepth, audioStats.bufferSampleCount, audioStats.latencyMicroSeconds,
+                    audioStats.jitterMicroSeconds, audioStats.underrunCount);
+                // The last few things the feeder thread did, with their times.
+                const char* const eventNames[] = { "wake", "release", "append", "update", "underrun" };
+                AUS::AudioEvent audioEvents[8];
+                const int audioEventCount = audioOutFeeder.GetTelemetry().GetEvents(audioEvents, NN_ARRAY_SIZE(audioEvents));
+                for (int event = 0; event < audioEventCount; ++event)
+                {
+                    NN_LOG("  %10lld us %-8s %d frames queued\n", static_cast<long long>(audioEvents[event].timeMicroSeconds),
+                        eventNames[audioEvents[event].type], audioEvents[event].queuedFrameCount);
+                }
+                const AUS::MixerStats mixerStats = mixer.GetStats();
+                NN_LOG("Mixer: %d voices, %d us per block (%.1f%%), peak %d us (%.1f%%)\n",
+                    mixerStats.voiceCount, mixerStats.lastBlockMicroSeconds, mixerStats.lastLoad * 100.0f,
+                    mixerStats.peakBlockMicroSeconds, mixerStats.peakLoad * 100.0f);
+                const char* const effectNames[] = { "EQ", "Compressor", "Delay", "Reverb" };
+                for (int slot = 0; slot < effectChain.GetSlotCount(); ++slot)
+                {
+                    // A nanosecond is about a cycle of the 1020 MHz CPU.
+                    const AUS::EffectStats effectStats = effectChain.GetStats(slot);
+                    NN_LOG("  %-10s %6d ns per block, average %6d ns, peak %6d ns\n",
+                        effectNames[effectChain.GetType(slot)], effectStats.lastBlockNanoSeconds, effectStats.averageBlockNanoSeconds, effectStats.peakBlockNanoSeconds);
+                }
+                for (int id = 0; id < collisionWorld.GetBodyCount(); ++id)
+                {
+                    const StaticCircle circle = MakeBasicCircle<float>(collisionWorld.GetCircle(id));
+                    for (int zone = 0; zone < TriggerZoneCount; ++zone)
+                    {
+                        if (g_TriggerZones[zone].Collide(circle))
+                        {
+                            NN_LOG("Circle %d is in trigger zone %d\n", id + 1, zone);
+                        }
+                    }
+                }
             }
         }
         // HID Update
         Update();
+        // Game Update
+        EntityStore::ForEach(entityStore.GetPlayers(), [](int, Player& player_)
+        {
+            const nn::hid::AnalogStickState& stick = currentNpadJoyDualState[player_.GetControllerIndex()].analogStickL;
+            player_.SetStick(static_cast<float>(stick.x) / nn::hid::AnalogStickMax,
+                static_cast<float>(stick.y) / nn::hid::AnalogStickMax);
+        });
+        entityStore.UpdatePlayers();
+        entityStore.SyncShapes(&collisionWorld);
+
+        // Only contact changes are reported.
+        narrowphase.FindPairs(&collisionWorld, &collisionPairs);
+        contactCache.Update(collisionPairs);
+        for (int i = 0; i < contactCache.GetBeginCount(); ++i)
+        {
+            const CollisionPair& pair = contactCache.GetBeginEvents()[i];
+            NN_LOG("Circle %d and Circle %d Collide!!!\n", pair.a + 1, pair.b + 1);
+        }
+        for (int i = 0; i < contactCache.GetEndCount(); ++i)
+        {
+            const CollisionPair& pair = contactCache.GetEndEvents()[i];
+            NN_LOG("Circle %d and Circle %d Separate\n", pair.a + 1, pair.b + 1);
+        }
+
+        // Push the player out of the circles it runs into, then move.
+        contacts.Clear();
+        contacts.AddCirclePairs(collisionWorld, collisionPairs.data(), static_cast<int>(collisionPairs.size()));
+        contacts.LoadImpulses(contactCache);
+        entityStore.SolveContacts(&contacts, solverSettings);
+        contacts.StoreImpulses(&contactCache);
+        entityStore.Integrate(solverSettings.deltaTime);
         //GFX UPDATE
         NN_PERF_BEGIN_FRAME();
         {
@@ -2529,6 +2838,11 @@ extern "C" void nnMain()
     }
     g_Queue.Sync();
 
+    // The feeder thread measures itself on the load meter, so it stops first. Stopping it
+    // before playback also means it never appends to a stopped AudioOut.
+    g_pAudioTelemetry = nullptr;
+    audioOutFeeder.Finalize();
+
     // Free the processing meter.
     FinalizeLoadMeter();
     // Free the Debug Font
@@ -2550,9 +2864,9 @@ extern "C" void nnMain()
     nn::os::DestroySystemEvent(systemEvent.GetBase());
 
     // Free memory.
-    for (int i = 0; i < bufferCount; ++i)
-    {
-        allocator.Free(outBuffer[i]);
-    }
+    allocator.Free(audioOutFeederBuffer);
     // Audio end
+
+    narrowphase.Finalize();
+    allocator.Free(narrowphaseBuffer);
 }
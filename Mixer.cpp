@@ -0,0 +1,436 @@
+#include "Mixer.h"
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include "EffectChain.h"
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    namespace {
+
+        using SimdUtil::Vec;
+
+        // Adds pSource times a constant gain to pAccumulator.
+        void Accumulate(float* pAccumulator, const float* pSource, float gain, int paddedCount)
+        {
+            const Vec g = SimdUtil::Set(gain);
+            for (int i = 0; i < paddedCount; i += SimdUtil::LaneCount)
+            {
+                SimdUtil::Store(pAccumulator + i, SimdUtil::Add(SimdUtil::Load(pAccumulator + i), SimdUtil::Mul(SimdUtil::Load(pSource + i), g)));
+            }
+        }
+
+        // Adds pSource to pAccumulator with a gain of value + step * min(i + 1, rampCount) on frame i,
+        // so the ramp lands on its target at frame rampCount - 1 and holds it from there on.
+        void AccumulateRamp(float* pAccumulator, const float* pSource, float value, float step, int rampCount, int paddedCount)
+        {
+            alignas(SimdUtil::Alignment) static const float FrameOffsets[SimdUtil::MaxLaneCount] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+            const Vec start = SimdUtil::Set(value);
+            const Vec stepVec = SimdUtil::Set(step);
+            const Vec last = SimdUtil::Set(static_cast<float>(rampCount));
+            const Vec laneCount = SimdUtil::Set(static_cast<float>(SimdUtil::LaneCount));
+            Vec frame = SimdUtil::Load(FrameOffsets);
+            for (int i = 0; i < paddedCount; i += SimdUtil::LaneCount)
+            {
+                const Vec g = SimdUtil::Add(start, SimdUtil::Mul(stepVec, SimdUtil::Min(frame, last)));
+                SimdUtil::Store(pAccumulator + i, SimdUtil::Add(SimdUtil::Load(pAccumulator + i), SimdUtil::Mul(SimdUtil::Load(pSource + i), g)));
+                frame = SimdUtil::Add(frame, laneCount);
+            }
+        }
+
+        // Copies frameCount frames from position on, splitting interleaved stereo into two arrays.
+        template <typename SampleT>
+        void ReadPcm(float* pLeft, float* pRight, const SampleT* pSamples, int channelCount, int position, int frameCount)
+        {
+            if (channelCount == 1)
+            {
+                const SampleT* pIn = pSamples + position;
+                for (int i = 0; i < frameCount; ++i)
+                {
+                    pLeft[i] = SampleTraits<SampleT>::ToFloat(pIn[i]);
+                }
+                return;
+            }
+            const SampleT* pIn = pSamples + position * 2;
+            for (int i = 0; i < frameCount; ++i)
+            {
+                pLeft[i] = SampleTraits<SampleT>::ToFloat(pIn[i * 2]);
+                pRight[i] = SampleTraits<SampleT>::ToFloat(pIn[i * 2 + 1]);
+            }
+        }
+
+    }
+
+    Mixer::Mixer(int sampleRate, int voiceCountMax)
+        : m_SampleRate(sampleRate)
+        , m_VoiceCount(0)
+        , m_Voices(voiceCountMax)
+        , m_pMemory(nullptr)
+        , m_pEffectChain(nullptr)
+        , m_MixedVoiceCount(0)
+        , m_StatVoiceCount(0)
+        , m_StatBlockCount(0)
+        , m_StatLastBlockNanoSeconds(0)
+        , m_StatPeakBlockNanoSeconds(0)
+        , m_StatLastBlockFrameCount(0)
+        , m_StatPeakBlockFrameCount(0)
+    {
+        assert(sampleRate > 0);
+        assert(voiceCountMax > 0);
+        static_assert(BlockFrameCount % SimdUtil::MaxLaneCount == 0, "Blocks must be whole vectors");
+        static_assert(BlockFrameCount <= EffectFrameCountMax, "Blocks must fit the effect chain");
+
+        m_pMemory = SimdUtil::AlignedAllocate(sizeof(float) * BlockFrameCount * 4);
+        assert(m_pMemory != nullptr);
+        float* pBlock = static_cast<float*>(m_pMemory);
+        m_pAccumulator[0] = pBlock;
+        m_pAccumulator[1] = pBlock + BlockFrameCount;
+        m_pSource[0] = pBlock + BlockFrameCount * 2;
+        m_pSource[1] = pBlock + BlockFrameCount * 3;
+
+        m_FreeVoices.reserve(voiceCountMax);
+        for (int voice = voiceCountMax - 1; voice >= 0; --voice)
+        {
+            m_Voices[voice].sourceType = SourceType_None;
+            m_FreeVoices.push_back(voice);
+        }
+    }
+
+    Mixer::~Mixer()
+    {
+        SimdUtil::AlignedFree(m_pMemory);
+    }
+
+    int Mixer::AddVoice()
+    {
+        if (m_FreeVoices.empty())
+        {
+            return InvalidVoice;
+        }
+        const int voice = m_FreeVoices.back();
+        m_FreeVoices.pop_back();
+        ++m_VoiceCount;
+
+        Voice& v = m_Voices[voice];
+        v.pSamples = nullptr;
+        v.channelCount = 1;
+        v.frameCount = 0;
+        v.position = 0;
+        v.isLooping = false;
+        v.isPlaying = true;
+        v.renderFunction = nullptr;
+        v.pUserArg = nullptr;
+        v.gain = 1.0f;
+        v.pan = 0.0f;
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            v.outputGain[ch].value = 0.0f;
+            v.outputGain[ch].remaining = 0;
+        }
+        return voice;
+    }
+
+    int Mixer::AddPcmVoice(const int16_t* pSamples, int channelCount, int frameCount, bool isLooping)
+    {
+        assert(pSamples != nullptr);
+        assert(channelCount == 1 || channelCount == 2);
+        assert(frameCount > 0);
+        const int voice = AddVoice();
+        if (voice != InvalidVoice)
+        {
+            Voice& v = m_Voices[voice];
+            v.sourceType = SourceType_PcmInt16;
+            v.pSamples = pSamples;
+            v.channelCount = channelCount;
+            v.frameCount = frameCount;
+            v.isLooping = isLooping;
+            UpdateOutputGains(&v, 0);
+        }
+        return voice;
+    }
+
+    int Mixer::AddPcmVoice(const float* pSamples, int channelCount, int frameCount, bool isLooping)
+    {
+        assert(pSamples != nullptr);
+        assert(channelCount == 1 || channelCount == 2);
+        assert(frameCount > 0);
+        const int voice = AddVoice();
+        if (voice != InvalidVoice)
+        {
+            Voice& v = m_Voices[voice];
+            v.sourceType = SourceType_PcmFloat;
+            v.pSamples = pSamples;
+            v.channelCount = channelCount;
+            v.frameCount = frameCount;
+            v.isLooping = isLooping;
+            UpdateOutputGains(&v, 0);
+        }
+        return voice;
+    }
+
+    int Mixer::AddRenderVoice(RenderFunction renderFunction, void* pUserArg)
+    {
+        assert(renderFunction != nullptr);
+        const int voice = AddVoice();
+        if (voice != InvalidVoice)
+        {
+            Voice& v = m_Voices[voice];
+            v.sourceType = SourceType_Render;
+            v.renderFunction = renderFunction;
+            v.pUserArg = pUserArg;
+            UpdateOutputGains(&v, 0);
+        }
+        return voice;
+    }
+
+    void Mixer::RemoveVoice(int voice)
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        m_Voices[voice].sourceType = SourceType_None;
+        m_FreeVoices.push_back(voice);
+        --m_VoiceCount;
+    }
+
+    bool Mixer::IsPlaying(int voice) const
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        return m_Voices[voice].isPlaying;
+    }
+
+    void Mixer::SetPosition(int voice, int frame)
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()));
+        Voice& v = m_Voices[voice];
+        assert(v.sourceType == SourceType_PcmInt16 || v.sourceType == SourceType_PcmFloat);
+        assert(0 <= frame && frame < v.frameCount);
+        v.position = frame;
+        v.isPlaying = true;
+    }
+
+    int Mixer::GetPosition(int voice) const
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        return m_Voices[voice].position;
+    }
+
+    void Mixer::SetGain(int voice, float gain, int rampFrameCount)
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        m_Voices[voice].gain = gain;
+        UpdateOutputGains(&m_Voices[voice], rampFrameCount);
+    }
+
+    void Mixer::SetPan(int voice, float pan, int rampFrameCount)
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        m_Voices[voice].pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        UpdateOutputGains(&m_Voices[voice], rampFrameCount);
+    }
+
+    float Mixer::GetGain(int voice) const
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        return m_Voices[voice].gain;
+    }
+
+    float Mixer::GetPan(int voice) const
+    {
+        assert(0 <= voice && voice < static_cast<int>(m_Voices.size()) && m_Voices[voice].sourceType != SourceType_None);
+        return m_Voices[voice].pan;
+    }
+
+    void Mixer::UpdateOutputGains(Voice* pVoice, int rampFrameCount)
+    {
+        assert(rampFrameCount >= 0);
+
+        // Mono voices use an equal power law, a stereo voice keeps both sides at full gain
+        // in the center and only turns the far side down.
+        float target[2];
+        if (pVoice->channelCount == 1)
+        {
+            const float angle = (pVoice->pan + 1.0f) * 0.78539816f;
+            target[0] = pVoice->gain * std::cos(angle);
+            target[1] = pVoice->gain * std::sin(angle);
+        }
+        else
+        {
+            target[0] = pVoice->gain * (pVoice->pan > 0.0f ? 1.0f - pVoice->pan : 1.0f);
+            target[1] = pVoice->gain * (pVoice->pan < 0.0f ? 1.0f + pVoice->pan : 1.0f);
+        }
+
+        // A new ramp starts from wherever the running one has got to.
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            Ramp& ramp = pVoice->outputGain[ch];
+            ramp.target = target[ch];
+            ramp.remaining = rampFrameCount;
+            if (rampFrameCount == 0)
+            {
+                ramp.value = target[ch];
+                ramp.step = 0.0f;
+            }
+            else
+            {
+                ramp.step = (target[ch] - ramp.value) / static_cast<float>(rampFrameCount);
+            }
+        }
+    }
+
+    void Mixer::ReadSource(Voice* pVoice, int frameCount)
+    {
+        float* pLeft = m_pSource[0];
+        float* pRight = m_pSource[1];
+
+        if (pVoice->sourceType == SourceType_Render)
+        {
+            pVoice->renderFunction(pLeft, frameCount, pVoice->pUserArg);
+        }
+        else
+        {
+            int filled = 0;
+            while (filled < frameCount && pVoice->isPlaying)
+            {
+                if (pVoice->position == pVoice->frameCount)
+                {
+                    if (!pVoice->isLooping)
+                    {
+                        pVoice->isPlaying = false;
+                        break;
+                    }
+                    pVoice->position = 0;
+                }
+                const int remaining = pVoice->frameCount - pVoice->position;
+                const int count = frameCount - filled < remaining ? frameCount - filled : remaining;
+                if (pVoice->sourceType == SourceType_PcmInt16)
+                {
+                    ReadPcm(pLeft + filled, pRight + filled, static_cast<const int16_t*>(pVoice->pSamples), pVoice->channelCount, pVoice->position, count);
+                }
+                else
+                {
+                    ReadPcm(pLeft + filled, pRight + filled, static_cast<const float*>(pVoice->pSamples), pVoice->channelCount, pVoice->position, count);
+                }
+                pVoice->position += count;
+                filled += count;
+            }
+            // A voice that does not loop stops on its last frame, not at the start of the next block.
+            if (pVoice->position == pVoice->frameCount && !pVoice->isLooping)
+            {
+                pVoice->isPlaying = false;
+            }
+            for (int i = filled; i < frameCount; ++i)
+            {
+                pLeft[i] = 0.0f;
+                pRight[i] = 0.0f;
+            }
+        }
+
+        // The SIMD loops run over whole vectors, the lanes past the end add silence.
+        const int paddedCount = SimdUtil::RoundUp(frameCount, SimdUtil::LaneCount);
+        for (int i = frameCount; i < paddedCount; ++i)
+        {
+            pLeft[i] = 0.0f;
+            pRight[i] = 0.0f;
+        }
+    }
+
+    void Mixer::MixBlock(int frameCount)
+    {
+        assert(0 < frameCount && frameCount <= BlockFrameCount);
+        const int paddedCount = SimdUtil::RoundUp(frameCount, SimdUtil::LaneCount);
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            float* pAccumulator = m_pAccumulator[ch];
+            for (int i = 0; i < paddedCount; ++i)
+            {
+                pAccumulator[i] = 0.0f;
+            }
+        }
+
+        m_MixedVoiceCount = 0;
+        for (size_t voice = 0; voice < m_Voices.size(); ++voice)
+        {
+            Voice& v = m_Voices[voice];
+            if (v.sourceType == SourceType_None || !v.isPlaying)
+            {
+                continue;
+            }
+
+            // Silent voices still advance, so they come back in time when their gain returns.
+            ReadSource(&v, frameCount);
+            const bool isSilent = v.outputGain[0].remaining == 0 && v.outputGain[1].remaining == 0
+                && v.outputGain[0].value == 0.0f && v.outputGain[1].value == 0.0f;
+            if (isSilent)
+            {
+                continue;
+            }
+            ++m_MixedVoiceCount;
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                const float* pSource = m_pSource[v.channelCount == 1 ? 0 : ch];
+                Ramp& ramp = v.outputGain[ch];
+                if (ramp.remaining == 0)
+                {
+                    if (ramp.value != 0.0f)
+                    {
+                        Accumulate(m_pAccumulator[ch], pSource, ramp.value, paddedCount);
+                    }
+                    continue;
+                }
+                const int rampCount = ramp.remaining < frameCount ? ramp.remaining : frameCount;
+                AccumulateRamp(m_pAccumulator[ch], pSource, ramp.value, ramp.step, rampCount, paddedCount);
+                // Recomputed from the target, so a long ramp does not drift.
+                ramp.remaining -= rampCount;
+                ramp.value = ramp.remaining == 0 ? ramp.target : ramp.target - ramp.step * static_cast<float>(ramp.remaining);
+            }
+        }
+
+        if (m_pEffectChain != nullptr)
+        {
+            m_pEffectChain->Process(m_pAccumulator, frameCount);
+        }
+    }
+
+    int64_t Mixer::GetTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Mixer::EndBlock(int64_t startTime, int frameCount)
+    {
+        const int cost = static_cast<int>(GetTime() - startTime);
+        m_StatVoiceCount.store(m_MixedVoiceCount, std::memory_order_relaxed);
+        m_StatLastBlockNanoSeconds.store(cost, std::memory_order_relaxed);
+        m_StatLastBlockFrameCount.store(frameCount, std::memory_order_relaxed);
+
+        // The peak is the block with the highest load, short blocks are not favored.
+        const int peakCost = m_StatPeakBlockNanoSeconds.load(std::memory_order_relaxed);
+        const int peakFrameCount = m_StatPeakBlockFrameCount.load(std::memory_order_relaxed);
+        if (peakFrameCount == 0 || static_cast<int64_t>(cost) * peakFrameCount > static_cast<int64_t>(peakCost) * frameCount)
+        {
+            m_StatPeakBlockNanoSeconds.store(cost, std::memory_order_relaxed);
+            m_StatPeakBlockFrameCount.store(frameCount, std::memory_order_relaxed);
+        }
+        m_StatBlockCount.store(m_StatBlockCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    MixerStats Mixer::GetStats() const
+    {
+        MixerStats stats;
+        stats.blockCount = m_StatBlockCount.load(std::memory_order_acquire);
+        stats.voiceCount = m_StatVoiceCount.load(std::memory_order_relaxed);
+        const int lastCost = m_StatLastBlockNanoSeconds.load(std::memory_order_relaxed);
+        const int lastFrameCount = m_StatLastBlockFrameCount.load(std::memory_order_relaxed);
+        const int peakCost = m_StatPeakBlockNanoSeconds.load(std::memory_order_relaxed);
+        const int peakFrameCount = m_StatPeakBlockFrameCount.load(std::memory_order_relaxed);
+        stats.lastBlockMicroSeconds = lastCost / 1000;
+        stats.peakBlockMicroSeconds = peakCost / 1000;
+        stats.lastLoad = lastFrameCount == 0 ? 0.0f : static_cast<float>(static_cast<double>(lastCost) * m_SampleRate / (lastFrameCount * 1e9));
+        stats.peakLoad = peakFrameCount == 0 ? 0.0f : static_cast<float>(static_cast<double>(peakCost) * m_SampleRate / (peakFrameCount * 1e9));
+        return stats;
+    }
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "AudioSampleTraits.h"
+
+namespace AUS {
+
+    class EffectChain;
+
+    // What a block of the mixer cost, the effect chain included. Load is the cost over the
+    // duration of the audio it made, 1.0 means the mixer alone would use the whole audio thread.
+    struct MixerStats
+    {
+        int voiceCount;            // Voices that were mixed into the last block.
+        int blockCount;            // Blocks mixed since construction.
+        int lastBlockMicroSeconds; // Cost of the last block.
+        int peakBlockMicroSeconds; // Worst block since construction.
+        float lastLoad;
+        float peakLoad;
+    };
+
+    // A software mixer that sums many voices into an interleaved output buffer.
+    //
+    // A voice either plays a PCM buffer, mono or interleaved stereo, or pulls mono samples from
+    // a render function such as an oscillator. Every voice has a gain and a pan; both can move
+    // to a new value over a ramp that is exact to the frame, so changes never click.
+    //
+    // Mixing runs in blocks of BlockFrameCount frames. Every voice is converted to float and
+    // added to one left and one right accumulator with SIMD loops, and only the finished block
+    // is saturated into the sample format of the output. The mixer is not thread safe, drive it
+    // from the audio thread and send it changes through a command ring.
+    class Mixer
+    {
+    public:
+        // Writes frameCount mono samples to pOut.
+        typedef void (*RenderFunction)(float* pOut, int frameCount, void* pUserArg);
+
+        static const int InvalidVoice = -1;
+        static const int BlockFrameCount = 256;
+
+        Mixer(int sampleRate, int voiceCountMax);
+        ~Mixer();
+
+        // pSamples is interleaved and must stay valid while the voice exists.
+        // A voice that does not loop stops on its last frame and stays silent until removed.
+        // Returns InvalidVoice when the mixer is full.
+        int AddPcmVoice(const int16_t* pSamples, int channelCount, int frameCount, bool isLooping);
+        int AddPcmVoice(const float* pSamples, int channelCount, int frameCount, bool isLooping);
+        int AddRenderVoice(RenderFunction renderFunction, void* pUserArg);
+        void RemoveVoice(int voice);
+
+        // False once a voice that does not loop has played its last frame.
+        bool IsPlaying(int voice) const;
+        // Restarts a PCM voice at frame.
+        void SetPosition(int voice, int frame);
+        int GetPosition(int voice) const;
+
+        // The gain reaches its new value after rampFrameCount frames, 0 jumps at once.
+        void SetGain(int voice, float gain, int rampFrameCount);
+        // pan runs from -1, left, to 1, right, with an equal power law.
+        void SetPan(int voice, float pan, int rampFrameCount);
+        float GetGain(int voice) const;
+        float GetPan(int voice) const;
+
+        int GetVoiceCount() const { return m_VoiceCount; }
+        int GetSampleRate() const { return m_SampleRate; }
+
+        // Runs every mixed block through pChain before it is written out, nullptr for none.
+        // The chain stays owned by the caller.
+        void SetEffectChain(EffectChain* pChain) { m_pEffectChain = pChain; }
+
+        // Overwrites frameCount interleaved frames of pOut with the mix. Stereo voices go to the
+        // first two channels, a mono output gets the two folded together.
+        template <typename SampleT>
+        void Mix(SampleT* pOut, int channelCount, int frameCount)
+        {
+            for (int offset = 0; offset < frameCount; offset += BlockFrameCount)
+            {
+                const int count = frameCount - offset < BlockFrameCount ? frameCount - offset : BlockFrameCount;
+                const int64_t startTime = GetTime();
+                MixBlock(count);
+                WriteBlock(pOut + offset * channelCount, channelCount, count);
+                EndBlock(startTime, count);
+            }
+        }
+
+        // Safe to call from any thread, the fields are read one by one.
+        MixerStats GetStats() const;
+
+    private:
+        Mixer(const Mixer&);
+        Mixer& operator=(const Mixer&);
+
+        enum SourceType
+        {
+            SourceType_None,
+            SourceType_PcmInt16,
+            SourceType_PcmFloat,
+            SourceType_Render
+        };
+
+        // A linear move of one output gain, exact to the frame.
+        struct Ramp
+        {
+            float value;
+            float target;
+            float step;
+            int remaining;
+        };
+
+        struct Voice
+        {
+            SourceType sourceType;
+            const void* pSamples;
+            int channelCount;
+            int frameCount;
+            int position;
+            bool isLooping;
+            bool isPlaying;
+            RenderFunction renderFunction;
+            void* pUserArg;
+            float gain;
+            float pan;
+            Ramp outputGain[2];
+        };
+
+        int AddVoice();
+        void UpdateOutputGains(Voice* pVoice, int rampFrameCount);
+        void ReadSource(Voice* pVoice, int frameCount);
+        void MixBlock(int frameCount);
+
+        template <typename SampleT>
+        void WriteBlock(SampleT* pOut, int channelCount, int frameCount)
+        {
+            const float* pLeft = m_pAccumulator[0];
+            const float* pRight = m_pAccumulator[1];
+            if (channelCount == 1)
+            {
+                // A centered voice keeps its level in mono.
+                for (int i = 0; i < frameCount; ++i)
+                {
+                    pOut[i] = SampleTraits<SampleT>::FromFloat((pLeft[i] + pRight[i]) * 0.70710678f);
+                }
+                return;
+            }
+            const SampleT silence = SampleTraits<SampleT>::FromFloat(0.0f);
+            for (int i = 0; i < frameCount; ++i)
+            {
+                SampleT* pFrame = pOut + i * channelCount;
+                pFrame[0] = SampleTraits<SampleT>::FromFloat(pLeft[i]);
+                pFrame[1] = SampleTraits<SampleT>::FromFloat(pRight[i]);
+                for (int ch = 2; ch < channelCount; ++ch)
+                {
+                    pFrame[ch] = silence;
+                }
+            }
+        }
+
+        static int64_t GetTime();
+        void EndBlock(int64_t startTime, int frameCount);
+
+        int m_SampleRate;
+        int m_VoiceCount;
+        std::vector<Voice> m_Voices;
+        std::vector<int> m_FreeVoices;
+
+        // One block each, SIMD aligned: the accumulators and the source of the current voice.
+        void* m_pMemory;
+        float* m_pAccumulator[2];
+        float* m_pSource[2];
+        EffectChain* m_pEffectChain;
+
+        // Stats the mixing thread publishes.
+        int m_MixedVoiceCount;
+        std::atomic<int> m_StatVoiceCount;
+        std::atomic<int> m_StatBlockCount;
+        std::atomic<int> m_StatLastBlockNanoSeconds;
+        std::atomic<int> m_StatPeakBlockNanoSeconds;
+        std::atomic<int> m_StatLastBlockFrameCount;
+        std::atomic<int> m_StatPeakBlockFrameCount;
+    };
+
+}
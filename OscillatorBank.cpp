@@ -0,0 +1,365 @@
+#include "OscillatorBank.h"
+
+#include <cassert>
+
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    namespace {
+
+        using SimdUtil::Vec;
+
+        // Polynomial residual of a step of height 2 at phase 0, t is the phase and dt the increment.
+        inline Vec PolyBlep(Vec t, Vec dt, Vec invDt)
+        {
+            const Vec one = SimdUtil::Set(1.0f);
+            const Vec before = SimdUtil::Mul(SimdUtil::Sub(t, one), invDt); // In (-1, 0) just before the wrap.
+            const Vec after = SimdUtil::Mul(t, invDt);                     // In [0, 1) just after it.
+            // before^2 + 2 before + 1 and 2 after - after^2 - 1
+            const Vec blepBefore = SimdUtil::Add(SimdUtil::Mul(before, SimdUtil::Add(before, SimdUtil::Set(2.0f))), one);
+            const Vec blepAfter = SimdUtil::Sub(SimdUtil::Mul(after, SimdUtil::Sub(SimdUtil::Set(2.0f), after)), one);
+            const Vec result = SimdUtil::Select(SimdUtil::Less(SimdUtil::Sub(one, dt), t), blepBefore, SimdUtil::Set(0.0f));
+            return SimdUtil::Select(SimdUtil::Less(t, dt), blepAfter, result);
+        }
+
+        // Integral of PolyBlep for a unit change of slope at phase 0.
+        inline Vec PolyBlamp(Vec t, Vec dt, Vec invDt)
+        {
+            const Vec one = SimdUtil::Set(1.0f);
+            const Vec sixth = SimdUtil::Set(1.0f / 6.0f);
+            const Vec before = SimdUtil::Add(SimdUtil::Mul(SimdUtil::Sub(t, one), invDt), one);
+            const Vec after = SimdUtil::Sub(one, SimdUtil::Mul(t, invDt));
+            const Vec blampBefore = SimdUtil::Mul(SimdUtil::Mul(before, before), SimdUtil::Mul(before, sixth));
+            const Vec blampAfter = SimdUtil::Mul(SimdUtil::Mul(after, after), SimdUtil::Mul(after, sixth));
+            const Vec result = SimdUtil::Select(SimdUtil::Less(SimdUtil::Sub(one, dt), t), blampBefore, SimdUtil::Set(0.0f));
+            return SimdUtil::Select(SimdUtil::Less(t, dt), blampAfter, result);
+        }
+
+        // t - 1 for t in [1, 2), t otherwise.
+        inline Vec Wrap(Vec t)
+        {
+            const Vec one = SimdUtil::Set(1.0f);
+            return SimdUtil::Select(SimdUtil::LessEqual(one, t), SimdUtil::Sub(t, one), t);
+        }
+
+        // sin(2 pi t) for t in [0, 1). The absolute error is below 2e-6.
+        inline Vec SinTurn(Vec t)
+        {
+            // sin(2 pi t) = -sin(pi u) with u in [-1, 1), folded into [-1/2, 1/2].
+            const Vec one = SimdUtil::Set(1.0f);
+            Vec u = SimdUtil::Sub(SimdUtil::Add(t, t), one);
+            u = SimdUtil::Select(SimdUtil::Less(SimdUtil::Set(0.5f), u), SimdUtil::Sub(one, u), u);
+            u = SimdUtil::Select(SimdUtil::Less(u, SimdUtil::Set(-0.5f)), SimdUtil::Sub(SimdUtil::Set(-1.0f), u), u);
+            const Vec z = SimdUtil::Mul(u, SimdUtil::Set(-3.14159265f));
+            const Vec z2 = SimdUtil::Mul(z, z);
+            Vec p = SimdUtil::Set(1.0f / 362880.0f);
+            p = SimdUtil::Add(SimdUtil::Mul(p, z2), SimdUtil::Set(-1.0f / 5040.0f));
+            p = SimdUtil::Add(SimdUtil::Mul(p, z2), SimdUtil::Set(1.0f / 120.0f));
+            p = SimdUtil::Add(SimdUtil::Mul(p, z2), SimdUtil::Set(-1.0f / 6.0f));
+            p = SimdUtil::Add(SimdUtil::Mul(p, z2), one);
+            return SimdUtil::Mul(z, p);
+        }
+
+    }
+
+    OscillatorBank::OscillatorBank(int sampleRate, int voiceCountMax)
+        : m_SampleRate(sampleRate)
+        , m_VoiceCountMax(voiceCountMax)
+        , m_VoiceCount(0)
+        , m_SlotCount(SimdUtil::RoundUp(voiceCountMax, SimdUtil::MaxLaneCount))
+        , m_pMemory(nullptr)
+        , m_VoiceWaveform(voiceCountMax, Waveform_Square)
+        , m_VoiceToSlot(voiceCountMax, -1)
+    {
+        assert(sampleRate > 0);
+        assert(voiceCountMax > 0);
+
+        // Six arrays of 4 byte elements and the block of values per group, every one of them starts aligned.
+        const int ArrayCount = 6;
+        const size_t arraySize = sizeof(float) * m_SlotCount;
+        const size_t groupSize = arraySize * (ArrayCount + BlockFrameCount);
+        m_pMemory = SimdUtil::AlignedAllocate(groupSize * Waveform_Count);
+        assert(m_pMemory != nullptr);
+
+        char* p = static_cast<char*>(m_pMemory);
+        for (int i = 0; i < Waveform_Count; ++i)
+        {
+            Group& group = m_Groups[i];
+            group.pPhase = reinterpret_cast<float*>(p + arraySize * 0);
+            group.pIncrement = reinterpret_cast<float*>(p + arraySize * 1);
+            group.pInvIncrement = reinterpret_cast<float*>(p + arraySize * 2);
+            group.pAmplitude = reinterpret_cast<float*>(p + arraySize * 3);
+            group.pChannel = reinterpret_cast<int*>(p + arraySize * 4);
+            group.pVoice = reinterpret_cast<int*>(p + arraySize * 5);
+            group.pValue = reinterpret_cast<float*>(p + arraySize * 6);
+            group.count = 0;
+            p += groupSize;
+
+            for (int slot = 0; slot < m_SlotCount; ++slot)
+            {
+                group.pPhase[slot] = 0.0f;
+                group.pIncrement[slot] = 0.0f;
+                group.pInvIncrement[slot] = 0.0f;
+                group.pAmplitude[slot] = 0.0f;
+                group.pChannel[slot] = 0;
+                group.pVoice[slot] = InvalidVoice;
+            }
+        }
+
+        m_FreeVoices.reserve(voiceCountMax);
+        for (int voice = voiceCountMax - 1; voice >= 0; --voice)
+        {
+            m_FreeVoices.push_back(voice);
+        }
+    }
+
+    OscillatorBank::~OscillatorBank()
+    {
+        SimdUtil::AlignedFree(m_pMemory);
+    }
+
+    int OscillatorBank::AddVoice(Waveform waveform, float frequency, float amplitude, int channel)
+    {
+        assert(0 <= waveform && waveform < Waveform_Count);
+        assert(channel >= 0);
+        if (m_FreeVoices.empty())
+        {
+            return InvalidVoice;
+        }
+        const int voice = m_FreeVoices.back();
+        m_FreeVoices.pop_back();
+        ++m_VoiceCount;
+
+        Group& group = m_Groups[waveform];
+        const int slot = AddSlot(waveform, voice);
+        group.pPhase[slot] = 0.0f;
+        group.pAmplitude[slot] = amplitude;
+        group.pChannel[slot] = channel;
+        SetIncrement(&group, slot, frequency);
+        return voice;
+    }
+
+    void OscillatorBank::RemoveVoice(int voice)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        RemoveSlot(m_VoiceWaveform[voice], m_VoiceToSlot[voice]);
+        m_VoiceToSlot[voice] = -1;
+        m_FreeVoices.push_back(voice);
+        --m_VoiceCount;
+    }
+
+    void OscillatorBank::SetWaveform(int voice, Waveform waveform)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        assert(0 <= waveform && waveform < Waveform_Count);
+        if (m_VoiceWaveform[voice] == waveform)
+        {
+            return;
+        }
+
+        const Waveform fromWaveform = m_VoiceWaveform[voice];
+        const Group& from = m_Groups[fromWaveform];
+        const int fromSlot = m_VoiceToSlot[voice];
+        Group& to = m_Groups[waveform];
+        const int slot = AddSlot(waveform, voice);
+        to.pPhase[slot] = from.pPhase[fromSlot];
+        to.pIncrement[slot] = from.pIncrement[fromSlot];
+        to.pInvIncrement[slot] = from.pInvIncrement[fromSlot];
+        to.pAmplitude[slot] = from.pAmplitude[fromSlot];
+        to.pChannel[slot] = from.pChannel[fromSlot];
+        RemoveSlot(fromWaveform, fromSlot);
+    }
+
+    void OscillatorBank::SetFrequency(int voice, float frequency)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        SetIncrement(&m_Groups[m_VoiceWaveform[voice]], m_VoiceToSlot[voice], frequency);
+    }
+
+    void OscillatorBank::SetAmplitude(int voice, float amplitude)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        m_Groups[m_VoiceWaveform[voice]].pAmplitude[m_VoiceToSlot[voice]] = amplitude;
+    }
+
+    void OscillatorBank::SetChannel(int voice, int channel)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        assert(channel >= 0);
+        m_Groups[m_VoiceWaveform[voice]].pChannel[m_VoiceToSlot[voice]] = channel;
+    }
+
+    void OscillatorBank::SetPhase(int voice, float phase)
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        assert(0.0f <= phase && phase < 1.0f);
+        m_Groups[m_VoiceWaveform[voice]].pPhase[m_VoiceToSlot[voice]] = phase;
+    }
+
+    float OscillatorBank::GetPhase(int voice) const
+    {
+        assert(0 <= voice && voice < m_VoiceCountMax && m_VoiceToSlot[voice] >= 0);
+        return m_Groups[m_VoiceWaveform[voice]].pPhase[m_VoiceToSlot[voice]];
+    }
+
+    void OscillatorBank::Render(float* pOut, int channelCount, int frameCount)
+    {
+        assert(pOut != nullptr || frameCount == 0);
+        assert(channelCount > 0);
+
+        const int LaneCount = SimdUtil::LaneCount;
+        const int stride = m_SlotCount;
+        const Vec zero = SimdUtil::Set(0.0f);
+        const Vec half = SimdUtil::Set(0.5f);
+        const Vec one = SimdUtil::Set(1.0f);
+
+        for (int offset = 0; offset < frameCount; offset += BlockFrameCount)
+        {
+            const int blockFrameCount = frameCount - offset < BlockFrameCount ? frameCount - offset : BlockFrameCount;
+
+            // One SIMD loop per waveform, the state of a vector of voices stays in registers for the
+            // whole block. The padding slots have no amplitude and no increment.
+            {
+                const Group& group = m_Groups[Waveform_Square];
+                for (int i = 0; i < group.count; i += LaneCount)
+                {
+                    Vec t = SimdUtil::Load(group.pPhase + i);
+                    const Vec dt = SimdUtil::Load(group.pIncrement + i);
+                    const Vec invDt = SimdUtil::Load(group.pInvIncrement + i);
+                    const Vec amplitude = SimdUtil::Load(group.pAmplitude + i);
+                    for (int frame = 0; frame < blockFrameCount; ++frame)
+                    {
+                        const Vec naive = SimdUtil::Select(SimdUtil::Less(t, half), one, SimdUtil::Set(-1.0f));
+                        const Vec blep = SimdUtil::Sub(PolyBlep(t, dt, invDt), PolyBlep(Wrap(SimdUtil::Add(t, half)), dt, invDt));
+                        SimdUtil::Store(group.pValue + frame * stride + i, SimdUtil::Mul(SimdUtil::Add(naive, blep), amplitude));
+                        t = Wrap(SimdUtil::Add(t, dt));
+                    }
+                    SimdUtil::Store(group.pPhase + i, t);
+                }
+            }
+            {
+                const Group& group = m_Groups[Waveform_Saw];
+                for (int i = 0; i < group.count; i += LaneCount)
+                {
+                    Vec t = SimdUtil::Load(group.pPhase + i);
+                    const Vec dt = SimdUtil::Load(group.pIncrement + i);
+                    const Vec invDt = SimdUtil::Load(group.pInvIncrement + i);
+                    const Vec amplitude = SimdUtil::Load(group.pAmplitude + i);
+                    for (int frame = 0; frame < blockFrameCount; ++frame)
+                    {
+                        const Vec naive = SimdUtil::Sub(SimdUtil::Add(t, t), one);
+                        const Vec value = SimdUtil::Sub(naive, PolyBlep(t, dt, invDt));
+                        SimdUtil::Store(group.pValue + frame * stride + i, SimdUtil::Mul(value, amplitude));
+                        t = Wrap(SimdUtil::Add(t, dt));
+                    }
+                    SimdUtil::Store(group.pPhase + i, t);
+                }
+            }
+            {
+                // The slope turns by +8 at phase 0 and by -8 at phase 1/2.
+                const Group& group = m_Groups[Waveform_Triangle];
+                for (int i = 0; i < group.count; i += LaneCount)
+                {
+                    Vec t = SimdUtil::Load(group.pPhase + i);
+                    const Vec dt = SimdUtil::Load(group.pIncrement + i);
+                    const Vec invDt = SimdUtil::Load(group.pInvIncrement + i);
+                    const Vec amplitude = SimdUtil::Load(group.pAmplitude + i);
+                    const Vec cornerScale = SimdUtil::Mul(SimdUtil::Set(8.0f), dt);
+                    for (int frame = 0; frame < blockFrameCount; ++frame)
+                    {
+                        const Vec fromCenter = SimdUtil::Sub(t, half);
+                        const Vec distance = SimdUtil::Max(fromCenter, SimdUtil::Sub(zero, fromCenter));
+                        const Vec naive = SimdUtil::Sub(one, SimdUtil::Mul(SimdUtil::Set(4.0f), distance));
+                        const Vec corners = SimdUtil::Sub(PolyBlamp(t, dt, invDt), PolyBlamp(Wrap(SimdUtil::Add(t, half)), dt, invDt));
+                        const Vec value = SimdUtil::Add(naive, SimdUtil::Mul(cornerScale, corners));
+                        SimdUtil::Store(group.pValue + frame * stride + i, SimdUtil::Mul(value, amplitude));
+                        t = Wrap(SimdUtil::Add(t, dt));
+                    }
+                    SimdUtil::Store(group.pPhase + i, t);
+                }
+            }
+            {
+                const Group& group = m_Groups[Waveform_Sine];
+                for (int i = 0; i < group.count; i += LaneCount)
+                {
+                    Vec t = SimdUtil::Load(group.pPhase + i);
+                    const Vec dt = SimdUtil::Load(group.pIncrement + i);
+                    const Vec amplitude = SimdUtil::Load(group.pAmplitude + i);
+                    for (int frame = 0; frame < blockFrameCount; ++frame)
+                    {
+                        SimdUtil::Store(group.pValue + frame * stride + i, SimdUtil::Mul(SinTurn(t), amplitude));
+                        t = Wrap(SimdUtil::Add(t, dt));
+                    }
+                    SimdUtil::Store(group.pPhase + i, t);
+                }
+            }
+
+            // Mix every voice into its channel. The frames of a voice are independent, so the adds pipeline.
+            float* pBlock = pOut + offset * channelCount;
+            for (int w = 0; w < Waveform_Count; ++w)
+            {
+                const Group& group = m_Groups[w];
+                for (int i = 0; i < group.count; ++i)
+                {
+                    const int channel = group.pChannel[i];
+                    if (channel >= channelCount)
+                    {
+                        continue;
+                    }
+                    const float* pValue = group.pValue + i;
+                    float* pChannelOut = pBlock + channel;
+                    for (int frame = 0; frame < blockFrameCount; ++frame)
+                    {
+                        pChannelOut[frame * channelCount] += pValue[frame * stride];
+                    }
+                }
+            }
+        }
+    }
+
+    int OscillatorBank::AddSlot(Waveform waveform, int voice)
+    {
+        Group& group = m_Groups[waveform];
+        assert(group.count < m_VoiceCountMax);
+        const int slot = group.count++;
+        group.pVoice[slot] = voice;
+        m_VoiceWaveform[voice] = waveform;
+        m_VoiceToSlot[voice] = slot;
+        return slot;
+    }
+
+    void OscillatorBank::RemoveSlot(Waveform waveform, int slot)
+    {
+        // Move the last voice into the hole and silence the slot it leaves.
+        Group& group = m_Groups[waveform];
+        const int last = --group.count;
+        if (slot != last)
+        {
+            group.pPhase[slot] = group.pPhase[last];
+            group.pIncrement[slot] = group.pIncrement[last];
+            group.pInvIncrement[slot] = group.pInvIncrement[last];
+            group.pAmplitude[slot] = group.pAmplitude[last];
+            group.pChannel[slot] = group.pChannel[last];
+            group.pVoice[slot] = group.pVoice[last];
+            m_VoiceToSlot[group.pVoice[slot]] = slot;
+        }
+        group.pPhase[last] = 0.0f;
+        group.pIncrement[last] = 0.0f;
+        group.pInvIncrement[last] = 0.0f;
+        group.pAmplitude[last] = 0.0f;
+        group.pVoice[last] = InvalidVoice;
+    }
+
+    void OscillatorBank::SetIncrement(Group* pGroup, int slot, float frequency)
+    {
+        assert(frequency >= 0.0f);
+
+        // Keep the frequency below Nyquist so the PolyBLEP regions of a period never overlap.
+        float increment = frequency / static_cast<float>(m_SampleRate);
+        increment = increment < 0.499f ? increment : 0.499f;
+        pGroup->pIncrement[slot] = increment;
+        pGroup->pInvIncrement[slot] = increment > 0.0f ? 1.0f / increment : 0.0f;
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+namespace AUS {
+
+    enum Waveform
+    {
+        Waveform_Square,
+        Waveform_Saw,
+        Waveform_Triangle,
+        Waveform_Sine,
+        Waveform_Count
+    };
+
+    // A bank of phase accumulator oscillators.
+    //
+    // Every voice keeps a fractional phase in [0, 1) that advances by frequency / sampleRate
+    // per sample, so pitch is exact and there is no state outside the object.
+    // Square and saw are band-limited with PolyBLEP and triangle with PolyBLAMP, which
+    // removes most of the aliasing of the naive shapes at little cost.
+    //
+    // The voices of each waveform are kept as structure of arrays padded to the SIMD width,
+    // so every sample runs one branch free SIMD loop per waveform across its voices.
+    class OscillatorBank
+    {
+    public:
+        static const int InvalidVoice = -1;
+
+        OscillatorBank(int sampleRate, int voiceCountMax);
+        ~OscillatorBank();
+
+        // Adds a voice that plays into output channel channel. Returns InvalidVoice when the bank is full.
+        int AddVoice(Waveform waveform, float frequency, float amplitude, int channel);
+        void RemoveVoice(int voice);
+
+        // Changing the waveform keeps the phase, so the pitch stays continuous.
+        void SetWaveform(int voice, Waveform waveform);
+        void SetFrequency(int voice, float frequency);
+        void SetAmplitude(int voice, float amplitude);
+        void SetChannel(int voice, int channel);
+        // phase is a fraction of a period in [0, 1).
+        void SetPhase(int voice, float phase);
+        float GetPhase(int voice) const;
+
+        int GetVoiceCount() const { return m_VoiceCount; }
+        int GetSampleRate() const { return m_SampleRate; }
+
+        // Adds frameCount interleaved frames of every voice to pOut.
+        // Voices whose channel is not below channelCount are skipped.
+        void Render(float* pOut, int channelCount, int frameCount);
+
+    private:
+        OscillatorBank(const OscillatorBank&);
+        OscillatorBank& operator=(const OscillatorBank&);
+
+        // Render works in blocks of this many frames.
+        static const int BlockFrameCount = 32;
+
+        // The voices of one waveform. Slots past count are silent padding up to the SIMD width.
+        struct Group
+        {
+            float* pPhase;
+            float* pIncrement;
+            float* pInvIncrement;
+            float* pAmplitude;
+            int* pChannel;
+            int* pVoice;
+            float* pValue; // Output of the current block, frame major.
+            int count;
+        };
+
+        int AddSlot(Waveform waveform, int voice);
+        void RemoveSlot(Waveform waveform, int slot);
+        void SetIncrement(Group* pGroup, int slot, float frequency);
+
+        int m_SampleRate;
+        int m_VoiceCountMax;
+        int m_VoiceCount;
+        int m_SlotCount; // Per group, padded to the SIMD width.
+        void* m_pMemory;
+        Group m_Groups[Waveform_Count];
+
+        // Per voice.
+        std::vector<Waveform> m_VoiceWaveform;
+        std::vector<int> m_VoiceToSlot;
+        std::vector<int> m_FreeVoices;
+    };
+
+}
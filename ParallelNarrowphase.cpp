@@ -0,0 +1,123 @@
+#include <stdint.h>
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Assert.h>
+
+#include "CollisionWorld.h"
+#include "ParallelNarrowphase.h"
+
+ParallelNarrowphase::ParallelNarrowphase()
+	: m_WorkerCount(0)
+	, m_IsExiting(false)
+	, m_pWorld(nullptr)
+{
+}
+
+ParallelNarrowphase::~ParallelNarrowphase()
+{
+	NN_ASSERT(m_WorkerCount == 0);
+}
+
+size_t ParallelNarrowphase::GetRequiredWorkBufferSize(int workerCount_)
+{
+	NN_ASSERT(0 <= workerCount_ && workerCount_ <= WorkerCountMax);
+	return StackSize * workerCount_;
+}
+
+void ParallelNarrowphase::Initialize(int workerCount_, int firstCore_, void* pWorkBuffer, size_t workBufferSize)
+{
+	NN_ASSERT(m_WorkerCount == 0);
+	NN_ASSERT(workBufferSize >= GetRequiredWorkBufferSize(workerCount_));
+	NN_ASSERT(workerCount_ == 0 || (reinterpret_cast<uintptr_t>(pWorkBuffer) % nn::os::ThreadStackAlignment) == 0);
+	NN_UNUSED(workBufferSize);
+
+	m_IsExiting = false;
+	char* pStack = static_cast<char*>(pWorkBuffer);
+	for (int i = 0; i < workerCount_; ++i)
+	{
+		Worker& worker = m_Workers[i];
+		worker.pOwner = this;
+		worker.bucketBegin = 0;
+		worker.bucketEnd = 0;
+		nn::os::InitializeEvent(&worker.startEvent, false, nn::os::EventClearMode_AutoClear);
+		nn::os::InitializeEvent(&worker.doneEvent, false, nn::os::EventClearMode_AutoClear);
+
+		nn::Result result = nn::os::CreateThread(&worker.thread, WorkerMain, &worker,
+			pStack + StackSize * i, StackSize, nn::os::DefaultThreadPriority, firstCore_ + i);
+		NN_ABORT_UNLESS(result.IsSuccess(), "Cannot create the narrowphase worker thread.");
+		nn::os::SetThreadName(&worker.thread, "CollisionWorker");
+		nn::os::StartThread(&worker.thread);
+	}
+	m_WorkerCount = workerCount_;
+}
+
+void ParallelNarrowphase::Finalize()
+{
+	m_IsExiting = true;
+	for (int i = 0; i < m_WorkerCount; ++i)
+	{
+		nn::os::SignalEvent(&m_Workers[i].startEvent);
+	}
+	for (int i = 0; i < m_WorkerCount; ++i)
+	{
+		Worker& worker = m_Workers[i];
+		nn::os::WaitThread(&worker.thread);
+		nn::os::DestroyThread(&worker.thread);
+		nn::os::FinalizeEvent(&worker.startEvent);
+		nn::os::FinalizeEvent(&worker.doneEvent);
+	}
+	m_WorkerCount = 0;
+}
+
+int ParallelNarrowphase::FindPairs(CollisionWorld* pWorld_, std::vector<CollisionPair>* pOutPairs)
+{
+	NN_ASSERT_NOT_NULL(pWorld_);
+	NN_ASSERT_NOT_NULL(pOutPairs);
+	pOutPairs->clear();
+
+	pWorld_->BuildGrid();
+	m_pWorld = pWorld_;
+
+	int bounds[WorkerCountMax + 2];
+	pWorld_->SplitBuckets(m_WorkerCount + 1, bounds);
+
+	for (int i = 0; i < m_WorkerCount; ++i)
+	{
+		m_Workers[i].bucketBegin = bounds[i + 1];
+		m_Workers[i].bucketEnd = bounds[i + 2];
+		nn::os::SignalEvent(&m_Workers[i].startEvent);
+	}
+
+	// The first range runs here while the workers handle the rest.
+	pWorld_->FindPairsInBuckets(bounds[0], bounds[1], pOutPairs);
+
+	for (int i = 0; i < m_WorkerCount; ++i)
+	{
+		Worker& worker = m_Workers[i];
+		nn::os::WaitEvent(&worker.doneEvent);
+		pOutPairs->insert(pOutPairs->end(), worker.pairs.begin(), worker.pairs.end());
+	}
+
+	m_pWorld = nullptr;
+	return static_cast<int>(pOutPairs->size());
+}
+
+void ParallelNarrowphase::WorkerMain(void* pArg)
+{
+	Worker* pWorker = static_cast<Worker*>(pArg);
+	ParallelNarrowphase* pOwner = pWorker->pOwner;
+
+	for (;;)
+	{
+		nn::os::WaitEvent(&pWorker->startEvent);
+		if (pOwner->m_IsExiting)
+		{
+			break;
+		}
+
+		// The pair list keeps its capacity, so steady frames do not allocate.
+		pWorker->pairs.clear();
+		pOwner->m_pWorld->FindPairsInBuckets(pWorker->bucketBegin, pWorker->bucketEnd, &pWorker->pairs);
+		nn::os::SignalEvent(&pWorker->doneEvent);
+	}
+}
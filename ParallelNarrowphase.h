@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <nn/os.h>
+
+#include "CollisionPair.h"
+
+class CollisionWorld;
+
+//! Runs the CollisionWorld narrowphase on worker threads pinned to the cores the
+//! main thread does not use.
+//! The grid is built on the calling thread, then the buckets are split into
+//! ranges of about equal cost. The calling thread takes the first range and each
+//! worker one of the others. The per-range pair lists are appended in range
+//! order, so the result is identical to CollisionWorld::FindPairs.
+class ParallelNarrowphase
+{
+public:
+	static const int WorkerCountMax = 3;
+	static const size_t StackSize = 16 * 1024;
+
+	ParallelNarrowphase();
+	~ParallelNarrowphase();
+
+	static size_t GetRequiredWorkBufferSize(int workerCount_);
+
+	//! Starts workerCount_ threads on cores firstCore_, firstCore_ + 1, ...
+	//! pWorkBuffer must be aligned to nn::os::ThreadStackAlignment.
+	void Initialize(int workerCount_, int firstCore_, void* pWorkBuffer, size_t workBufferSize);
+	void Finalize();
+
+	int GetWorkerCount() const { return m_WorkerCount; }
+
+	//! Same contract as CollisionWorld::FindPairs.
+	int FindPairs(CollisionWorld* pWorld_, std::vector<CollisionPair>* pOutPairs);
+
+private:
+	ParallelNarrowphase(const ParallelNarrowphase&);
+	ParallelNarrowphase& operator=(const ParallelNarrowphase&);
+
+	struct Worker
+	{
+		nn::os::ThreadType thread;
+		nn::os::EventType startEvent;
+		nn::os::EventType doneEvent;
+		ParallelNarrowphase* pOwner;
+		int bucketBegin;
+		int bucketEnd;
+		std::vector<CollisionPair> pairs;
+	};
+
+	static void WorkerMain(void* pArg);
+
+	Worker m_Workers[WorkerCountMax];
+	int m_WorkerCount;
+	bool m_IsExiting;
+	const CollisionWorld* m_pWorld;
+};
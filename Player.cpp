@@ -1,15 +1,23 @@
-#include <nn/hid.h>
-#include <nn/hid/hid_Npad.h>
-#include <nn/hid/hid_NpadJoy.h>
-
-
-
 #include "Player.h"
 
-Player::Player()
+Player::Player() : m_ControllerIndex(0), m_Speed(0.0f), m_StickX(0.0f), m_StickY(0.0f)
+{
+}
+
+Player::Player(int controllerIndex_, float speed_)
+	: m_ControllerIndex(controllerIndex_)
+	, m_Speed(speed_)
+	, m_StickX(0.0f)
+	, m_StickY(0.0f)
 {
 }
 
 Player::~Player()
 {
-}
\ No newline at end of file
+}
+
+void Player::SetStick(float x_, float y_)
+{
+	m_StickX = x_;
+	m_StickY = y_;
+}
@@ -3,10 +3,21 @@ class Player
 {
 public:
 	Player();
+	Player(int controllerIndex_, float speed_);
 	~Player();
 
+	//! Stick position in [-1, 1] on both axes.
+	void SetStick(float x_, float y_);
 
+	int GetControllerIndex() const { return m_ControllerIndex; }
+	float GetSpeed() const { return m_Speed; }
+	//! Velocity the player asks for this frame.
+	float GetMoveX() const { return m_StickX * m_Speed; }
+	float GetMoveY() const { return m_StickY * m_Speed; }
 
 private:
-
+	int m_ControllerIndex; //!< Index into the sample's Npad id table.
+	float m_Speed;         //!< Units per second at full stick.
+	float m_StickX;
+	float m_StickY;
 };
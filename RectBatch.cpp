@@ -0,0 +1,243 @@
+#include <cassert>
+#include <cstring>
+
+#include "SimdUtil.h"
+#include "CircleBatch.h"
+#include "RectBatch.h"
+
+namespace
+{
+	using SimdUtil::Vec;
+	using SimdUtil::Mask;
+
+	float* AllocateLane(int capacity_)
+	{
+		void* p = SimdUtil::AlignedAllocate(capacity_ * sizeof(float));
+		assert(p != nullptr);
+		std::memset(p, 0, capacity_ * sizeof(float));
+		return static_cast<float*>(p);
+	}
+
+	void ClearMask(uint32_t* pMask_, int count_)
+	{
+		std::memset(pMask_, 0, ((count_ + 31) / 32) * sizeof(uint32_t));
+	}
+
+	// The vector loops run into the padding, drop those lanes again.
+	void TrimMask(uint32_t* pMask_, int count_)
+	{
+		if ((count_ & 31) != 0)
+		{
+			pMask_[count_ >> 5] &= (1u << (count_ & 31)) - 1;
+		}
+	}
+
+	// Same comparisons as Rectangle::inRect.
+	inline Mask InRect(Vec x1_, Vec y1_, Vec x2_, Vec y2_, Vec px_, Vec py_)
+	{
+		Mask inX = SimdUtil::And(SimdUtil::Less(x1_, px_), SimdUtil::Less(px_, x2_));
+		Mask inY = SimdUtil::And(SimdUtil::Less(y1_, py_), SimdUtil::Less(py_, y2_));
+		return SimdUtil::And(inX, inY);
+	}
+
+	// Same comparisons as Rectangle::Overlap.
+	inline Mask RectRect(Vec x1_, Vec y1_, Vec x2_, Vec y2_, Vec ox1_, Vec oy1_, Vec ox2_, Vec oy2_)
+	{
+		Mask overlapX = SimdUtil::And(SimdUtil::Less(x1_, ox2_), SimdUtil::Less(ox1_, x2_));
+		Mask overlapY = SimdUtil::And(SimdUtil::Less(y1_, oy2_), SimdUtil::Less(oy1_, y2_));
+		return SimdUtil::And(overlapX, overlapY);
+	}
+
+	// Same operation sequence as Rectangle::Collide, clamp then squared distance without FMA.
+	inline Mask CircleRect(Vec x1_, Vec y1_, Vec x2_, Vec y2_, Vec cx_, Vec cy_, Vec r_)
+	{
+		Vec nearX = SimdUtil::Max(x1_, SimdUtil::Min(cx_, x2_));
+		Vec nearY = SimdUtil::Max(y1_, SimdUtil::Min(cy_, y2_));
+		Vec xGap = SimdUtil::Sub(cx_, nearX);
+		Vec yGap = SimdUtil::Sub(cy_, nearY);
+		Vec distSq = SimdUtil::Add(SimdUtil::Mul(xGap, xGap), SimdUtil::Mul(yGap, yGap));
+		return SimdUtil::LessEqual(distSq, SimdUtil::Mul(r_, r_));
+	}
+}
+
+RectBatch::RectBatch(int capacity_)
+	: m_X1(nullptr), m_Y1(nullptr), m_X2(nullptr), m_Y2(nullptr), m_Count(0), m_Capacity(0)
+{
+	Reserve(capacity_);
+}
+
+RectBatch::~RectBatch()
+{
+	SimdUtil::AlignedFree(m_X1);
+	SimdUtil::AlignedFree(m_Y1);
+	SimdUtil::AlignedFree(m_X2);
+	SimdUtil::AlignedFree(m_Y2);
+}
+
+void RectBatch::Reserve(int capacity_)
+{
+	capacity_ = SimdUtil::RoundUp(capacity_ > 0 ? capacity_ : 1, SimdUtil::MaxLaneCount);
+	if (capacity_ <= m_Capacity)
+	{
+		return;
+	}
+
+	float* x1 = AllocateLane(capacity_);
+	float* y1 = AllocateLane(capacity_);
+	float* x2 = AllocateLane(capacity_);
+	float* y2 = AllocateLane(capacity_);
+	if (m_Count > 0)
+	{
+		std::memcpy(x1, m_X1, m_Count * sizeof(float));
+		std::memcpy(y1, m_Y1, m_Count * sizeof(float));
+		std::memcpy(x2, m_X2, m_Count * sizeof(float));
+		std::memcpy(y2, m_Y2, m_Count * sizeof(float));
+	}
+	SimdUtil::AlignedFree(m_X1);
+	SimdUtil::AlignedFree(m_Y1);
+	SimdUtil::AlignedFree(m_X2);
+	SimdUtil::AlignedFree(m_Y2);
+
+	m_X1 = x1;
+	m_Y1 = y1;
+	m_X2 = x2;
+	m_Y2 = y2;
+	m_Capacity = capacity_;
+}
+
+void RectBatch::Clear()
+{
+	m_Count = 0;
+}
+
+int RectBatch::Add(const Rectangle& rect_)
+{
+	if (m_Count == m_Capacity)
+	{
+		Reserve(m_Capacity * 2);
+	}
+	Set(m_Count, rect_);
+	return m_Count++;
+}
+
+void RectBatch::Set(int index_, const Rectangle& rect_)
+{
+	assert(0 <= index_ && index_ < m_Capacity);
+	m_X1[index_] = rect_.x1;
+	m_Y1[index_] = rect_.y1;
+	m_X2[index_] = rect_.x2;
+	m_Y2[index_] = rect_.y2;
+}
+
+Rectangle RectBatch::Get(int index_) const
+{
+	assert(0 <= index_ && index_ < m_Count);
+	return Rectangle(m_X1[index_], m_Y1[index_], m_X2[index_], m_Y2[index_]);
+}
+
+int RectBatch::ContainsPoint(float x_, float y_, uint32_t* pOutMask) const
+{
+	ClearMask(pOutMask, m_Count);
+
+	const Vec px = SimdUtil::Set(x_);
+	const Vec py = SimdUtil::Set(y_);
+	for (int i = 0; i < m_Count; i += SimdUtil::LaneCount)
+	{
+		Mask hit = InRect(SimdUtil::Load(m_X1 + i), SimdUtil::Load(m_Y1 + i),
+			SimdUtil::Load(m_X2 + i), SimdUtil::Load(m_Y2 + i), px, py);
+		pOutMask[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+	}
+
+	TrimMask(pOutMask, m_Count);
+	return CountMaskBits(pOutMask, GetMaskWordCount());
+}
+
+int RectBatch::OverlapRect(const Rectangle& rect_, uint32_t* pOutMask) const
+{
+	ClearMask(pOutMask, m_Count);
+
+	const Vec ox1 = SimdUtil::Set(rect_.x1);
+	const Vec oy1 = SimdUtil::Set(rect_.y1);
+	const Vec ox2 = SimdUtil::Set(rect_.x2);
+	const Vec oy2 = SimdUtil::Set(rect_.y2);
+	for (int i = 0; i < m_Count; i += SimdUtil::LaneCount)
+	{
+		Mask hit = RectRect(SimdUtil::Load(m_X1 + i), SimdUtil::Load(m_Y1 + i),
+			SimdUtil::Load(m_X2 + i), SimdUtil::Load(m_Y2 + i), ox1, oy1, ox2, oy2);
+		pOutMask[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+	}
+
+	TrimMask(pOutMask, m_Count);
+	return CountMaskBits(pOutMask, GetMaskWordCount());
+}
+
+int RectBatch::CollideCircle(const Circle& circle_, uint32_t* pOutMask) const
+{
+	ClearMask(pOutMask, m_Count);
+
+	const Vec cx = SimdUtil::Set(circle_.x);
+	const Vec cy = SimdUtil::Set(circle_.y);
+	const Vec r = SimdUtil::Set(circle_.r);
+	for (int i = 0; i < m_Count; i += SimdUtil::LaneCount)
+	{
+		Mask hit = CircleRect(SimdUtil::Load(m_X1 + i), SimdUtil::Load(m_Y1 + i),
+			SimdUtil::Load(m_X2 + i), SimdUtil::Load(m_Y2 + i), cx, cy, r);
+		pOutMask[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+	}
+
+	TrimMask(pOutMask, m_Count);
+	return CountMaskBits(pOutMask, GetMaskWordCount());
+}
+
+int RectContainsPoints(const Rectangle& rect_, const float* pX_, const float* pY_, int count_, uint32_t* pOutMask)
+{
+	ClearMask(pOutMask, count_);
+
+	const Vec x1 = SimdUtil::Set(rect_.x1);
+	const Vec y1 = SimdUtil::Set(rect_.y1);
+	const Vec x2 = SimdUtil::Set(rect_.x2);
+	const Vec y2 = SimdUtil::Set(rect_.y2);
+	const int vectorCount = count_ - count_ % SimdUtil::LaneCount;
+	int i = 0;
+	for (; i < vectorCount; i += SimdUtil::LaneCount)
+	{
+		Mask hit = InRect(x1, y1, x2, y2, SimdUtil::LoadUnaligned(pX_ + i), SimdUtil::LoadUnaligned(pY_ + i));
+		pOutMask[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+	}
+	for (; i < count_; ++i)
+	{
+		if (rect_.inRect(pX_[i], pY_[i]))
+		{
+			pOutMask[i >> 5] |= 1u << (i & 31);
+		}
+	}
+
+	return CountMaskBits(pOutMask, (count_ + 31) / 32);
+}
+
+int RectContainsPoints(const Rectangle& rect_, const CircleBatch& points_, uint32_t* pOutMask)
+{
+	return RectContainsPoints(rect_, points_.GetX(), points_.GetY(), points_.GetCount(), pOutMask);
+}
+
+int RectCollideCircles(const Rectangle& rect_, const CircleBatch& circles_, uint32_t* pOutMask)
+{
+	const int count = circles_.GetCount();
+	ClearMask(pOutMask, count);
+
+	const Vec x1 = SimdUtil::Set(rect_.x1);
+	const Vec y1 = SimdUtil::Set(rect_.y1);
+	const Vec x2 = SimdUtil::Set(rect_.x2);
+	const Vec y2 = SimdUtil::Set(rect_.y2);
+	const float* pX = circles_.GetX();
+	const float* pY = circles_.GetY();
+	const float* pR = circles_.GetR();
+	for (int i = 0; i < count; i += SimdUtil::LaneCount)
+	{
+		Mask hit = CircleRect(x1, y1, x2, y2, SimdUtil::Load(pX + i), SimdUtil::Load(pY + i), SimdUtil::Load(pR + i));
+		pOutMask[i >> 5] |= SimdUtil::MoveMask(hit) << (i & 31);
+	}
+
+	TrimMask(pOutMask, count);
+	return CountMaskBits(pOutMask, circles_.GetMaskWordCount());
+}
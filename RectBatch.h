@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Circle.h"
+#include "Rectangle.h"
+
+class CircleBatch;
+
+//! Structure-of-arrays storage for many rectangles, laid out like CircleBatch:
+//! x1, y1, x2 and y2 in separate aligned arrays padded to SimdUtil::MaxLaneCount.
+//! Results are bitmasks with one bit per rectangle, and every kernel gives the
+//! same answer as the matching Rectangle member.
+class RectBatch
+{
+public:
+	explicit RectBatch(int capacity_ = 0);
+	~RectBatch();
+
+	void Reserve(int capacity_);
+	void Clear();
+
+	int Add(const Rectangle& rect_);
+	void Set(int index_, const Rectangle& rect_);
+	Rectangle Get(int index_) const;
+
+	int GetCount() const { return m_Count; }
+	int GetCapacity() const { return m_Capacity; }
+	int GetMaskWordCount() const { return (m_Count + 31) / 32; }
+
+	//! One point against every rectangle, Rectangle::inRect.
+	int ContainsPoint(float x_, float y_, uint32_t* pOutMask) const;
+
+	//! One rectangle against every rectangle, Rectangle::Overlap.
+	int OverlapRect(const Rectangle& rect_, uint32_t* pOutMask) const;
+
+	//! One circle against every rectangle, Rectangle::Collide.
+	int CollideCircle(const Circle& circle_, uint32_t* pOutMask) const;
+
+private:
+	RectBatch(const RectBatch&);
+	RectBatch& operator=(const RectBatch&);
+
+	float* m_X1;
+	float* m_Y1;
+	float* m_X2;
+	float* m_Y2;
+	int m_Count;
+	int m_Capacity;
+};
+
+//! Tests count_ points against one rectangle with Rectangle::inRect.
+//! The coordinate arrays need no alignment or padding. pOutMask needs (count_ + 31) / 32 words.
+int RectContainsPoints(const Rectangle& rect_, const float* pX_, const float* pY_, int count_, uint32_t* pOutMask);
+
+//! Tests the centers of a CircleBatch against one rectangle, for touch and projectile points.
+int RectContainsPoints(const Rectangle& rect_, const CircleBatch& points_, uint32_t* pOutMask);
+
+//! Tests every circle of a CircleBatch against one rectangle with Rectangle::Collide.
+int RectCollideCircles(const Rectangle& rect_, const CircleBatch& circles_, uint32_t* pOutMask);
@@ -1,3 +1,4 @@
+#include "Circle.h"
 #include "Rectangle.h"
 
 Rectangle::Rectangle() : x1(0.0f), y1(0.0f), x2(0.0f), y2(0.0f)
@@ -12,7 +13,7 @@ Rectangle::Rectangle(float x1_, float y1_, float x2_, float y2_) : x1(x1_), y1(y
 {
 }
 
-bool Rectangle::inRect(float x_, float y_)
+bool Rectangle::inRect(float x_, float y_) const
 {
 	if (x1 < x_ && x_ < x2
 		&& y1 < y_ && y_ < y2)
@@ -22,3 +23,37 @@ bool Rectangle::inRect(float x_, float y_)
 
 	return false;
 }
+
+bool Rectangle::Overlap(const Rectangle& other_) const
+{
+	// Edges are open like in inRect, rectangles that only touch do not overlap.
+	if (x1 < other_.x2 && other_.x1 < x2
+		&& y1 < other_.y2 && other_.y1 < y2)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+bool Rectangle::Collide(const Circle& circle_) const
+{
+	// Closest point of the rectangle to the circle center.
+	float nearX = circle_.x < x2 ? circle_.x : x2;
+	nearX = x1 > nearX ? x1 : nearX;
+	float nearY = circle_.y < y2 ? circle_.y : y2;
+	nearY = y1 > nearY ? y1 : nearY;
+
+	float xGap = circle_.x - nearX;
+	float yGap = circle_.y - nearY;
+	float xSq = xGap * xGap;
+	float ySq = yGap * yGap;
+	float distSq = xSq + ySq;
+
+	if (distSq <= circle_.r * circle_.r)
+	{
+		return true;
+	}
+
+	return false;
+}
@@ -1,4 +1,7 @@
 #pragma once
+
+class Circle;
+
 class Rectangle
 {
 public:
@@ -6,7 +9,9 @@ public:
 	~Rectangle();
 	Rectangle(float x1_,float y1_, float x2_, float y2_);
 
-	bool inRect(float x_, float y_);
+	bool inRect(float x_, float y_) const;
+	bool Overlap(const Rectangle& other_) const;
+	bool Collide(const Circle& circle_) const;
 
 	float x1; //!< bottom left
 	float y1;
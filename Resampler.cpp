@@ -0,0 +1,272 @@
+#include "Resampler.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    namespace {
+
+        struct QualitySettings
+        {
+            int tapCount;
+            float beta;    // Kaiser window shape, higher trades a wider transition for a deeper stopband.
+            float rolloff; // Passband edge as a fraction of the lower Nyquist frequency.
+        };
+
+        const QualitySettings g_QualitySettings[] =
+        {
+            { 8, 5.0f, 0.80f },
+            { 16, 7.0f, 0.88f },
+            { 32, 9.5f, 0.92f },
+        };
+
+        const int MaxTapCount = 256;
+
+        int GetGreatestCommonDivisor(int a, int b)
+        {
+            while (b != 0)
+            {
+                const int r = a % b;
+                a = b;
+                b = r;
+            }
+            return a;
+        }
+
+        // Modified Bessel function of the first kind, order 0.
+        double BesselI0(double x)
+        {
+            const double q = x * x / 4.0;
+            double term = 1.0;
+            double sum = 1.0;
+            for (int k = 1; term > sum * 1e-12; ++k)
+            {
+                term *= q / (static_cast<double>(k) * k);
+                sum += term;
+            }
+            return sum;
+        }
+
+        float Dot(const float* pFilter, const float* pInput, int tapCount)
+        {
+            using SimdUtil::Vec;
+            Vec sum = SimdUtil::Mul(SimdUtil::Load(pFilter), SimdUtil::LoadUnaligned(pInput));
+            for (int i = SimdUtil::LaneCount; i < tapCount; i += SimdUtil::LaneCount)
+            {
+                sum = SimdUtil::Add(sum, SimdUtil::Mul(SimdUtil::Load(pFilter + i), SimdUtil::LoadUnaligned(pInput + i)));
+            }
+            return SimdUtil::Sum(sum);
+        }
+
+    }
+
+    Resampler::Resampler(int inputRate, int outputRate, int channelCount, ResamplerQuality quality,
+        SourceFunction sourceFunction, void* pUserArg)
+        : m_InputRate(inputRate)
+        , m_OutputRate(outputRate)
+        , m_ChannelCount(channelCount)
+        , m_SourceFunction(sourceFunction)
+        , m_pUserArg(pUserArg)
+        , m_pFilter(nullptr)
+        , m_pInput(nullptr)
+        , m_pInterleaved(nullptr)
+        , m_InputCapacity(0)
+        , m_InputFrameCount(0)
+        , m_Base(0)
+        , m_Fraction(0)
+    {
+        assert(inputRate > 0 && outputRate > 0);
+        assert(channelCount > 0);
+        assert(sourceFunction != nullptr);
+        assert(0 <= quality && quality <= ResamplerQuality_High);
+
+        const int divisor = GetGreatestCommonDivisor(inputRate, outputRate);
+        m_Up = outputRate / divisor;
+        m_Down = inputRate / divisor;
+        if (m_Up == m_Down)
+        {
+            m_TapCount = 0;
+            m_PhaseCount = 1;
+            m_IsExact = true;
+            return;
+        }
+
+        // Downsampling narrows the passband in input frames, more taps keep the transition as sharp.
+        const QualitySettings& settings = g_QualitySettings[quality];
+        int tapCount = settings.tapCount;
+        if (m_Down > m_Up)
+        {
+            tapCount = static_cast<int>(std::ceil(static_cast<double>(tapCount) * m_Down / m_Up));
+        }
+        tapCount = SimdUtil::RoundUp(tapCount, SimdUtil::MaxLaneCount);
+        m_TapCount = tapCount < MaxTapCount ? tapCount : MaxTapCount;
+
+        m_IsExact = m_Up <= MaxPhaseCount;
+        m_PhaseCount = m_IsExact ? m_Up : MaxPhaseCount;
+        const float cutoff = 0.5f * settings.rolloff * (m_Up < m_Down ? static_cast<float>(m_Up) / m_Down : 1.0f);
+        BuildFilter(cutoff, settings.beta);
+
+        // The history keeps the taps of one output frame, a block arrives behind it.
+        m_InputCapacity = SimdUtil::RoundUp(m_TapCount + InputBlockFrameCount, SimdUtil::MaxLaneCount);
+        m_pInput = new float*[channelCount];
+        for (int ch = 0; ch < channelCount; ++ch)
+        {
+            m_pInput[ch] = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * m_InputCapacity));
+        }
+        m_pInterleaved = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * InputBlockFrameCount * channelCount));
+        Reset();
+    }
+
+    Resampler::~Resampler()
+    {
+        if (m_pInput != nullptr)
+        {
+            for (int ch = 0; ch < m_ChannelCount; ++ch)
+            {
+                SimdUtil::AlignedFree(m_pInput[ch]);
+            }
+            delete[] m_pInput;
+        }
+        SimdUtil::AlignedFree(m_pInterleaved);
+        SimdUtil::AlignedFree(m_pFilter);
+    }
+
+    void Resampler::BuildFilter(float cutoff, float beta)
+    {
+        // Row p is the filter for an output p / m_PhaseCount of a frame past the middle tap.
+        // Blending needs the row for a whole frame past it too.
+        const int rowCount = m_IsExact ? m_PhaseCount : m_PhaseCount + 1;
+        m_pFilter = static_cast<float*>(SimdUtil::AlignedAllocate(sizeof(float) * m_TapCount * rowCount));
+
+        const double pi = 3.14159265358979323846;
+        const double halfLength = m_TapCount / 2;
+        const double windowScale = 1.0 / BesselI0(beta);
+        for (int phase = 0; phase < rowCount; ++phase)
+        {
+            float* pRow = m_pFilter + phase * m_TapCount;
+            const double offset = static_cast<double>(phase) / m_PhaseCount;
+            double sum = 0.0;
+            for (int tap = 0; tap < m_TapCount; ++tap)
+            {
+                const double distance = tap - (halfLength - 1.0) - offset;
+                const double x = distance / halfLength;
+                const double window = x * x < 1.0 ? BesselI0(beta * std::sqrt(1.0 - x * x)) * windowScale : windowScale;
+                const double argument = 2.0 * pi * cutoff * distance;
+                const double sinc = distance == 0.0 ? 1.0 : std::sin(argument) / argument;
+                const double value = 2.0 * cutoff * sinc * window;
+                pRow[tap] = static_cast<float>(value);
+                sum += value;
+            }
+            // Unity gain at DC on every phase, or the phases would ripple a constant signal.
+            for (int tap = 0; tap < m_TapCount; ++tap)
+            {
+                pRow[tap] = static_cast<float>(pRow[tap] / sum);
+            }
+        }
+    }
+
+    void Resampler::Reset()
+    {
+        if (m_TapCount == 0)
+        {
+            return;
+        }
+        // Silence before the first input frame, so the first output frame lines up with it.
+        m_InputFrameCount = m_TapCount / 2 - 1;
+        for (int ch = 0; ch < m_ChannelCount; ++ch)
+        {
+            std::memset(m_pInput[ch], 0, sizeof(float) * m_InputFrameCount);
+        }
+        m_Base = 0;
+        m_Fraction = 0;
+    }
+
+    void Resampler::Refill()
+    {
+        // Drop the frames behind the taps. A large downsampling step can skip past the buffer.
+        const int keepCount = m_InputFrameCount - m_Base;
+        if (keepCount > 0)
+        {
+            for (int ch = 0; ch < m_ChannelCount; ++ch)
+            {
+                std::memmove(m_pInput[ch], m_pInput[ch] + m_Base, sizeof(float) * keepCount);
+            }
+            m_InputFrameCount = keepCount;
+            m_Base = 0;
+        }
+        else
+        {
+            m_InputFrameCount = 0;
+            m_Base = -keepCount;
+        }
+
+        m_SourceFunction(m_pInterleaved, InputBlockFrameCount, m_pUserArg);
+        for (int ch = 0; ch < m_ChannelCount; ++ch)
+        {
+            float* pOut = m_pInput[ch] + m_InputFrameCount;
+            const float* pIn = m_pInterleaved + ch;
+            for (int i = 0; i < InputBlockFrameCount; ++i)
+            {
+                pOut[i] = pIn[i * m_ChannelCount];
+            }
+        }
+        m_InputFrameCount += InputBlockFrameCount;
+    }
+
+    void Resampler::Render(float* pOut, int frameCount)
+    {
+        assert(pOut != nullptr || frameCount == 0);
+        if (m_TapCount == 0)
+        {
+            m_SourceFunction(pOut, frameCount, m_pUserArg);
+            return;
+        }
+
+        const int step = m_Down / m_Up;
+        const int fractionStep = m_Down % m_Up;
+        for (int i = 0; i < frameCount; ++i)
+        {
+            while (m_Base + m_TapCount > m_InputFrameCount)
+            {
+                Refill();
+            }
+
+            float* pFrame = pOut + i * m_ChannelCount;
+            if (m_IsExact)
+            {
+                const float* pRow = m_pFilter + m_Fraction * m_TapCount;
+                for (int ch = 0; ch < m_ChannelCount; ++ch)
+                {
+                    pFrame[ch] = Dot(pRow, m_pInput[ch] + m_Base, m_TapCount);
+                }
+            }
+            else
+            {
+                // Blend the two stored phases around the exact position.
+                const int64_t position = static_cast<int64_t>(m_Fraction) * m_PhaseCount;
+                const int phase = static_cast<int>(position / m_Up);
+                const float weight = static_cast<float>(position % m_Up) / m_Up;
+                const float* pRow = m_pFilter + phase * m_TapCount;
+                for (int ch = 0; ch < m_ChannelCount; ++ch)
+                {
+                    const float a = Dot(pRow, m_pInput[ch] + m_Base, m_TapCount);
+                    const float b = Dot(pRow + m_TapCount, m_pInput[ch] + m_Base, m_TapCount);
+                    pFrame[ch] = a + (b - a) * weight;
+                }
+            }
+
+            m_Base += step;
+            m_Fraction += fractionStep;
+            if (m_Fraction >= m_Up)
+            {
+                m_Fraction -= m_Up;
+                ++m_Base;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace AUS {
+
+    // How hard the resampler filters. Each step doubles the taps and the cost per output frame.
+    enum ResamplerQuality
+    {
+        ResamplerQuality_Low,    // 8 taps, error about -55 dB at 1 kHz, dull above half the lower Nyquist.
+        ResamplerQuality_Medium, // 16 taps, about -75 dB, dull above two thirds of it.
+        ResamplerQuality_High    // 32 taps, under -90 dB and flat to 70% of it, the default for music.
+    };
+
+    // Converts an interleaved float stream from one sample rate to another.
+    //
+    // A polyphase filter: the output rate over the input rate reduces to L / M, and every output
+    // frame falls on one of L fractional positions between two input frames. The Kaiser windowed
+    // sinc for each position is computed once at construction, so an output frame costs one
+    // SIMD dot product per channel. The common ratios, 32000 or 44100 to 48000 and back, have at
+    // most MaxPhaseCount positions and play exactly; any other ratio blends the two nearest of
+    // MaxPhaseCount positions.
+    //
+    // The resampler pulls its input from a source function in blocks of InputBlockFrameCount
+    // frames, so it sits between a mixer running at the content rate and a device that asks for
+    // any number of frames at its own rate. Equal rates pass the source straight through.
+    class Resampler
+    {
+    public:
+        // Writes frameCount interleaved frames of the resampler's channel count to pOut.
+        typedef void (*SourceFunction)(float* pOut, int frameCount, void* pUserArg);
+
+        static const int MaxPhaseCount = 256;
+        static const int InputBlockFrameCount = 256;
+
+        Resampler(int inputRate, int outputRate, int channelCount, ResamplerQuality quality,
+            SourceFunction sourceFunction, void* pUserArg);
+        ~Resampler();
+
+        // Overwrites frameCount interleaved frames of pOut.
+        void Render(float* pOut, int frameCount);
+        // Forgets the input history, as if the stream started again.
+        void Reset();
+
+        int GetInputRate() const { return m_InputRate; }
+        int GetOutputRate() const { return m_OutputRate; }
+        int GetChannelCount() const { return m_ChannelCount; }
+        int GetTapCount() const { return m_TapCount; }
+        int GetPhaseCount() const { return m_PhaseCount; }
+        // True when every output frame has a filter of its own, false when phases are blended.
+        bool IsExact() const { return m_IsExact; }
+        // How far the output lags the input, in input frames.
+        int GetLatency() const { return m_TapCount / 2; }
+
+    private:
+        Resampler(const Resampler&);
+        Resampler& operator=(const Resampler&);
+
+        void BuildFilter(float cutoff, float beta);
+        // Pulls input until the taps of the next output frame are buffered.
+        void Refill();
+
+        int m_InputRate;
+        int m_OutputRate;
+        int m_ChannelCount;
+        SourceFunction m_SourceFunction;
+        void* m_pUserArg;
+
+        // The ratio is m_Down input frames per m_Up output frames.
+        int m_Up;
+        int m_Down;
+        int m_TapCount;
+        int m_PhaseCount;
+        bool m_IsExact;
+        float* m_pFilter; // Rows of m_TapCount coefficients, one per phase, one more when blending.
+
+        // Planar history per channel. The taps of the next output frame start at m_Base and
+        // the output sits m_Fraction / m_Up of a frame past the middle tap.
+        float** m_pInput;
+        float* m_pInterleaved; // One block from the source before it is split per channel.
+        int m_InputCapacity;
+        int m_InputFrameCount;
+        int m_Base;
+        int m_Fraction;
+    };
+
+}
@@ -0,0 +1,259 @@
+#include "SeBank.h"
+
+#include <cstring>
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Assert.h>
+#include <nn/fs/fs_Result.h>
+#include <nn/util/util_BitUtil.h>
+
+#if defined(NN_BUILD_CONFIG_OS_WIN)
+#include <algorithm>
+#include <vector>
+
+#include <nn/result/result_HandlingUtility.h>
+#endif
+
+namespace AUS {
+
+    namespace {
+
+        const char Signature[4] = { 'S', 'E', 'B', 'K' };
+
+        // Checks everything Load trusts later: the header, that the index fits in the file,
+        // and that every blob fits and is aligned.
+        bool IsValidBank(const void* pMemory, int64_t size)
+        {
+            const SeBankHeader* pHeader = static_cast<const SeBankHeader*>(pMemory);
+            if (std::memcmp(pHeader->signature, Signature, sizeof(Signature)) != 0
+                || pHeader->version != SeBank::Version
+                || pHeader->entrySize != sizeof(SeBankEntry))
+            {
+                return false;
+            }
+            if (static_cast<int64_t>(sizeof(SeBankHeader) + static_cast<uint64_t>(pHeader->entryCount) * sizeof(SeBankEntry)) > size)
+            {
+                return false;
+            }
+            const SeBankEntry* pEntries = reinterpret_cast<const SeBankEntry*>(static_cast<const char*>(pMemory) + sizeof(SeBankHeader));
+            for (uint32_t i = 0; i < pHeader->entryCount; ++i)
+            {
+                if (static_cast<int64_t>(pEntries[i].dataOffset) + pEntries[i].dataSize > size
+                    || pEntries[i].dataOffset % SeBank::BlobAlignment != 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    }
+
+    SeBank::SeBank()
+        : m_pAllocator(nullptr)
+        , m_pMemory(nullptr)
+        , m_pHeader(nullptr)
+        , m_pEntries(nullptr)
+    {
+    }
+
+    SeBank::~SeBank()
+    {
+        NN_ASSERT(!IsLoaded());
+    }
+
+    nn::Result SeBank::Load(const char* filename, nn::mem::StandardAllocator* pAllocator)
+    {
+        NN_ASSERT(!IsLoaded());
+        NN_ASSERT_NOT_NULL(filename);
+        NN_ASSERT_NOT_NULL(pAllocator);
+
+        nn::fs::FileHandle handle;
+        nn::Result result = nn::fs::OpenFile(&handle, filename, nn::fs::OpenMode_Read);
+        if (result.IsFailure())
+        {
+            return result;
+        }
+
+        int64_t size;
+        result = nn::fs::GetFileSize(&size, handle);
+        if (result.IsSuccess() && size < static_cast<int64_t>(sizeof(SeBankHeader)))
+        {
+            result = nn::fs::ResultDataCorrupted();
+        }
+        if (result.IsSuccess())
+        {
+            m_pMemory = pAllocator->Allocate(static_cast<size_t>(size), BlobAlignment);
+            NN_ABORT_UNLESS_NOT_NULL(m_pMemory);
+            result = nn::fs::ReadFile(handle, 0, m_pMemory, static_cast<size_t>(size));
+        }
+        nn::fs::CloseFile(handle);
+        if (result.IsSuccess() && !IsValidBank(m_pMemory, size))
+        {
+            result = nn::fs::ResultDataCorrupted();
+        }
+        if (result.IsFailure())
+        {
+            if (m_pMemory != nullptr)
+            {
+                pAllocator->Free(m_pMemory);
+                m_pMemory = nullptr;
+            }
+            return result;
+        }
+        m_pAllocator = pAllocator;
+
+        m_pHeader = static_cast<const SeBankHeader*>(m_pMemory);
+        m_pEntries = reinterpret_cast<SeBankEntry*>(static_cast<char*>(m_pMemory) + sizeof(SeBankHeader));
+        return nn::ResultSuccess();
+    }
+
+    void SeBank::Unload()
+    {
+        if (m_pMemory == nullptr)
+        {
+            return;
+        }
+        m_pAllocator->Free(m_pMemory);
+        m_pAllocator = nullptr;
+        m_pMemory = nullptr;
+        m_pHeader = nullptr;
+        m_pEntries = nullptr;
+    }
+
+    int SeBank::Find(uint32_t nameHash) const
+    {
+        NN_ASSERT(IsLoaded());
+        int low = 0;
+        int high = GetCount();
+        while (low < high)
+        {
+            const int middle = low + (high - low) / 2;
+            if (m_pEntries[middle].nameHash < nameHash)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return low < GetCount() && m_pEntries[low].nameHash == nameHash ? low : InvalidIndex;
+    }
+
+    nn::audio::AdpcmHeaderInfo* SeBank::GetHeader(int index)
+    {
+        NN_ASSERT(IsLoaded() && 0 <= index && index < GetCount());
+        return &m_pEntries[index].header;
+    }
+
+    const void* SeBank::GetData(int index) const
+    {
+        NN_ASSERT(IsLoaded() && 0 <= index && index < GetCount());
+        return static_cast<const char*>(m_pMemory) + m_pEntries[index].dataOffset;
+    }
+
+    size_t SeBank::GetDataSize(int index) const
+    {
+        NN_ASSERT(IsLoaded() && 0 <= index && index < GetCount());
+        return m_pEntries[index].dataSize;
+    }
+
+    void SeBank::SetupWaveBuffer(nn::audio::WaveBuffer* pOutWaveBuffer, int index)
+    {
+        NN_ASSERT_NOT_NULL(pOutWaveBuffer);
+        nn::audio::AdpcmHeaderInfo* pHeader = GetHeader(index);
+        pOutWaveBuffer->buffer = GetData(index);
+        pOutWaveBuffer->size = GetDataSize(index);
+        pOutWaveBuffer->startSampleOffset = 0;
+        pOutWaveBuffer->endSampleOffset = pHeader->sampleCount;
+        pOutWaveBuffer->loop = false;
+        pOutWaveBuffer->isEndOfStream = false;
+        pOutWaveBuffer->pContext = &pHeader->loopContext;
+        pOutWaveBuffer->contextSize = sizeof(nn::audio::AdpcmContext);
+    }
+
+#if defined(NN_BUILD_CONFIG_OS_WIN)
+    nn::Result WriteSeBank(const char* filename, const SeBankSource* pSources, int sourceCount)
+    {
+        NN_ASSERT_NOT_NULL(filename);
+        NN_ASSERT(pSources != nullptr || sourceCount == 0);
+
+        struct Source
+        {
+            SeBankEntry entry;
+            std::vector<char> data;
+        };
+        std::vector<Source> sources(sourceCount);
+
+        // Parse every source up front, the device never sees an ADPCM file header.
+        for (int i = 0; i < sourceCount; ++i)
+        {
+            nn::fs::FileHandle handle;
+            NN_RESULT_DO(nn::fs::OpenFile(&handle, pSources[i].filename, nn::fs::OpenMode_Read));
+            int64_t size;
+            uint8_t adpcmHeader[nn::audio::AdpcmHeaderSize];
+            nn::Result result = nn::fs::GetFileSize(&size, handle);
+            if (result.IsSuccess())
+            {
+                NN_ABORT_UNLESS(size >= static_cast<int64_t>(sizeof(adpcmHeader)), "%s is not an ADPCM file.", pSources[i].filename);
+                sources[i].data.resize(static_cast<size_t>(size) - sizeof(adpcmHeader));
+                result = nn::fs::ReadFile(handle, 0, adpcmHeader, sizeof(adpcmHeader));
+            }
+            if (result.IsSuccess() && !sources[i].data.empty())
+            {
+                result = nn::fs::ReadFile(handle, sizeof(adpcmHeader), sources[i].data.data(), sources[i].data.size());
+            }
+            nn::fs::CloseFile(handle);
+            NN_RESULT_DO(result);
+
+            SeBankEntry& entry = sources[i].entry;
+            std::memset(&entry, 0, sizeof(entry));
+            entry.nameHash = GetSeNameHash(pSources[i].name);
+            entry.dataSize = static_cast<uint32_t>(sources[i].data.size());
+            nn::audio::ParseAdpcmHeader(&entry.header, adpcmHeader, sizeof(adpcmHeader));
+        }
+
+        std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b)
+        {
+            return a.entry.nameHash < b.entry.nameHash;
+        });
+        for (int i = 1; i < sourceCount; ++i)
+        {
+            NN_ABORT_UNLESS(sources[i - 1].entry.nameHash != sources[i].entry.nameHash, "Two sound names share a hash, rename one.");
+        }
+
+        // Lay the blobs out after the index.
+        size_t offset = nn::util::align_up(sizeof(SeBankHeader) + sizeof(SeBankEntry) * sourceCount, SeBank::BlobAlignment);
+        for (int i = 0; i < sourceCount; ++i)
+        {
+            sources[i].entry.dataOffset = static_cast<uint32_t>(offset);
+            offset = nn::util::align_up(offset + sources[i].data.size(), SeBank::BlobAlignment);
+        }
+        std::vector<char> file(offset, 0);
+        SeBankHeader header;
+        std::memcpy(header.signature, Signature, sizeof(Signature));
+        header.version = SeBank::Version;
+        header.entryCount = static_cast<uint32_t>(sourceCount);
+        header.entrySize = sizeof(SeBankEntry);
+        std::memcpy(file.data(), &header, sizeof(header));
+        for (int i = 0; i < sourceCount; ++i)
+        {
+            std::memcpy(file.data() + sizeof(header) + sizeof(SeBankEntry) * i, &sources[i].entry, sizeof(SeBankEntry));
+            if (!sources[i].data.empty())
+            {
+                std::memcpy(file.data() + sources[i].entry.dataOffset, sources[i].data.data(), sources[i].data.size());
+            }
+        }
+
+        nn::fs::DeleteFile(filename);
+        NN_RESULT_DO(nn::fs::CreateFile(filename, static_cast<int64_t>(file.size())));
+        nn::fs::FileHandle handle;
+        NN_RESULT_DO(nn::fs::OpenFile(&handle, filename, nn::fs::OpenMode_Write));
+        nn::Result result = nn::fs::WriteFile(handle, 0, file.data(), file.size(), nn::fs::WriteOption::MakeValue(nn::fs::WriteOptionFlag_Flush));
+        nn::fs::CloseFile(handle);
+        return result;
+    }
+#endif
+
+}
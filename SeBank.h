@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <nn/fs.h>
+#include <nn/mem.h>
+#include <nn/audio.h>
+
+namespace AUS {
+
+    // 32-bit FNV-1a of a sound name, the key of the bank index.
+    inline uint32_t GetSeNameHash(const char* name)
+    {
+        uint32_t hash = 2166136261u;
+        for (const char* p = name; *p != '\0'; ++p)
+        {
+            hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619u;
+        }
+        return hash;
+    }
+
+    // The file layout of a bank. Every field is little endian, like the devices that read it.
+    //
+    //   SeBankHeader
+    //   SeBankEntry[entryCount], sorted by nameHash
+    //   the ADPCM data of every entry, each starting on a BlobAlignment boundary
+    struct SeBankHeader
+    {
+        char signature[4];   // "SEBK"
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t entrySize;  // sizeof(SeBankEntry), so a bank built against another SDK is refused.
+    };
+
+    struct SeBankEntry
+    {
+        uint32_t nameHash;
+        uint32_t dataOffset; // From the start of the file.
+        uint32_t dataSize;
+        uint32_t reserved;
+        nn::audio::AdpcmHeaderInfo header; // Parsed when the bank was built.
+    };
+
+    // A bank of ADPCM sound effects built offline into one file.
+    //
+    // Load reads the whole file with a single read into one allocation in the wave buffer
+    // memory pool, and the voices play straight out of it: the index and the parsed headers
+    // are already there, so nothing is parsed or allocated per sound.
+    class SeBank
+    {
+    public:
+        static const uint32_t Version = 1;
+        static const size_t BlobAlignment = 4096;
+        static const int InvalidIndex = -1;
+
+        SeBank();
+        ~SeBank();
+
+        // pAllocator must manage memory inside a memory pool. Returns the result of the file
+        // system, or nn::fs::ResultDataCorrupted for a file that is not a bank of this
+        // version. Nothing stays allocated on failure.
+        nn::Result Load(const char* filename, nn::mem::StandardAllocator* pAllocator);
+        void Unload();
+        bool IsLoaded() const { return m_pMemory != nullptr; }
+
+        int GetCount() const { return m_pHeader->entryCount; }
+        // Binary search of the sorted index. Returns InvalidIndex for a name not in the bank.
+        int Find(uint32_t nameHash) const;
+        int Find(const char* name) const { return Find(GetSeNameHash(name)); }
+
+        nn::audio::AdpcmHeaderInfo* GetHeader(int index);
+        const void* GetData(int index) const;
+        size_t GetDataSize(int index) const;
+
+        // Fills a wave buffer that plays the whole sound once.
+        void SetupWaveBuffer(nn::audio::WaveBuffer* pOutWaveBuffer, int index);
+
+    private:
+        SeBank(const SeBank&);
+        SeBank& operator=(const SeBank&);
+
+        nn::mem::StandardAllocator* m_pAllocator;
+        void* m_pMemory;
+        const SeBankHeader* m_pHeader;
+        SeBankEntry* m_pEntries;
+    };
+
+#if defined(NN_BUILD_CONFIG_OS_WIN)
+    struct SeBankSource
+    {
+        const char* name;     // Looked up through GetSeNameHash.
+        const char* filename; // An .adpcm file.
+    };
+
+    // Host tool: builds a bank from .adpcm files. Aborts when two names share a hash.
+    // SeBankTool.cpp wraps it in a command line.
+    nn::Result WriteSeBank(const char* filename, const SeBankSource* pSources, int sourceCount);
+#endif
+
+}
@@ -0,0 +1,60 @@
+// Host tool that builds the sound effect bank Audio.cpp loads.
+//
+//   SeBankTool <output.sebank> <name>=<file.adpcm> [<name>=<file.adpcm> ...]
+//
+// Build it for the Generic (Windows) spec together with SeBank.cpp. Paths are host paths.
+// The sample expects the bank at AudioCommon/SampleSe.sebank in its content directory, so
+// run it after the .adpcm files are in place, for example from the pre-build event:
+//
+//   SeBankTool.exe $(NintendoSdkContentDirectory)\AudioCommon\SampleSe.sebank
+//       SampleSe0=$(NintendoSdkContentDirectory)\AudioCommon\SampleSe0.adpcm
+//       SampleSe1=$(NintendoSdkContentDirectory)\AudioCommon\SampleSe1.adpcm
+//       SampleSe2=$(NintendoSdkContentDirectory)\AudioCommon\SampleSe2.adpcm
+//       SampleSe3=$(NintendoSdkContentDirectory)\AudioCommon\SampleSe3.adpcm
+
+#if defined(NN_BUILD_CONFIG_OS_WIN)
+
+#include <cstring>
+#include <vector>
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Log.h>
+#include <nn/fs.h>
+#include <nn/os.h>
+
+#include "SeBank.h"
+
+extern "C" void nnMain()
+{
+    const int argc = nn::os::GetHostArgc();
+    char** argv = nn::os::GetHostArgv();
+    if (argc < 3)
+    {
+        NN_LOG("Usage: SeBankTool <output.sebank> <name>=<file.adpcm> [<name>=<file.adpcm> ...]\n");
+        return;
+    }
+
+    // Split every argument in place at its '='.
+    std::vector<AUS::SeBankSource> sources(argc - 2);
+    for (int i = 2; i < argc; ++i)
+    {
+        char* pSeparator = std::strchr(argv[i], '=');
+        NN_ABORT_UNLESS_NOT_NULL(pSeparator);
+        *pSeparator = '\0';
+        sources[i - 2].name = argv[i];
+        sources[i - 2].filename = pSeparator + 1;
+    }
+
+    NN_ABORT_UNLESS_RESULT_SUCCESS(nn::fs::MountHostRoot());
+    const nn::Result result = AUS::WriteSeBank(argv[1], sources.data(), static_cast<int>(sources.size()));
+    nn::fs::UnmountHostRoot();
+
+    if (result.IsFailure())
+    {
+        NN_LOG("Could not write %s (module %d, description %d).\n", argv[1], result.GetModule(), result.GetDescription());
+        return;
+    }
+    NN_LOG("Wrote %d sound effects to %s.\n", static_cast<int>(sources.size()), argv[1]);
+}
+
+#endif
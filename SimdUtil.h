@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Pick the widest instruction set the compiler was told to target.
+// AVX2 needs -mavx2 (/arch:AVX2), SSE2 is always there on x64 and NEON on the device.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+namespace SimdUtil
+{
+	//! Alignment of every SoA array, enough for one AVX register.
+	const int Alignment = 32;
+
+	//! Widest lane count any kernel uses. Array sizes are padded to a multiple of it.
+	const int MaxLaneCount = 8;
+
+	inline int RoundUp(int count_, int multiple_)
+	{
+		return (count_ + multiple_ - 1) / multiple_ * multiple_;
+	}
+
+	//! Allocates size_ bytes aligned to Alignment. Release with AlignedFree.
+	inline void* AlignedAllocate(size_t size_)
+	{
+		void* raw = std::malloc(size_ + Alignment + sizeof(void*));
+		if (raw == nullptr)
+		{
+			return nullptr;
+		}
+		uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + Alignment - 1) & ~static_cast<uintptr_t>(Alignment - 1);
+		reinterpret_cast<void**>(aligned)[-1] = raw;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	inline void AlignedFree(void* p_)
+	{
+		if (p_ != nullptr)
+		{
+			std::free(reinterpret_cast<void**>(p_)[-1]);
+		}
+	}
+
+#if defined(SIMD_NEON)
+	//! NEON has no movemask, gather the sign bit of each lane into bits 0-3.
+	inline uint32_t MoveMask(uint32x4_t v_)
+	{
+		static const uint32_t BitsData[4] = { 1, 2, 4, 8 };
+		uint32x4_t bits = vandq_u32(v_, vld1q_u32(BitsData));
+#if defined(__aarch64__)
+		return vaddvq_u32(bits);
+#else
+		uint32x2_t sum = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		sum = vpadd_u32(sum, sum);
+		return vget_lane_u32(sum, 0);
+#endif
+	}
+#endif
+
+	// Lane-generic wrappers so a kernel can be written once for every target.
+	// Vec holds LaneCount floats, Mask holds the matching comparison result.
+#if defined(SIMD_AVX2)
+	typedef __m256 Vec;
+	typedef __m256 Mask;
+	const int LaneCount = 8;
+	inline Vec Load(const float* p_) { return _mm256_load_ps(p_); }
+	inline Vec LoadUnaligned(const float* p_) { return _mm256_loadu_ps(p_); }
+	inline void Store(float* p_, Vec v_) { _mm256_store_ps(p_, v_); }
+	inline void StoreUnaligned(float* p_, Vec v_) { _mm256_storeu_ps(p_, v_); }
+	inline Vec Set(float v_) { return _mm256_set1_ps(v_); }
+	inline Vec Add(Vec a_, Vec b_) { return _mm256_add_ps(a_, b_); }
+	inline Vec Sub(Vec a_, Vec b_) { return _mm256_sub_ps(a_, b_); }
+	inline Vec Mul(Vec a_, Vec b_) { return _mm256_mul_ps(a_, b_); }
+	inline Vec Min(Vec a_, Vec b_) { return _mm256_min_ps(a_, b_); }
+	inline Vec Max(Vec a_, Vec b_) { return _mm256_max_ps(a_, b_); }
+	inline Mask Less(Vec a_, Vec b_) { return _mm256_cmp_ps(a_, b_, _CMP_LT_OQ); }
+	inline Mask LessEqual(Vec a_, Vec b_) { return _mm256_cmp_ps(a_, b_, _CMP_LE_OQ); }
+	inline Mask And(Mask a_, Mask b_) { return _mm256_and_ps(a_, b_); }
+	inline Vec Select(Mask m_, Vec a_, Vec b_) { return _mm256_blendv_ps(b_, a_, m_); }
+	inline uint32_t MoveMask(Mask m_) { return static_cast<uint32_t>(_mm256_movemask_ps(m_)); }
+	//! Sum of the lanes, for the end of a dot product.
+	inline float Sum(Vec v_)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v_), _mm256_extractf128_ps(v_, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+	}
+#elif defined(SIMD_SSE2)
+	typedef __m128 Vec;
+	typedef __m128 Mask;
+	const int LaneCount = 4;
+	inline Vec Load(const float* p_) { return _mm_load_ps(p_); }
+	inline Vec LoadUnaligned(const float* p_) { return _mm_loadu_ps(p_); }
+	inline void Store(float* p_, Vec v_) { _mm_store_ps(p_, v_); }
+	inline void StoreUnaligned(float* p_, Vec v_) { _mm_storeu_ps(p_, v_); }
+	inline Vec Set(float v_) { return _mm_set1_ps(v_); }
+	inline Vec Add(Vec a_, Vec b_) { return _mm_add_ps(a_, b_); }
+	inline Vec Sub(Vec a_, Vec b_) { return _mm_sub_ps(a_, b_); }
+	inline Vec Mul(Vec a_, Vec b_) { return _mm_mul_ps(a_, b_); }
+	inline Vec Min(Vec a_, Vec b_) { return _mm_min_ps(a_, b_); }
+	inline Vec Max(Vec a_, Vec b_) { return _mm_max_ps(a_, b_); }
+	inline Mask Less(Vec a_, Vec b_) { return _mm_cmplt_ps(a_, b_); }
+	inline Mask LessEqual(Vec a_, Vec b_) { return _mm_cmple_ps(a_, b_); }
+	inline Mask And(Mask a_, Mask b_) { return _mm_and_ps(a_, b_); }
+	inline Vec Select(Mask m_, Vec a_, Vec b_) { return _mm_or_ps(_mm_and_ps(m_, a_), _mm_andnot_ps(m_, b_)); }
+	inline uint32_t MoveMask(Mask m_) { return static_cast<uint32_t>(_mm_movemask_ps(m_)); }
+	inline float Sum(Vec v_)
+	{
+		const __m128 sum = _mm_add_ps(v_, _mm_movehl_ps(v_, v_));
+		return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+	}
+#elif defined(SIMD_NEON)
+	typedef float32x4_t Vec;
+	typedef uint32x4_t Mask;
+	const int LaneCount = 4;
+	inline Vec Load(const float* p_) { return vld1q_f32(p_); }
+	inline Vec LoadUnaligned(const float* p_) { return vld1q_f32(p_); }
+	inline void Store(float* p_, Vec v_) { vst1q_f32(p_, v_); }
+	inline void StoreUnaligned(float* p_, Vec v_) { vst1q_f32(p_, v_); }
+	inline Vec Set(float v_) { return vdupq_n_f32(v_); }
+	inline Vec Add(Vec a_, Vec b_) { return vaddq_f32(a_, b_); }
+	inline Vec Sub(Vec a_, Vec b_) { return vsubq_f32(a_, b_); }
+	inline Vec Mul(Vec a_, Vec b_) { return vmulq_f32(a_, b_); }
+	inline Vec Min(Vec a_, Vec b_) { return vminq_f32(a_, b_); }
+	inline Vec Max(Vec a_, Vec b_) { return vmaxq_f32(a_, b_); }
+	inline Mask Less(Vec a_, Vec b_) { return vcltq_f32(a_, b_); }
+	inline Mask LessEqual(Vec a_, Vec b_) { return vcleq_f32(a_, b_); }
+	inline Mask And(Mask a_, Mask b_) { return vandq_u32(a_, b_); }
+	inline Vec Select(Mask m_, Vec a_, Vec b_) { return vbslq_f32(m_, a_, b_); }
+	inline float Sum(Vec v_)
+	{
+#if defined(__aarch64__)
+		return vaddvq_f32(v_);
+#else
+		const float32x2_t sum = vadd_f32(vget_low_f32(v_), vget_high_f32(v_));
+		return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#endif
+	}
+#else
+	typedef float Vec;
+	typedef bool Mask;
+	const int LaneCount = 1;
+	inline Vec Load(const float* p_) { return *p_; }
+	inline Vec LoadUnaligned(const float* p_) { return *p_; }
+	inline void Store(float* p_, Vec v_) { *p_ = v_; }
+	inline void StoreUnaligned(float* p_, Vec v_) { *p_ = v_; }
+	inline Vec Set(float v_) { return v_; }
+	inline Vec Add(Vec a_, Vec b_) { return a_ + b_; }
+	inline Vec Sub(Vec a_, Vec b_) { return a_ - b_; }
+	inline Vec Mul(Vec a_, Vec b_) { return a_ * b_; }
+	inline Vec Min(Vec a_, Vec b_) { return b_ < a_ ? b_ : a_; }
+	inline Vec Max(Vec a_, Vec b_) { return a_ < b_ ? b_ : a_; }
+	inline Mask Less(Vec a_, Vec b_) { return a_ < b_; }
+	inline Mask LessEqual(Vec a_, Vec b_) { return a_ <= b_; }
+	inline Mask And(Mask a_, Mask b_) { return a_ && b_; }
+	inline Vec Select(Mask m_, Vec a_, Vec b_) { return m_ ? a_ : b_; }
+	inline uint32_t MoveMask(Mask m_) { return m_ ? 1u : 0u; }
+	inline float Sum(Vec v_) { return v_; }
+#endif
+}
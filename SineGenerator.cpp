@@ -0,0 +1,141 @@
+#include "SineGenerator.h"
+
+#include <cassert>
+#include <cmath>
+
+#include "SimdUtil.h"
+
+namespace AUS {
+
+    float SineTable::Sin(uint32_t phase)
+    {
+        const float* pTable = GetData();
+        const uint32_t index = phase >> IndexShift;
+        const float fraction = static_cast<float>(phase & ((1u << IndexShift) - 1)) * (1.0f / (1u << IndexShift));
+        return pTable[index] + (pTable[index + 1] - pTable[index]) * fraction;
+    }
+
+    uint32_t SineTable::GetPhaseIncrement(float frequency, int sampleRate)
+    {
+        assert(sampleRate > 0);
+        assert(0.0f <= frequency && frequency < static_cast<float>(sampleRate));
+        return static_cast<uint32_t>(static_cast<double>(frequency) / sampleRate * 4294967296.0 + 0.5);
+    }
+
+    const float* SineTable::GetData()
+    {
+        // Built on first use, the initialization of a local static is thread safe.
+        struct Table
+        {
+            Table()
+            {
+                for (int i = 0; i < Size; ++i)
+                {
+                    data[i] = static_cast<float>(std::sin(6.283185307179586 * i / Size));
+                }
+                data[Size] = data[0];
+            }
+            float data[Size + 1];
+        };
+        static const Table s_Table;
+        return s_Table.data;
+    }
+
+    SineGenerator::SineGenerator()
+        : m_Phase(0)
+        , m_Increment(0)
+        , m_Amplitude(1.0f)
+        , m_StepCos(1.0f)
+        , m_StepSin(0.0f)
+    {
+    }
+
+    SineGenerator::SineGenerator(float frequency, int sampleRate, float amplitude)
+        : m_Phase(0)
+        , m_Increment(0)
+        , m_Amplitude(amplitude)
+        , m_StepCos(1.0f)
+        , m_StepSin(0.0f)
+    {
+        SetFrequency(frequency, sampleRate);
+    }
+
+    void SineGenerator::SetFrequency(float frequency, int sampleRate)
+    {
+        m_Increment = SineTable::GetPhaseIncrement(frequency, sampleRate);
+
+        // The rotation is computed once in double precision, from the same quantized step the
+        // phase advances by, so the seeded and the rotated samples agree.
+        const uint32_t step = m_Increment * static_cast<uint32_t>(SimdUtil::LaneCount);
+        const double angle = 6.283185307179586 * step / 4294967296.0;
+        m_StepCos = static_cast<float>(std::cos(angle));
+        m_StepSin = static_cast<float>(std::sin(angle));
+    }
+
+    void SineGenerator::Generate(float* pOut, int sampleCount)
+    {
+        Render<false>(pOut, sampleCount);
+    }
+
+    void SineGenerator::Mix(float* pOut, int sampleCount)
+    {
+        Render<true>(pOut, sampleCount);
+    }
+
+    template <bool IsMix>
+    void SineGenerator::Render(float* pOut, int sampleCount)
+    {
+        assert(pOut != nullptr || sampleCount == 0);
+
+        const int LaneCount = SimdUtil::LaneCount;
+        const SimdUtil::Vec stepCos = SimdUtil::Set(m_StepCos);
+        const SimdUtil::Vec stepSin = SimdUtil::Set(m_StepSin);
+        const SimdUtil::Vec amplitude = SimdUtil::Set(m_Amplitude);
+
+        for (int offset = 0; offset < sampleCount; offset += BlockSampleCount)
+        {
+            const int count = sampleCount - offset < BlockSampleCount ? sampleCount - offset : BlockSampleCount;
+            float* pBlock = pOut + offset;
+
+            // Seed one sample per lane from the table.
+            float seedSin[SimdUtil::MaxLaneCount];
+            float seedCos[SimdUtil::MaxLaneCount];
+            uint32_t phase = m_Phase;
+            for (int lane = 0; lane < LaneCount; ++lane)
+            {
+                seedSin[lane] = SineTable::Sin(phase);
+                seedCos[lane] = SineTable::Cos(phase);
+                phase += m_Increment;
+            }
+            SimdUtil::Vec s = SimdUtil::LoadUnaligned(seedSin);
+            SimdUtil::Vec c = SimdUtil::LoadUnaligned(seedCos);
+
+            int i = 0;
+            for (; i + LaneCount <= count; i += LaneCount)
+            {
+                SimdUtil::Vec value = SimdUtil::Mul(s, amplitude);
+                if (IsMix)
+                {
+                    value = SimdUtil::Add(value, SimdUtil::LoadUnaligned(pBlock + i));
+                }
+                SimdUtil::StoreUnaligned(pBlock + i, value);
+
+                const SimdUtil::Vec nextSin = SimdUtil::Add(SimdUtil::Mul(s, stepCos), SimdUtil::Mul(c, stepSin));
+                c = SimdUtil::Sub(SimdUtil::Mul(c, stepCos), SimdUtil::Mul(s, stepSin));
+                s = nextSin;
+            }
+            if (i < count)
+            {
+                float tail[SimdUtil::MaxLaneCount];
+                SimdUtil::StoreUnaligned(tail, SimdUtil::Mul(s, amplitude));
+                for (int lane = 0; i + lane < count; ++lane)
+                {
+                    pBlock[i + lane] = IsMix ? pBlock[i + lane] + tail[lane] : tail[lane];
+                }
+            }
+
+            m_Phase += m_Increment * static_cast<uint32_t>(count);
+        }
+    }
+
+}
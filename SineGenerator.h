@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "AudioSampleTraits.h"
+
+namespace AUS {
+
+    // A sine table shared by every generator, 1024 entries with linear interpolation.
+    // Phases are 32-bit fractions of a turn, so they wrap for free.
+    // The absolute error of Sin and Cos is below 5e-6, about a sixth of a 16-bit step.
+    class SineTable
+    {
+    public:
+        static const int Size = 1024;
+        static const int IndexShift = 22; // 32 - log2(Size)
+
+        static float Sin(uint32_t phase);
+        static float Cos(uint32_t phase)
+        {
+            return Sin(phase + 0x40000000u);
+        }
+
+        // Converts a frequency into the phase step of one sample.
+        static uint32_t GetPhaseIncrement(float frequency, int sampleRate);
+
+    private:
+        // Size + 1 entries, the last one repeats the first for the interpolation.
+        static const float* GetData();
+    };
+
+    // A sine oscillator that fills buffers a vector of samples at a time.
+    //
+    // Every lane of a SIMD vector holds a consecutive sample as a (sin, cos) pair, and the
+    // whole vector turns by LaneCount samples with one complex multiply. The pairs are seeded
+    // from SineTable every BlockSampleCount samples so the rounding of the rotation never builds up;
+    // the output stays within 1e-5 of sinf.
+    class SineGenerator
+    {
+    public:
+        static const int BlockSampleCount = 64;
+
+        SineGenerator();
+        SineGenerator(float frequency, int sampleRate, float amplitude);
+
+        void SetFrequency(float frequency, int sampleRate);
+        void SetAmplitude(float amplitude) { m_Amplitude = amplitude; }
+        // phase is a 32-bit fraction of a turn.
+        void SetPhase(uint32_t phase) { m_Phase = phase; }
+        uint32_t GetPhase() const { return m_Phase; }
+
+        // Overwrites sampleCount samples of pOut with the next samples of the sine.
+        void Generate(float* pOut, int sampleCount);
+        // Adds the next sampleCount samples to pOut.
+        void Mix(float* pOut, int sampleCount);
+
+        // Overwrites pOut, converting with SampleTraits.
+        template <typename SampleT>
+        void Generate(SampleT* pOut, int sampleCount)
+        {
+            float block[BlockSampleCount];
+            for (int offset = 0; offset < sampleCount; offset += BlockSampleCount)
+            {
+                const int count = sampleCount - offset < BlockSampleCount ? sampleCount - offset : BlockSampleCount;
+                Generate(block, count);
+                for (int i = 0; i < count; ++i)
+                {
+                    pOut[offset + i] = SampleTraits<SampleT>::FromFloat(block[i]);
+                }
+            }
+        }
+
+    private:
+        template <bool IsMix>
+        void Render(float* pOut, int sampleCount);
+
+        uint32_t m_Phase;
+        uint32_t m_Increment;
+        float m_Amplitude;
+        // Rotation of one vector of samples.
+        float m_StepCos;
+        float m_StepSin;
+    };
+
+}
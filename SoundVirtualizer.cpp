@@ -0,0 +1,225 @@
+#include "SoundVirtualizer.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace AUS {
+
+    const float SoundVirtualizer::MinAudibility = 1.0f / 1024.0f;
+    const float SoundVirtualizer::HysteresisRatio = 1.25f;
+
+    SoundVirtualizer::SoundVirtualizer(int soundCountMax, int slotCount)
+        : m_Sounds(soundCountMax)
+        , m_SlotToSound(slotCount, InvalidSound)
+        , m_SoundCount(0)
+        , m_MinDistance(1.0f)
+        , m_MaxDistance(100.0f)
+    {
+        assert(soundCountMax > 0);
+        assert(slotCount > 0);
+
+        m_FreeSounds.reserve(soundCountMax);
+        for (int sound = soundCountMax - 1; sound >= 0; --sound)
+        {
+            m_Sounds[sound].isActive = false;
+            m_FreeSounds.push_back(sound);
+        }
+        m_FreeSlots.reserve(slotCount);
+        for (int slot = slotCount - 1; slot >= 0; --slot)
+        {
+            m_FreeSlots.push_back(slot);
+        }
+        m_Candidates.reserve(soundCountMax);
+    }
+
+    int SoundVirtualizer::Play(int64_t now, int64_t frameCount, int sampleRate, bool isLooping, int priority, float volume)
+    {
+        assert(frameCount > 0);
+        assert(sampleRate > 0);
+        if (m_FreeSounds.empty())
+        {
+            return InvalidSound;
+        }
+        const int sound = m_FreeSounds.back();
+        m_FreeSounds.pop_back();
+        ++m_SoundCount;
+
+        Sound& s = m_Sounds[sound];
+        s.isActive = true;
+        s.isStopping = false;
+        s.isLooping = isLooping;
+        s.priority = priority;
+        s.sampleRate = sampleRate;
+        s.slot = InvalidSlot;
+        s.frameCount = frameCount;
+        s.startTime = now;
+        s.volume = volume;
+        s.distance = 0.0f;
+        return sound;
+    }
+
+    void SoundVirtualizer::Stop(int sound)
+    {
+        assert(IsPlaying(sound));
+        m_Sounds[sound].isStopping = true;
+    }
+
+    void SoundVirtualizer::SetVolume(int sound, float volume)
+    {
+        assert(IsPlaying(sound));
+        m_Sounds[sound].volume = volume;
+    }
+
+    void SoundVirtualizer::SetDistance(int sound, float distance)
+    {
+        assert(IsPlaying(sound));
+        m_Sounds[sound].distance = distance;
+    }
+
+    void SoundVirtualizer::SetAttenuationRange(float minDistance, float maxDistance)
+    {
+        assert(0.0f < minDistance && minDistance < maxDistance);
+        m_MinDistance = minDistance;
+        m_MaxDistance = maxDistance;
+    }
+
+    bool SoundVirtualizer::IsPlaying(int sound) const
+    {
+        assert(0 <= sound && sound < static_cast<int>(m_Sounds.size()));
+        return m_Sounds[sound].isActive && !m_Sounds[sound].isStopping;
+    }
+
+    int SoundVirtualizer::GetSlot(int sound) const
+    {
+        assert(0 <= sound && sound < static_cast<int>(m_Sounds.size()) && m_Sounds[sound].isActive);
+        return m_Sounds[sound].slot;
+    }
+
+    float SoundVirtualizer::GetAudibility(int sound) const
+    {
+        assert(0 <= sound && sound < static_cast<int>(m_Sounds.size()) && m_Sounds[sound].isActive);
+        const Sound& s = m_Sounds[sound];
+        return s.volume * GetAttenuation(s.distance);
+    }
+
+    int64_t SoundVirtualizer::GetPosition(int sound, int64_t now) const
+    {
+        assert(0 <= sound && sound < static_cast<int>(m_Sounds.size()) && m_Sounds[sound].isActive);
+        const Sound& s = m_Sounds[sound];
+        const int64_t frame = (now - s.startTime) * s.sampleRate / 1000000;
+        if (s.isLooping)
+        {
+            return frame % s.frameCount;
+        }
+        return frame < s.frameCount ? frame : s.frameCount;
+    }
+
+    float SoundVirtualizer::GetAttenuation(float distance) const
+    {
+        if (distance >= m_MaxDistance)
+        {
+            return 0.0f;
+        }
+        return distance <= m_MinDistance ? 1.0f : m_MinDistance / distance;
+    }
+
+    bool SoundVirtualizer::IsFinished(const Sound& sound, int64_t now) const
+    {
+        return !sound.isLooping && (now - sound.startTime) * sound.sampleRate / 1000000 >= sound.frameCount;
+    }
+
+    float SoundVirtualizer::GetScore(const Sound& sound) const
+    {
+        const float audibility = sound.volume * GetAttenuation(sound.distance);
+        return sound.slot != InvalidSlot ? audibility * HysteresisRatio : audibility;
+    }
+
+    void SoundVirtualizer::Free(int sound)
+    {
+        m_Sounds[sound].isActive = false;
+        m_FreeSounds.push_back(sound);
+        --m_SoundCount;
+    }
+
+    int SoundVirtualizer::Update(int64_t now, SoundSlotChange* pOutChanges, int changeCountMax)
+    {
+        assert(pOutChanges != nullptr);
+        assert(changeCountMax >= GetChangeCountMax());
+        (void)changeCountMax;
+
+        int changeCount = 0;
+        m_Candidates.clear();
+        for (int sound = 0; sound < static_cast<int>(m_Sounds.size()); ++sound)
+        {
+            Sound& s = m_Sounds[sound];
+            if (!s.isActive)
+            {
+                continue;
+            }
+            const bool isEnded = s.isStopping || IsFinished(s, now);
+            if (s.slot != InvalidSlot && (isEnded || GetAudibility(sound) < MinAudibility))
+            {
+                const SoundSlotChange change = { s.slot, sound, false };
+                pOutChanges[changeCount++] = change;
+                m_SlotToSound[s.slot] = InvalidSound;
+                m_FreeSlots.push_back(s.slot);
+                s.slot = InvalidSlot;
+            }
+            if (isEnded)
+            {
+                Free(sound);
+            }
+            else if (GetAudibility(sound) >= MinAudibility)
+            {
+                m_Candidates.push_back(sound);
+            }
+        }
+
+        // The first slotCount candidates in rank order get the slots.
+        const int slotCount = GetSlotCount();
+        const auto isBefore = [this](int a, int b)
+        {
+            const Sound& sa = m_Sounds[a];
+            const Sound& sb = m_Sounds[b];
+            if (sa.priority != sb.priority)
+            {
+                return sa.priority > sb.priority;
+            }
+            return GetScore(sa) > GetScore(sb);
+        };
+        if (static_cast<int>(m_Candidates.size()) > slotCount)
+        {
+            std::nth_element(m_Candidates.begin(), m_Candidates.begin() + slotCount, m_Candidates.end(), isBefore);
+            // Every sound past the cut loses its slot, before the winners claim theirs.
+            for (size_t i = slotCount; i < m_Candidates.size(); ++i)
+            {
+                Sound& s = m_Sounds[m_Candidates[i]];
+                if (s.slot != InvalidSlot)
+                {
+                    const SoundSlotChange change = { s.slot, m_Candidates[i], false };
+                    pOutChanges[changeCount++] = change;
+                    m_SlotToSound[s.slot] = InvalidSound;
+                    m_FreeSlots.push_back(s.slot);
+                    s.slot = InvalidSlot;
+                }
+            }
+            m_Candidates.resize(slotCount);
+        }
+
+        for (size_t i = 0; i < m_Candidates.size(); ++i)
+        {
+            Sound& s = m_Sounds[m_Candidates[i]];
+            if (s.slot == InvalidSlot)
+            {
+                assert(!m_FreeSlots.empty());
+                s.slot = m_FreeSlots.back();
+                m_FreeSlots.pop_back();
+                m_SlotToSound[s.slot] = m_Candidates[i];
+                const SoundSlotChange change = { s.slot, m_Candidates[i], true };
+                pOutChanges[changeCount++] = change;
+            }
+        }
+        return changeCount;
+    }
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace AUS {
+
+    // A slot changing hands, reported by SoundVirtualizer::Update.
+    struct SoundSlotChange
+    {
+        int slot;
+        int sound;
+        bool isStart; // The sound starts on the slot, otherwise it leaves it.
+    };
+
+    // Keeps many logical sounds and decides which of them get one of a few real voices.
+    //
+    // Every sound keeps playing in time whether it has a voice or not: its position is the time
+    // since Play, so a sound that gets a voice back resumes where it would have been.
+    // Update ranks the sounds by priority first and audibility, volume times distance
+    // attenuation, second, and gives the slots to the top ones. A sound that holds a slot keeps
+    // it until a rival is HysteresisRatio times more audible, so close sounds do not swap voices
+    // every frame. Sounds under MinAudibility never get a slot.
+    //
+    // Times are in microseconds on any clock that only moves forward.
+    class SoundVirtualizer
+    {
+    public:
+        static const int InvalidSound = -1;
+        static const int InvalidSlot = -1;
+        static const float MinAudibility;
+        static const float HysteresisRatio;
+
+        SoundVirtualizer(int soundCountMax, int slotCount);
+
+        // frameCount is the length of the sound at sampleRate. A sound with a higher priority
+        // always wins a slot over a lower one. Returns InvalidSound when every sound is in use.
+        int Play(int64_t now, int64_t frameCount, int sampleRate, bool isLooping, int priority, float volume);
+        // The sound leaves its slot on the next Update.
+        void Stop(int sound);
+
+        void SetVolume(int sound, float volume);
+        void SetDistance(int sound, float distance);
+        // Sounds are at full volume up to minDistance, fall off as minDistance / distance past it
+        // and are silent from maxDistance on.
+        void SetAttenuationRange(float minDistance, float maxDistance);
+
+        bool IsPlaying(int sound) const;
+        int GetSlot(int sound) const;
+        float GetAudibility(int sound) const;
+        // The frame the sound plays at now, wrapped for looping sounds.
+        int64_t GetPosition(int sound, int64_t now) const;
+
+        int GetSoundCount() const { return m_SoundCount; }
+        int GetSlotCount() const { return static_cast<int>(m_SlotToSound.size()); }
+        // The most changes one Update reports, every slot stopping and starting once.
+        int GetChangeCountMax() const { return 2 * GetSlotCount(); }
+
+        // Ends finished and stopped sounds and hands the slots to the most audible sounds.
+        // Writes the changes to pOutChanges, all the stops before the starts, and returns their count.
+        int Update(int64_t now, SoundSlotChange* pOutChanges, int changeCountMax);
+
+    private:
+        SoundVirtualizer(const SoundVirtualizer&);
+        SoundVirtualizer& operator=(const SoundVirtualizer&);
+
+        struct Sound
+        {
+            bool isActive;
+            bool isStopping;
+            bool isLooping;
+            int priority;
+            int sampleRate;
+            int slot;
+            int64_t frameCount;
+            int64_t startTime;
+            float volume;
+            float distance;
+        };
+
+        float GetAttenuation(float distance) const;
+        bool IsFinished(const Sound& sound, int64_t now) const;
+        // The ranking key, with the hysteresis bonus of a sound that holds a slot.
+        float GetScore(const Sound& sound) const;
+        void Free(int sound);
+
+        std::vector<Sound> m_Sounds;
+        std::vector<int> m_FreeSounds;
+        std::vector<int> m_SlotToSound;
+        std::vector<int> m_FreeSlots;
+        std::vector<int> m_Candidates; // Scratch for Update, reserved up front.
+        int m_SoundCount;
+        float m_MinDistance;
+        float m_MaxDistance;
+    };
+
+}
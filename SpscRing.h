@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+namespace AUS {
+
+    // A lock-free ring buffer for one producer thread and one consumer thread.
+    //
+    // Push is only called by the producer and Pop only by the consumer. The indices run freely
+    // and wrap through the mask, so Capacity must be a power of two. Neither side ever blocks or
+    // allocates, which makes the ring safe to use from the audio thread.
+    template <typename T, int Capacity>
+    class SpscRing
+    {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        SpscRing()
+            : m_Tail(0)
+            , m_Head(0)
+        {
+        }
+
+        // Returns false when the ring is full.
+        bool Push(const T& item)
+        {
+            const uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+            if (tail - m_Head.load(std::memory_order_acquire) == static_cast<uint32_t>(Capacity))
+            {
+                return false;
+            }
+            m_Items[tail & (Capacity - 1)] = item;
+            m_Tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Returns false when the ring is empty.
+        bool Pop(T* pOutItem)
+        {
+            const uint32_t head = m_Head.load(std::memory_order_relaxed);
+            if (head == m_Tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            *pOutItem = m_Items[head & (Capacity - 1)];
+            m_Head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Exact only when called from one of the two threads while the other is idle.
+        int GetCount() const
+        {
+            return static_cast<int>(m_Tail.load(std::memory_order_acquire) - m_Head.load(std::memory_order_acquire));
+        }
+
+        static int GetCapacity() { return Capacity; }
+
+    private:
+        SpscRing(const SpscRing&);
+        SpscRing& operator=(const SpscRing&);
+
+        // The two indices live on separate cache lines so the threads do not false share.
+        alignas(64) std::atomic<uint32_t> m_Tail;
+        alignas(64) std::atomic<uint32_t> m_Head;
+        alignas(64) T m_Items[Capacity];
+    };
+
+}
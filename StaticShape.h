@@ -0,0 +1,192 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "Circle.h"
+#include "Rectangle.h"
+
+//! Shape types for level data that is known at build time.
+//! Unlike Circle and Rectangle they are trivially copyable and every member is
+//! constexpr, so trigger layouts can live in read-only tables, be checked with
+//! static_assert and have their tests inlined into the calling loop.
+//! The scalar type is a template parameter: float, double or Fixed.
+//! The tests follow the runtime classes exactly, inCircle and Collide include the
+//! edge, inRect and Overlap do not.
+
+//! Signed Q16.16 fixed point number, for data that has to give the same answer on every platform.
+class Fixed
+{
+public:
+	static const int FractionBits = 16;
+
+	//! Values a Fixed can hold, from -32768 up to just under 32768.
+	static const int Min = -32768;
+	static const int Max = 32767;
+
+	Fixed() = default;
+	explicit constexpr Fixed(int value_) : m_Raw(Min <= value_ && value_ <= Max ? static_cast<int32_t>(value_) * (1 << FractionBits) : 0)
+	{
+		assert(Min <= value_ && value_ <= Max);
+	}
+	//! Rounds to the nearest step of 1/65536.
+	explicit constexpr Fixed(float value_)
+		: m_Raw(IsInRange(value_) ? static_cast<int32_t>(value_ * (1 << FractionBits) + (value_ < 0.0f ? -0.5f : 0.5f)) : 0)
+	{
+		assert(IsInRange(value_));
+	}
+
+	static constexpr Fixed FromRaw(int32_t raw_) { Fixed value(0); value.m_Raw = raw_; return value; }
+
+	constexpr int32_t GetRaw() const { return m_Raw; }
+	constexpr float ToFloat() const { return static_cast<float>(m_Raw) / (1 << FractionBits); }
+
+	friend constexpr Fixed operator+(Fixed a_, Fixed b_) { return FromRaw(a_.m_Raw + b_.m_Raw); }
+	friend constexpr Fixed operator-(Fixed a_, Fixed b_) { return FromRaw(a_.m_Raw - b_.m_Raw); }
+	friend constexpr Fixed operator-(Fixed a_) { return FromRaw(-a_.m_Raw); }
+	//! The product is formed in 64 bits and truncated back, squares of values up to 181 stay in range.
+	//! The shape tests do not use it, they compare distances on the raw values in 64 bits.
+	friend constexpr Fixed operator*(Fixed a_, Fixed b_)
+	{
+		return FromRaw(static_cast<int32_t>((static_cast<int64_t>(a_.m_Raw) * b_.m_Raw) >> FractionBits));
+	}
+
+	friend constexpr bool operator==(Fixed a_, Fixed b_) { return a_.m_Raw == b_.m_Raw; }
+	friend constexpr bool operator!=(Fixed a_, Fixed b_) { return a_.m_Raw != b_.m_Raw; }
+	friend constexpr bool operator<(Fixed a_, Fixed b_) { return a_.m_Raw < b_.m_Raw; }
+	friend constexpr bool operator<=(Fixed a_, Fixed b_) { return a_.m_Raw <= b_.m_Raw; }
+	friend constexpr bool operator>(Fixed a_, Fixed b_) { return a_.m_Raw > b_.m_Raw; }
+	friend constexpr bool operator>=(Fixed a_, Fixed b_) { return a_.m_Raw >= b_.m_Raw; }
+
+private:
+	//! NaN fails both tests.
+	static constexpr bool IsInRange(float value_) { return value_ >= static_cast<float>(Min) && value_ < static_cast<float>(Max + 1); }
+
+	int32_t m_Raw;
+};
+
+//! Whether the point (ax_, ay_) lies within rA_ + rB_ of (bx_, by_), edge included.
+//! The float version keeps the statement split of Circle::Collide, so it rounds the same way.
+template <typename T>
+struct ShapeDistance
+{
+	static constexpr bool IsWithin(T ax_, T ay_, T bx_, T by_, T rA_, T rB_)
+	{
+		T xGap = ax_ - bx_;
+		T yGap = ay_ - by_;
+		T rSum = rA_ + rB_;
+
+		T xSq = xGap * xGap;
+		T ySq = yGap * yGap;
+		T distSq = xSq + ySq;
+		return distSq <= rSum * rSum;
+	}
+};
+
+//! Exact for any two Fixed points: the gaps and the radius sum stay below 2^32 raw, so their
+//! squares fit in 64 bits unsigned, and the sum of the squares is compared without forming it.
+template <>
+struct ShapeDistance<Fixed>
+{
+	static constexpr uint64_t Abs(int64_t value_) { return static_cast<uint64_t>(value_ < 0 ? -value_ : value_); }
+
+	static constexpr bool IsWithin(Fixed ax_, Fixed ay_, Fixed bx_, Fixed by_, Fixed rA_, Fixed rB_)
+	{
+		const uint64_t xGap = Abs(static_cast<int64_t>(ax_.GetRaw()) - bx_.GetRaw());
+		const uint64_t yGap = Abs(static_cast<int64_t>(ay_.GetRaw()) - by_.GetRaw());
+		const uint64_t rSum = Abs(static_cast<int64_t>(rA_.GetRaw()) + rB_.GetRaw());
+
+		const uint64_t xSq = xGap * xGap;
+		const uint64_t ySq = yGap * yGap;
+		const uint64_t rSq = rSum * rSum;
+		return ySq <= rSq && xSq <= rSq - ySq;
+	}
+};
+
+template <typename T>
+struct BasicCircle
+{
+	BasicCircle() = default;
+	constexpr BasicCircle(T x_, T y_, T r_) : x(x_), y(y_), r(r_) {}
+
+	constexpr bool Collide(const BasicCircle& other_) const
+	{
+		return ShapeDistance<T>::IsWithin(x, y, other_.x, other_.y, r, other_.r);
+	}
+
+	//! Adding a zero radius is exact, so float rounds as it did with r * r.
+	constexpr bool inCircle(T x_, T y_) const
+	{
+		return ShapeDistance<T>::IsWithin(x, y, x_, y_, r, T(0));
+	}
+
+	T x;
+	T y;
+	T r;
+};
+
+template <typename T>
+struct BasicRectangle
+{
+	BasicRectangle() = default;
+	constexpr BasicRectangle(T x1_, T y1_, T x2_, T y2_) : x1(x1_), y1(y1_), x2(x2_), y2(y2_) {}
+
+	constexpr bool inRect(T x_, T y_) const
+	{
+		return x1 < x_ && x_ < x2 && y1 < y_ && y_ < y2;
+	}
+
+	constexpr bool Overlap(const BasicRectangle& other_) const
+	{
+		return x1 < other_.x2 && other_.x1 < x2 && y1 < other_.y2 && other_.y1 < y2;
+	}
+
+	constexpr bool Collide(const BasicCircle<T>& circle_) const
+	{
+		T nearX = circle_.x < x2 ? circle_.x : x2;
+		nearX = x1 > nearX ? x1 : nearX;
+		T nearY = circle_.y < y2 ? circle_.y : y2;
+		nearY = y1 > nearY ? y1 : nearY;
+
+		return ShapeDistance<T>::IsWithin(circle_.x, circle_.y, nearX, nearY, circle_.r, T(0));
+	}
+
+	T x1; //!< bottom left
+	T y1;
+	T x2; //!< top right
+	T y2;
+};
+
+typedef BasicCircle<float> StaticCircle;
+typedef BasicRectangle<float> StaticRectangle;
+typedef BasicCircle<Fixed> FixedCircle;
+typedef BasicRectangle<Fixed> FixedRectangle;
+
+static_assert(std::is_trivially_copyable<Fixed>::value, "Fixed must stay trivially copyable");
+static_assert(std::is_trivially_copyable<StaticCircle>::value, "StaticCircle must stay trivially copyable");
+static_assert(std::is_trivially_copyable<StaticRectangle>::value, "StaticRectangle must stay trivially copyable");
+static_assert(std::is_trivially_copyable<FixedCircle>::value, "FixedCircle must stay trivially copyable");
+static_assert(std::is_trivially_copyable<FixedRectangle>::value, "FixedRectangle must stay trivially copyable");
+
+// Gaps far past the 181 units a Q16.16 square can hold must still miss.
+static_assert(!FixedCircle(Fixed(0), Fixed(0), Fixed(1)).Collide(FixedCircle(Fixed(200), Fixed(0), Fixed(1))), "Far Fixed circles must not collide");
+static_assert(!FixedCircle(Fixed(0), Fixed(0), Fixed(1)).Collide(FixedCircle(Fixed(150), Fixed(150), Fixed(1))), "Far Fixed circles must not collide");
+static_assert(!FixedCircle(Fixed(-32768), Fixed(-32768), Fixed(1)).Collide(FixedCircle(Fixed(32767), Fixed(32767), Fixed(1))), "Far Fixed circles must not collide");
+static_assert(!FixedRectangle(Fixed(0), Fixed(0), Fixed(1), Fixed(1)).Collide(FixedCircle(Fixed(200), Fixed(0), Fixed(1))), "A far Fixed circle must not touch the rectangle");
+static_assert(!FixedCircle(Fixed(0), Fixed(0), Fixed(1)).inCircle(Fixed(0), Fixed(30000)), "A far point must not be in a Fixed circle");
+static_assert(FixedCircle(Fixed(0), Fixed(0), Fixed(1)).Collide(FixedCircle(Fixed(300), Fixed(400), Fixed(499))), "Touching Fixed circles collide");
+static_assert(FixedRectangle(Fixed(0), Fixed(0), Fixed(1), Fixed(1)).Collide(FixedCircle(Fixed(201), Fixed(0), Fixed(200))), "A touching Fixed circle collides");
+
+//! Conversions from the runtime shapes, T must be constructible from float.
+template <typename T>
+inline BasicCircle<T> MakeBasicCircle(const Circle& circle_)
+{
+	return BasicCircle<T>(T(circle_.x), T(circle_.y), T(circle_.r));
+}
+
+template <typename T>
+inline BasicRectangle<T> MakeBasicRectangle(const Rectangle& rect_)
+{
+	return BasicRectangle<T>(T(rect_.x1), T(rect_.y1), T(rect_.x2), T(rect_.y2));
+}
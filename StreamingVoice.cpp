@@ -0,0 +1,238 @@
+#include "StreamingVoice.h"
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Assert.h>
+#include <nn/util/util_BitUtil.h>
+#include <nn/util/util_BytePtr.h>
+
+namespace AUS {
+
+    namespace {
+
+        size_t GetChunkStride()
+        {
+            return nn::util::align_up(StreamingVoice::ChunkByteSize, nn::audio::BufferAlignSize);
+        }
+
+        // The stack starts the work buffer, so it keeps the buffer's alignment.
+        size_t GetStagingOffset()
+        {
+            return nn::util::align_up(StreamingVoice::StackSize, nn::os::ThreadStackAlignment);
+        }
+
+    }
+
+    bool ReadFileHandle(void* pBuffer, int64_t offset, size_t size, void* pUserArg)
+    {
+        return nn::fs::ReadFile(*static_cast<nn::fs::FileHandle*>(pUserArg), offset, pBuffer, size).IsSuccess();
+    }
+
+    StreamingVoice::StreamingVoice()
+        : m_pStaging(nullptr)
+        , m_ReadFrame(0)
+        , m_EndFrame(0)
+        , m_IsLooping(false)
+        , m_IsEndOfStream(false)
+        , m_IsInitialized(false)
+        , m_IsExiting(false)
+    {
+    }
+
+    StreamingVoice::~StreamingVoice()
+    {
+        NN_ASSERT(!m_IsInitialized);
+    }
+
+    size_t StreamingVoice::GetRequiredWaveBufferSize()
+    {
+        return GetChunkStride() * ChunkCount;
+    }
+
+    size_t StreamingVoice::GetRequiredWorkBufferSize()
+    {
+        return GetStagingOffset() + StagingByteSize;
+    }
+
+    void StreamingVoice::Initialize(nn::audio::AudioRendererConfig* pConfig, const char* filename, bool isLooping,
+        void* pWaveBuffer, size_t waveBufferSize, void* pWorkBuffer, size_t workBufferSize)
+    {
+        NN_ASSERT(!m_IsInitialized);
+        NN_ASSERT_NOT_NULL(pConfig);
+        NN_ASSERT_NOT_NULL(filename);
+        NN_ASSERT((reinterpret_cast<uintptr_t>(pWaveBuffer) % nn::audio::BufferAlignSize) == 0);
+        NN_ASSERT(waveBufferSize >= GetRequiredWaveBufferSize());
+        NN_ASSERT((reinterpret_cast<uintptr_t>(pWorkBuffer) % nn::os::ThreadStackAlignment) == 0);
+        NN_ASSERT(workBufferSize >= GetRequiredWorkBufferSize());
+        NN_UNUSED(waveBufferSize);
+        NN_UNUSED(workBufferSize);
+
+        NN_ABORT_UNLESS(nn::fs::OpenFile(&m_File, filename, nn::fs::OpenMode_Read).IsSuccess());
+
+        int64_t fileSize;
+        NN_ABORT_UNLESS(nn::fs::GetFileSize(&fileSize, m_File).IsSuccess());
+        const WavResult wavResult = ParseWav(&m_Info, ReadFileHandle, &m_File, fileSize);
+        NN_ABORT_UNLESS_EQUAL(wavResult, WavResult_Success);
+        NN_ABORT_UNLESS(m_Info.frameCount > 0);
+        // A chunk must hold at least one frame, and the staging buffer one frame of the file.
+        NN_ABORT_UNLESS(static_cast<size_t>(m_Info.channelCount) * sizeof(int16_t) <= ChunkByteSize);
+        NN_ABORT_UNLESS(static_cast<size_t>(m_Info.frameByteSize) <= StagingByteSize);
+
+        m_ReadFrame = 0;
+        m_EndFrame = isLooping ? m_Info.loopEndFrame : m_Info.frameCount;
+        m_IsLooping = isLooping;
+        m_IsEndOfStream.store(false);
+        m_IsExiting.store(false);
+
+        NN_ABORT_UNLESS(nn::audio::AcquireVoiceSlot(pConfig, &m_Voice, m_Info.sampleRate, m_Info.channelCount,
+            nn::audio::SampleFormat_PcmInt16, nn::audio::VoiceType::PriorityHighest, nullptr, 0));
+        nn::audio::SetVoicePlayState(&m_Voice, nn::audio::VoiceType::PlayState_Play);
+
+        // Only the chunks are read by the renderer, the stack and the staging buffer stay out
+        // of the pool.
+        nn::util::BytePtr pChunk(pWaveBuffer);
+        for (int i = 0; i < ChunkCount; ++i)
+        {
+            m_pChunks[i] = pChunk.Get();
+            pChunk.Advance(GetChunkStride());
+            m_EmptyChunks.Push(i);
+        }
+        void* pStack = pWorkBuffer;
+        m_pStaging = nn::util::BytePtr(pWorkBuffer, GetStagingOffset()).Get();
+
+        nn::os::InitializeEvent(&m_WakeEvent, true, nn::os::EventClearMode_AutoClear);
+        nn::Result result = nn::os::CreateThread(&m_Thread, ThreadMain, this, pStack, StackSize, ThreadPriority);
+        NN_ABORT_UNLESS(result.IsSuccess(), "Cannot create the streaming thread.");
+        nn::os::SetThreadName(&m_Thread, "StreamingVoice");
+        nn::os::StartThread(&m_Thread);
+        m_IsInitialized = true;
+    }
+
+    void StreamingVoice::Finalize()
+    {
+        if (!m_IsInitialized)
+        {
+            return;
+        }
+
+        m_IsExiting.store(true, std::memory_order_release);
+        nn::os::SignalEvent(&m_WakeEvent);
+        nn::os::WaitThread(&m_Thread);
+        nn::os::DestroyThread(&m_Thread);
+        nn::os::FinalizeEvent(&m_WakeEvent);
+        nn::fs::CloseFile(m_File);
+        m_IsInitialized = false;
+    }
+
+    void StreamingVoice::Update()
+    {
+        NN_ASSERT(m_IsInitialized);
+
+        bool isWaiting = false;
+        while (const nn::audio::WaveBuffer* pReleased = nn::audio::GetReleasedWaveBuffer(&m_Voice))
+        {
+            const int chunk = static_cast<int>(pReleased - m_WaveBuffers);
+            NN_ASSERT(0 <= chunk && chunk < ChunkCount);
+            m_EmptyChunks.Push(chunk);
+            isWaiting = true;
+        }
+        if (isWaiting)
+        {
+            nn::os::SignalEvent(&m_WakeEvent);
+        }
+
+        int chunk;
+        while (m_FilledChunks.Pop(&chunk))
+        {
+            nn::audio::AppendWaveBuffer(&m_Voice, &m_WaveBuffers[chunk]);
+        }
+    }
+
+    void StreamingVoice::ThreadMain(void* pArg)
+    {
+        static_cast<StreamingVoice*>(pArg)->Run();
+    }
+
+    void StreamingVoice::Run()
+    {
+        for (;;)
+        {
+            nn::os::WaitEvent(&m_WakeEvent);
+            if (m_IsExiting.load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            int chunk;
+            while (m_EmptyChunks.Pop(&chunk))
+            {
+                if (!FillChunk(chunk))
+                {
+                    break;
+                }
+                m_FilledChunks.Push(chunk);
+            }
+        }
+    }
+
+    bool StreamingVoice::FillChunk(int chunk)
+    {
+        if (m_IsEndOfStream.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        const size_t frameSize = m_Info.channelCount * sizeof(int16_t);
+        const int64_t chunkFrameCount = static_cast<int64_t>(ChunkByteSize / frameSize);
+        int16_t* pData = static_cast<int16_t*>(m_pChunks[chunk]);
+        int64_t filled = 0;
+        while (filled < chunkFrameCount)
+        {
+            if (m_ReadFrame == m_EndFrame)
+            {
+                if (!m_IsLooping)
+                {
+                    break;
+                }
+                m_ReadFrame = m_Info.loopStartFrame;
+            }
+            const int64_t remaining = m_EndFrame - m_ReadFrame;
+            const int64_t count = chunkFrameCount - filled < remaining ? chunkFrameCount - filled : remaining;
+            ReadFrames(pData + filled * m_Info.channelCount, m_ReadFrame, count);
+            m_ReadFrame += count;
+            filled += count;
+        }
+
+        const bool isEndOfStream = !m_IsLooping && m_ReadFrame == m_EndFrame;
+        nn::audio::WaveBuffer& waveBuffer = m_WaveBuffers[chunk];
+        waveBuffer.buffer = pData;
+        waveBuffer.size = static_cast<size_t>(filled) * frameSize;
+        waveBuffer.startSampleOffset = 0;
+        waveBuffer.endSampleOffset = static_cast<int32_t>(filled);
+        waveBuffer.loop = false;
+        waveBuffer.isEndOfStream = isEndOfStream;
+        waveBuffer.pContext = nullptr;
+        waveBuffer.contextSize = 0;
+        m_IsEndOfStream.store(isEndOfStream, std::memory_order_release);
+        return filled > 0;
+    }
+
+    void StreamingVoice::ReadFrames(int16_t* pOut, int64_t frame, int64_t frameCount)
+    {
+        const int64_t offset = m_Info.dataOffset + frame * m_Info.frameByteSize;
+        if (m_Info.sampleFormat == WavSampleFormat_PcmInt16)
+        {
+            NN_ABORT_UNLESS(ReadFileHandle(pOut, offset, static_cast<size_t>(frameCount * m_Info.frameByteSize), &m_File));
+            return;
+        }
+
+        // Other formats go through the staging buffer a piece at a time.
+        const int64_t pieceFrameCount = static_cast<int64_t>(StagingByteSize / m_Info.frameByteSize);
+        for (int64_t done = 0; done < frameCount; done += pieceFrameCount)
+        {
+            const int64_t count = frameCount - done < pieceFrameCount ? frameCount - done : pieceFrameCount;
+            NN_ABORT_UNLESS(ReadFileHandle(m_pStaging, offset + done * m_Info.frameByteSize, static_cast<size_t>(count * m_Info.frameByteSize), &m_File));
+            ConvertWavSamples(pOut + done * m_Info.channelCount, m_pStaging, m_Info.sampleFormat, static_cast<size_t>(count * m_Info.channelCount));
+        }
+    }
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+
+#include <nn/os.h>
+#include <nn/fs.h>
+#include <nn/audio.h>
+
+#include "SpscRing.h"
+#include "WavParser.h"
+
+namespace AUS {
+
+    // A WavReadFunction for an nn::fs::FileHandle passed as pUserArg.
+    bool ReadFileHandle(void* pBuffer, int64_t offset, size_t size, void* pUserArg);
+
+    // A voice that streams a WAV file instead of loading it whole.
+    //
+    // The voice plays from ChunkCount wave buffers of ChunkByteSize bytes each. A loader thread
+    // reads the next part of the file into every buffer the voice releases, so a track of any
+    // length costs the same few hundred KB. When the voice loops, the chunk that reaches the end
+    // of the loop continues from its start, so the loop point is sample exact. The loop is the
+    // first loop of the smpl chunk if the file has one, the whole file otherwise.
+    //
+    // Files that are not 16-bit PCM are read through a small staging buffer and converted.
+    //
+    // nn::audio is only touched by Update, which runs on the thread that updates the renderer;
+    // the loader thread only reads files. The two hand chunks over through lock-free rings.
+    class StreamingVoice
+    {
+    public:
+        static const int ChunkCount = 3;
+        static const size_t ChunkByteSize = 64 * 1024;
+        static const size_t StagingByteSize = 16 * 1024;
+        static const size_t StackSize = 16 * 1024;
+        static const int ThreadPriority = nn::os::DefaultThreadPriority;
+
+        StreamingVoice();
+        ~StreamingVoice();
+
+        // The wave buffer holds only the chunks the renderer plays. It must lie in a memory pool
+        // attached to the renderer and be aligned to nn::audio::BufferAlignSize.
+        static size_t GetRequiredWaveBufferSize();
+        // The work buffer holds the thread stack and the staging buffer. It is ordinary memory,
+        // outside any memory pool, aligned to nn::os::ThreadStackAlignment.
+        static size_t GetRequiredWorkBufferSize();
+
+        // Opens filename, acquires the voice and starts the loader thread. The voice starts
+        // playing as soon as the first chunk is read.
+        void Initialize(nn::audio::AudioRendererConfig* pConfig, const char* filename, bool isLooping,
+            void* pWaveBuffer, size_t waveBufferSize, void* pWorkBuffer, size_t workBufferSize);
+        void Finalize();
+
+        // Hands released chunks to the loader and appends the ones it has filled.
+        // Call once per frame, before nn::audio::RequestUpdateAudioRenderer.
+        void Update();
+
+        nn::audio::VoiceType* GetVoice() { return &m_Voice; }
+        // True once a voice that does not loop has read the last of its data.
+        bool IsEndOfStream() const { return m_IsEndOfStream.load(std::memory_order_acquire); }
+
+    private:
+        StreamingVoice(const StreamingVoice&);
+        StreamingVoice& operator=(const StreamingVoice&);
+
+        static void ThreadMain(void* pArg);
+        void Run();
+        // Loader thread. Returns false when there was nothing left to read.
+        bool FillChunk(int chunk);
+        void ReadFrames(int16_t* pOut, int64_t frame, int64_t frameCount);
+
+        nn::audio::VoiceType m_Voice;
+        nn::audio::WaveBuffer m_WaveBuffers[ChunkCount];
+        void* m_pChunks[ChunkCount];
+
+        // Loader thread state.
+        nn::fs::FileHandle m_File;
+        WavInfo m_Info;
+        void* m_pStaging;
+        int64_t m_ReadFrame;
+        int64_t m_EndFrame; // The end of the loop, or of the data when the voice does not loop.
+        bool m_IsLooping;
+        std::atomic<bool> m_IsEndOfStream;
+
+        // Chunks waiting for data, and filled chunks waiting to be appended.
+        SpscRing<int, 4> m_EmptyChunks;
+        SpscRing<int, 4> m_FilledChunks;
+
+        nn::os::ThreadType m_Thread;
+        nn::os::EventType m_WakeEvent;
+        bool m_IsInitialized;
+        std::atomic<bool> m_IsExiting;
+    };
+
+}
@@ -0,0 +1,251 @@
+#include <cassert>
+
+#include "SweepAndPrune.h"
+
+SweepAndPrune::SweepAndPrune() : m_DestroyedPairCount(0)
+{
+	m_Statistics.proxyCount = 0;
+	m_Statistics.swapCount = 0;
+	m_Statistics.addedPairCount = 0;
+	m_Statistics.removedPairCount = 0;
+	m_Statistics.activePairCount = 0;
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+int SweepAndPrune::CreateProxy(const Circle& circle_)
+{
+	return CreateProxy(MakeAabb(circle_));
+}
+
+int SweepAndPrune::CreateProxy(const Rectangle& rect_)
+{
+	return CreateProxy(MakeAabb(rect_));
+}
+
+int SweepAndPrune::CreateProxy(const Aabb& aabb_)
+{
+	int id;
+	if (!m_FreeProxies.empty())
+	{
+		id = m_FreeProxies.back();
+		m_FreeProxies.pop_back();
+	}
+	else
+	{
+		id = static_cast<int>(m_Proxies.size());
+		m_Proxies.push_back(Proxy());
+	}
+
+	Proxy& proxy = m_Proxies[id];
+	proxy.aabb = aabb_;
+	proxy.isAlive = true;
+
+	// The endpoints go to the end of each list and are sorted into place by the
+	// next Update, which also finds the pairs of the new proxy.
+	const float minValue[AxisCount] = { aabb_.minX, aabb_.minY };
+	const float maxValue[AxisCount] = { aabb_.maxX, aabb_.maxY };
+	for (int axis = 0; axis < AxisCount; ++axis)
+	{
+		std::vector<Endpoint>& list = m_Endpoints[axis];
+		Endpoint endpoint;
+		endpoint.proxy = id;
+
+		endpoint.value = minValue[axis];
+		endpoint.isMax = false;
+		proxy.endpointIndex[axis][0] = static_cast<int>(list.size());
+		list.push_back(endpoint);
+
+		endpoint.value = maxValue[axis];
+		endpoint.isMax = true;
+		proxy.endpointIndex[axis][1] = static_cast<int>(list.size());
+		list.push_back(endpoint);
+	}
+
+	++m_Statistics.proxyCount;
+	return id;
+}
+
+void SweepAndPrune::MoveProxy(int id_, const Circle& circle_)
+{
+	MoveProxy(id_, MakeAabb(circle_));
+}
+
+void SweepAndPrune::MoveProxy(int id_, const Rectangle& rect_)
+{
+	MoveProxy(id_, MakeAabb(rect_));
+}
+
+void SweepAndPrune::MoveProxy(int id_, const Aabb& aabb_)
+{
+	assert(IsValid(id_));
+	Proxy& proxy = m_Proxies[id_];
+	proxy.aabb = aabb_;
+	m_Endpoints[0][proxy.endpointIndex[0][0]].value = aabb_.minX;
+	m_Endpoints[0][proxy.endpointIndex[0][1]].value = aabb_.maxX;
+	m_Endpoints[1][proxy.endpointIndex[1][0]].value = aabb_.minY;
+	m_Endpoints[1][proxy.endpointIndex[1][1]].value = aabb_.maxY;
+}
+
+void SweepAndPrune::DestroyProxy(int id_)
+{
+	assert(IsValid(id_));
+
+	for (int i = static_cast<int>(m_Pairs.size()) - 1; i >= 0; --i)
+	{
+		if (m_Pairs[i].a == id_ || m_Pairs[i].b == id_)
+		{
+			RemovePair(m_Pairs[i].a, m_Pairs[i].b);
+			++m_DestroyedPairCount;
+		}
+	}
+
+	// Close the gaps in both lists. The order of the remaining endpoints is unchanged.
+	for (int axis = 0; axis < AxisCount; ++axis)
+	{
+		std::vector<Endpoint>& list = m_Endpoints[axis];
+		int write = 0;
+		for (int read = 0; read < static_cast<int>(list.size()); ++read)
+		{
+			const Endpoint& endpoint = list[read];
+			if (endpoint.proxy == id_)
+			{
+				continue;
+			}
+			m_Proxies[endpoint.proxy].endpointIndex[axis][endpoint.isMax ? 1 : 0] = write;
+			list[write++] = endpoint;
+		}
+		list.resize(write);
+	}
+
+	m_Proxies[id_].isAlive = false;
+	m_FreeProxies.push_back(id_);
+	--m_Statistics.proxyCount;
+}
+
+bool SweepAndPrune::IsValid(int id_) const
+{
+	return 0 <= id_ && id_ < static_cast<int>(m_Proxies.size()) && m_Proxies[id_].isAlive;
+}
+
+const Aabb& SweepAndPrune::GetAabb(int id_) const
+{
+	assert(IsValid(id_));
+	return m_Proxies[id_].aabb;
+}
+
+void SweepAndPrune::Update()
+{
+	m_Statistics.swapCount = 0;
+	m_Statistics.addedPairCount = 0;
+	m_Statistics.removedPairCount = m_DestroyedPairCount;
+	m_DestroyedPairCount = 0;
+
+	for (int axis = 0; axis < AxisCount; ++axis)
+	{
+		SortAxis(axis);
+	}
+
+	m_Statistics.activePairCount = static_cast<int>(m_Pairs.size());
+}
+
+uint64_t SweepAndPrune::PairKey(int a_, int b_)
+{
+	uint32_t lo = static_cast<uint32_t>(a_ < b_ ? a_ : b_);
+	uint32_t hi = static_cast<uint32_t>(a_ < b_ ? b_ : a_);
+	return (static_cast<uint64_t>(hi) << 32) | lo;
+}
+
+bool SweepAndPrune::IsBefore(const Endpoint& a_, const Endpoint& b_)
+{
+	// On equal values a min goes before a max, so touching bounds count as overlapping.
+	if (a_.value != b_.value)
+	{
+		return a_.value < b_.value;
+	}
+	return !a_.isMax && b_.isMax;
+}
+
+void SweepAndPrune::SortAxis(int axis_)
+{
+	std::vector<Endpoint>& list = m_Endpoints[axis_];
+	const int count = static_cast<int>(list.size());
+
+	for (int i = 1; i < count; ++i)
+	{
+		const Endpoint endpoint = list[i];
+		int j = i - 1;
+		while (j >= 0 && IsBefore(endpoint, list[j]))
+		{
+			const Endpoint& passed = list[j];
+
+			// A min moving left past a max starts an overlap on this axis, a max
+			// moving left past a min ends one. Min/min and max/max swaps change nothing.
+			if (!endpoint.isMax && passed.isMax)
+			{
+				if (AabbOverlap(m_Proxies[endpoint.proxy].aabb, m_Proxies[passed.proxy].aabb))
+				{
+					AddPair(endpoint.proxy, passed.proxy);
+				}
+			}
+			else if (endpoint.isMax && !passed.isMax)
+			{
+				if (RemovePair(endpoint.proxy, passed.proxy))
+				{
+					++m_Statistics.removedPairCount;
+				}
+			}
+
+			list[j + 1] = passed;
+			m_Proxies[passed.proxy].endpointIndex[axis_][passed.isMax ? 1 : 0] = j + 1;
+			--j;
+			++m_Statistics.swapCount;
+		}
+
+		if (j + 1 != i)
+		{
+			list[j + 1] = endpoint;
+			m_Proxies[endpoint.proxy].endpointIndex[axis_][endpoint.isMax ? 1 : 0] = j + 1;
+		}
+	}
+}
+
+void SweepAndPrune::AddPair(int a_, int b_)
+{
+	// Both axes can report the same new pair within one Update.
+	uint64_t key = PairKey(a_, b_);
+	if (m_PairIndex.find(key) != m_PairIndex.end())
+	{
+		return;
+	}
+
+	CollisionPair pair;
+	pair.a = a_ < b_ ? a_ : b_;
+	pair.b = a_ < b_ ? b_ : a_;
+	m_PairIndex[key] = static_cast<int>(m_Pairs.size());
+	m_Pairs.push_back(pair);
+	++m_Statistics.addedPairCount;
+}
+
+bool SweepAndPrune::RemovePair(int a_, int b_)
+{
+	std::unordered_map<uint64_t, int>::iterator it = m_PairIndex.find(PairKey(a_, b_));
+	if (it == m_PairIndex.end())
+	{
+		return false;
+	}
+
+	int index = it->second;
+	m_PairIndex.erase(it);
+
+	int last = static_cast<int>(m_Pairs.size()) - 1;
+	if (index != last)
+	{
+		m_Pairs[index] = m_Pairs[last];
+		m_PairIndex[PairKey(m_Pairs[index].a, m_Pairs[index].b)] = index;
+	}
+	m_Pairs.pop_back();
+	return true;
+}
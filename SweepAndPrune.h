@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Aabb.h"
+#include "CollisionPair.h"
+
+//! Incremental sweep-and-prune broadphase over Circle and Rectangle bounds.
+//! Both axes keep a sorted endpoint list from the previous Update, which is
+//! repaired with insertion sort. Every swap between a min and a max endpoint
+//! is a possible start or end of an overlap, so the persistent pair list is
+//! updated with work proportional to how much the ordering changed.
+//! Pairs are bounds overlaps only, run the shape test on them as needed.
+class SweepAndPrune
+{
+public:
+	static const int InvalidProxyId = -1;
+
+	//! Counters for the last Update. When swapCount approaches the square of the
+	//! proxy count the scene has lost its frame-to-frame coherence.
+	struct Statistics
+	{
+		int proxyCount;
+		int swapCount;        //!< Endpoint swaps done by the insertion sorts.
+		int addedPairCount;   //!< Pairs that started overlapping.
+		int removedPairCount; //!< Pairs that stopped overlapping, including destroyed proxies.
+		int activePairCount;  //!< Pairs overlapping after the update.
+	};
+
+	SweepAndPrune();
+	~SweepAndPrune();
+
+	//! New proxies are sorted in by the next Update. Creating many at once makes
+	//! that Update quadratic, which shows up as a large swapCount.
+	int CreateProxy(const Circle& circle_);
+	int CreateProxy(const Rectangle& rect_);
+	int CreateProxy(const Aabb& aabb_);
+
+	//! New bounds take effect on the next Update.
+	void MoveProxy(int id_, const Circle& circle_);
+	void MoveProxy(int id_, const Rectangle& rect_);
+	void MoveProxy(int id_, const Aabb& aabb_);
+
+	void DestroyProxy(int id_);
+
+	bool IsValid(int id_) const;
+	const Aabb& GetAabb(int id_) const;
+
+	//! Re-sorts both axes and updates the pair list.
+	void Update();
+
+	//! Pairs overlapping as of the last Update, in no particular order.
+	const std::vector<CollisionPair>& GetPairs() const { return m_Pairs; }
+	const Statistics& GetStatistics() const { return m_Statistics; }
+
+private:
+	static const int AxisCount = 2;
+
+	struct Endpoint
+	{
+		float value;
+		int proxy;    //!< Owning proxy id.
+		bool isMax;
+	};
+
+	struct Proxy
+	{
+		Aabb aabb;
+		int endpointIndex[AxisCount][2]; //!< Position of the min and max endpoint on each axis.
+		bool isAlive;
+	};
+
+	static uint64_t PairKey(int a_, int b_);
+	static bool IsBefore(const Endpoint& a_, const Endpoint& b_);
+
+	void SortAxis(int axis_);
+	void AddPair(int a_, int b_);
+	bool RemovePair(int a_, int b_);
+
+	std::vector<Proxy> m_Proxies;
+	std::vector<int> m_FreeProxies;
+	std::vector<Endpoint> m_Endpoints[AxisCount];
+
+	std::vector<CollisionPair> m_Pairs;
+	std::unordered_map<uint64_t, int> m_PairIndex; //!< Pair key to position in m_Pairs.
+
+	Statistics m_Statistics;
+	int m_DestroyedPairCount; //!< Pairs removed by DestroyProxy since the last Update.
+};
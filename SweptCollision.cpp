@@ -0,0 +1,190 @@
+#include <cmath>
+
+#include "CircleBatch.h"
+#include "SweptCollision.h"
+
+namespace
+{
+	// Entry time of the ray p + t * d into a circle, for a ray starting outside it.
+	bool RayCircle(float px_, float py_, float dx_, float dy_, float cx_, float cy_, float r_, float* pOutT)
+	{
+		float mx = px_ - cx_;
+		float my = py_ - cy_;
+		float a = dx_ * dx_ + dy_ * dy_;
+		float b = mx * dx_ + my * dy_;
+		float c = mx * mx + my * my - r_ * r_;
+		if (a <= 0.0f || b >= 0.0f)
+		{
+			// Not moving, or moving away.
+			return false;
+		}
+		float disc = b * b - a * c;
+		if (disc < 0.0f)
+		{
+			return false;
+		}
+		float t = (-b - std::sqrt(disc)) / a;
+		*pOutT = t > 0.0f ? t : 0.0f;
+		return true;
+	}
+
+	// Entry time of the ray p + t * d into a box, slab by slab.
+	bool RayBox(float px_, float py_, float dx_, float dy_,
+		float minX_, float minY_, float maxX_, float maxY_, float* pOutT)
+	{
+		float tEnter = 0.0f;
+		float tExit = 1.0f;
+
+		const float p[2] = { px_, py_ };
+		const float d[2] = { dx_, dy_ };
+		const float lo[2] = { minX_, minY_ };
+		const float hi[2] = { maxX_, maxY_ };
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			if (d[axis] == 0.0f)
+			{
+				if (p[axis] < lo[axis] || hi[axis] < p[axis])
+				{
+					return false;
+				}
+				continue;
+			}
+			float inv = 1.0f / d[axis];
+			float t0 = (lo[axis] - p[axis]) * inv;
+			float t1 = (hi[axis] - p[axis]) * inv;
+			if (t0 > t1)
+			{
+				float tmp = t0;
+				t0 = t1;
+				t1 = tmp;
+			}
+			tEnter = t0 > tEnter ? t0 : tEnter;
+			tExit = t1 < tExit ? t1 : tExit;
+			if (tEnter > tExit)
+			{
+				return false;
+			}
+		}
+
+		*pOutT = tEnter;
+		return true;
+	}
+}
+
+bool SweepCircleCircle(const Circle& a_, float dxA_, float dyA_,
+	const Circle& b_, float dxB_, float dyB_, float* pOutToi)
+{
+	Circle a = a_;
+	if (a.Collide(b_))
+	{
+		*pOutToi = 0.0f;
+		return true;
+	}
+
+	// Work in the frame of b_, a point sweeping against the circle of radius ra + rb.
+	float t;
+	if (!RayCircle(a_.x, a_.y, dxA_ - dxB_, dyA_ - dyB_, b_.x, b_.y, a_.r + b_.r, &t) || t > 1.0f)
+	{
+		return false;
+	}
+
+	*pOutToi = t;
+	return true;
+}
+
+bool SweepCircleRect(const Circle& circle_, float dx_, float dy_, const Rectangle& rect_, float* pOutToi)
+{
+	if (rect_.Collide(circle_))
+	{
+		*pOutToi = 0.0f;
+		return true;
+	}
+
+	// The center sweeps against the rectangle grown by the radius, a rounded box.
+	// That shape is the union of two crossed boxes and four corner circles, and
+	// the earliest entry into any of them is the contact time.
+	const float r = circle_.r;
+	float best = 2.0f;
+	float t;
+
+	if (RayBox(circle_.x, circle_.y, dx_, dy_, rect_.x1 - r, rect_.y1, rect_.x2 + r, rect_.y2, &t) && t < best)
+	{
+		best = t;
+	}
+	if (RayBox(circle_.x, circle_.y, dx_, dy_, rect_.x1, rect_.y1 - r, rect_.x2, rect_.y2 + r, &t) && t < best)
+	{
+		best = t;
+	}
+
+	const float cornerX[4] = { rect_.x1, rect_.x2, rect_.x1, rect_.x2 };
+	const float cornerY[4] = { rect_.y1, rect_.y1, rect_.y2, rect_.y2 };
+	for (int i = 0; i < 4; ++i)
+	{
+		if (RayCircle(circle_.x, circle_.y, dx_, dy_, cornerX[i], cornerY[i], r, &t) && t < best)
+		{
+			best = t;
+		}
+	}
+
+	if (best > 1.0f)
+	{
+		return false;
+	}
+
+	*pOutToi = best;
+	return true;
+}
+
+int SweepCirclesVsCircle(const CircleBatch& circles_, const float* pDx_, const float* pDy_,
+	const Circle& target_, float dx_, float dy_, float* pOutToi)
+{
+	const int count = circles_.GetCount();
+	const float* pX = circles_.GetX();
+	const float* pY = circles_.GetY();
+	const float* pR = circles_.GetR();
+
+	int hitCount = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		float toi;
+		if (SweepCircleCircle(Circle(pX[i], pY[i], pR[i]), pDx_[i], pDy_[i], target_, dx_, dy_, &toi))
+		{
+			pOutToi[i] = toi;
+			++hitCount;
+		}
+		else
+		{
+			pOutToi[i] = SweepNoImpact;
+		}
+	}
+	return hitCount;
+}
+
+int SweepCirclesVsRect(const CircleBatch& circles_, const float* pDx_, const float* pDy_,
+	const Rectangle& rect_, float* pOutToi)
+{
+	const int count = circles_.GetCount();
+	const float* pX = circles_.GetX();
+	const float* pY = circles_.GetY();
+	const float* pR = circles_.GetR();
+
+	// Circles that cannot reach the rectangle this frame skip the exact sweep.
+	int hitCount = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		float minX = (pDx_[i] < 0.0f ? pX[i] + pDx_[i] : pX[i]) - pR[i];
+		float maxX = (pDx_[i] < 0.0f ? pX[i] : pX[i] + pDx_[i]) + pR[i];
+		float minY = (pDy_[i] < 0.0f ? pY[i] + pDy_[i] : pY[i]) - pR[i];
+		float maxY = (pDy_[i] < 0.0f ? pY[i] : pY[i] + pDy_[i]) + pR[i];
+		float toi;
+		if (maxX < rect_.x1 || rect_.x2 < minX || maxY < rect_.y1 || rect_.y2 < minY
+			|| !SweepCircleRect(Circle(pX[i], pY[i], pR[i]), pDx_[i], pDy_[i], rect_, &toi))
+		{
+			pOutToi[i] = SweepNoImpact;
+			continue;
+		}
+		pOutToi[i] = toi;
+		++hitCount;
+	}
+	return hitCount;
+}
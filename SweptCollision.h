@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Circle.h"
+#include "Rectangle.h"
+
+class CircleBatch;
+
+//! Continuous collision for fast moving circles.
+//! Motions are displacements over one frame and contact times are fractions of
+//! that frame in [0, 1], so one sweep per frame replaces sub-stepping.
+//! Shapes already touching at the start of the frame report time 0.
+
+//! Written to the time of impact outputs of the batch queries when there is no contact.
+const float SweepNoImpact = -1.0f;
+
+//! Circle a_ moves by (dxA_, dyA_) and b_ by (dxB_, dyB_).
+//! Returns true and writes the earliest contact time to pOutToi when they touch within the frame.
+bool SweepCircleCircle(const Circle& a_, float dxA_, float dyA_,
+	const Circle& b_, float dxB_, float dyB_, float* pOutToi);
+
+//! Circle circle_ moves by (dx_, dy_) against the static rectangle rect_.
+bool SweepCircleRect(const Circle& circle_, float dx_, float dy_, const Rectangle& rect_, float* pOutToi);
+
+//! Every circle i of circles_ moves by (pDx_[i], pDy_[i]) against target_ moving by (dx_, dy_).
+//! pOutToi[i] gets the contact time or SweepNoImpact. Returns the number of contacts.
+int SweepCirclesVsCircle(const CircleBatch& circles_, const float* pDx_, const float* pDy_,
+	const Circle& target_, float dx_, float dy_, float* pOutToi);
+
+//! Every circle i of circles_ moves by (pDx_[i], pDy_[i]) against the static rectangle rect_.
+int SweepCirclesVsRect(const CircleBatch& circles_, const float* pDx_, const float* pDy_,
+	const Rectangle& rect_, float* pOutToi);
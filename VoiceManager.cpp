@@ -0,0 +1,183 @@
+#include "VoiceManager.h"
+
+#include <nn/nn_Abort.h>
+#include <nn/nn_Assert.h>
+#include <nn/os.h>
+
+namespace AUS {
+
+    namespace {
+
+        // An ADPCM frame is 8 bytes holding 14 samples; playback can only start on a frame.
+        const int AdpcmFrameSampleCount = 14;
+
+    }
+
+    VoiceManager::VoiceManager(int soundCountMax, int voiceCount)
+        : m_pConfig(nullptr)
+        , m_pFinalMix(nullptr)
+        , m_Virtualizer(soundCountMax, voiceCount)
+        , m_Slots(voiceCount)
+        , m_Sounds(soundCountMax)
+        , m_Changes(m_Virtualizer.GetChangeCountMax())
+        , m_VoiceCount(0)
+    {
+        for (size_t i = 0; i < m_Slots.size(); ++i)
+        {
+            m_Slots[i].sound = InvalidSound;
+        }
+    }
+
+    VoiceManager::~VoiceManager()
+    {
+        NN_ASSERT(m_VoiceCount == 0);
+    }
+
+    void VoiceManager::Initialize(nn::audio::AudioRendererConfig* pConfig, nn::audio::FinalMixType* pFinalMix)
+    {
+        NN_ASSERT_NOT_NULL(pConfig);
+        NN_ASSERT_NOT_NULL(pFinalMix);
+        m_pConfig = pConfig;
+        m_pFinalMix = pFinalMix;
+    }
+
+    void VoiceManager::Finalize()
+    {
+        for (size_t i = 0; i < m_Slots.size(); ++i)
+        {
+            if (m_Slots[i].sound != InvalidSound)
+            {
+                StopVoice(&m_Slots[i]);
+            }
+        }
+    }
+
+    int VoiceManager::Play(const VoiceSource* pSource, int bus, int priority, float volume, bool isLooping)
+    {
+        NN_ASSERT_NOT_NULL(m_pConfig);
+        NN_ASSERT(pSource != nullptr && pSource->pHeader != nullptr && pSource->pData != nullptr);
+        const int sound = m_Virtualizer.Play(GetNow(), pSource->pHeader->sampleCount, pSource->pHeader->sampleRate,
+            isLooping, priority, volume);
+        if (sound != InvalidSound)
+        {
+            m_Sounds[sound].pSource = pSource;
+            m_Sounds[sound].bus = bus;
+            m_Sounds[sound].isLooping = isLooping;
+        }
+        return sound;
+    }
+
+    void VoiceManager::Stop(int sound)
+    {
+        m_Virtualizer.Stop(sound);
+    }
+
+    void VoiceManager::SetVolume(int sound, float volume)
+    {
+        m_Virtualizer.SetVolume(sound, volume);
+    }
+
+    void VoiceManager::SetDistance(int sound, float distance)
+    {
+        m_Virtualizer.SetDistance(sound, distance);
+    }
+
+    void VoiceManager::SetAttenuationRange(float minDistance, float maxDistance)
+    {
+        m_Virtualizer.SetAttenuationRange(minDistance, maxDistance);
+    }
+
+    bool VoiceManager::IsPlaying(int sound) const
+    {
+        return m_Virtualizer.IsPlaying(sound);
+    }
+
+    void VoiceManager::Update()
+    {
+        NN_ASSERT_NOT_NULL(m_pConfig);
+        const int64_t now = GetNow();
+
+        // The stops come first, so their voices are free for the starts.
+        const int changeCount = m_Virtualizer.Update(now, m_Changes.data(), static_cast<int>(m_Changes.size()));
+        for (int i = 0; i < changeCount; ++i)
+        {
+            const SoundSlotChange& change = m_Changes[i];
+            if (change.isStart)
+            {
+                StartVoice(&m_Slots[change.slot], change.sound, now);
+            }
+            else
+            {
+                StopVoice(&m_Slots[change.slot]);
+            }
+        }
+
+        // Distance and volume move every frame, the voices follow.
+        for (size_t i = 0; i < m_Slots.size(); ++i)
+        {
+            Slot& slot = m_Slots[i];
+            if (slot.sound != InvalidSound)
+            {
+                nn::audio::SetVoiceMixVolume(&slot.voice, m_pFinalMix, m_Virtualizer.GetAudibility(slot.sound), 0, m_Sounds[slot.sound].bus);
+            }
+        }
+    }
+
+    int64_t VoiceManager::GetNow()
+    {
+        return nn::os::GetSystemTick().ToTimeSpan().GetMicroSeconds();
+    }
+
+    void VoiceManager::StartVoice(Slot* pSlot, int sound, int64_t now)
+    {
+        NN_ASSERT(pSlot->sound == InvalidSound);
+        const SoundInfo& info = m_Sounds[sound];
+        nn::audio::AdpcmHeaderInfo* pHeader = info.pSource->pHeader;
+
+        // The renderer has room for every slot, a failure here is a setup error.
+        NN_ABORT_UNLESS(nn::audio::AcquireVoiceSlot(m_pConfig, &pSlot->voice, pHeader->sampleRate, 1, nn::audio::SampleFormat_Adpcm,
+            nn::audio::VoiceType::PriorityHighest, &pHeader->parameter, sizeof(nn::audio::AdpcmParameter)));
+        pSlot->sound = sound;
+        ++m_VoiceCount;
+        nn::audio::SetVoiceDestination(m_pConfig, &pSlot->voice, m_pFinalMix);
+        nn::audio::SetVoiceMixVolume(&pSlot->voice, m_pFinalMix, m_Virtualizer.GetAudibility(sound), 0, info.bus);
+
+        // Resume on the frame the sound has reached. The decoder starts that frame without
+        // history, which is inaudible next to the jump in level of a voice coming back.
+        const int64_t position = m_Virtualizer.GetPosition(sound, now);
+        const int32_t startSample = static_cast<int32_t>(position - position % AdpcmFrameSampleCount);
+
+        nn::audio::WaveBuffer& first = pSlot->waveBuffers[0];
+        first.buffer = info.pSource->pData;
+        first.size = info.pSource->dataSize;
+        first.startSampleOffset = startSample;
+        first.endSampleOffset = pHeader->sampleCount;
+        first.loop = info.isLooping && startSample == 0;
+        first.isEndOfStream = false;
+        first.pContext = startSample == 0 ? &pHeader->loopContext : nullptr;
+        first.contextSize = startSample == 0 ? sizeof(nn::audio::AdpcmContext) : 0;
+        nn::audio::AppendWaveBuffer(&pSlot->voice, &first);
+
+        if (info.isLooping && startSample != 0)
+        {
+            nn::audio::WaveBuffer& loop = pSlot->waveBuffers[1];
+            loop = first;
+            loop.startSampleOffset = 0;
+            loop.loop = true;
+            loop.pContext = &pHeader->loopContext;
+            loop.contextSize = sizeof(nn::audio::AdpcmContext);
+            nn::audio::AppendWaveBuffer(&pSlot->voice, &loop);
+        }
+        nn::audio::SetVoicePlayState(&pSlot->voice, nn::audio::VoiceType::PlayState_Play);
+    }
+
+    void VoiceManager::StopVoice(Slot* pSlot)
+    {
+        NN_ASSERT(pSlot->sound != InvalidSound);
+        nn::audio::SetVoicePlayState(&pSlot->voice, nn::audio::VoiceType::PlayState_Stop);
+        nn::audio::ReleaseVoiceSlot(m_pConfig, &pSlot->voice);
+        pSlot->sound = InvalidSound;
+        --m_VoiceCount;
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include <nn/audio.h>
+
+#include "SoundVirtualizer.h"
+
+namespace AUS {
+
+    // An ADPCM sound a VoiceManager can play. It must outlive every sound played from it.
+    struct VoiceSource
+    {
+        nn::audio::AdpcmHeaderInfo* pHeader;
+        const void* pData; // Inside a memory pool attached to the renderer.
+        size_t dataSize;
+    };
+
+    // Plays any number of sounds on a fixed number of renderer voices.
+    //
+    // Each sound is a logical sound of a SoundVirtualizer. Only the most audible ones hold a
+    // real voice; the rest keep time without one and, when they win a voice back, start on
+    // the sample they would have reached. Voices are acquired when a sound gets a slot and
+    // released when it loses it, so the renderer never runs more than voiceCount of them.
+    //
+    // Call every function from the thread that updates the renderer.
+    class VoiceManager
+    {
+    public:
+        static const int InvalidSound = SoundVirtualizer::InvalidSound;
+
+        VoiceManager(int soundCountMax, int voiceCount);
+        ~VoiceManager();
+
+        void Initialize(nn::audio::AudioRendererConfig* pConfig, nn::audio::FinalMixType* pFinalMix);
+        // Releases every voice.
+        void Finalize();
+
+        // Plays source into mix buffer bus of the final mix. Sounds with a higher priority
+        // take voices from lower ones whatever their volume. Returns InvalidSound when
+        // soundCountMax sounds are already playing.
+        int Play(const VoiceSource* pSource, int bus, int priority, float volume, bool isLooping);
+        void Stop(int sound);
+        void SetVolume(int sound, float volume);
+        void SetDistance(int sound, float distance);
+        void SetAttenuationRange(float minDistance, float maxDistance);
+        bool IsPlaying(int sound) const;
+
+        // Moves voices to the most audible sounds and applies their volumes.
+        // Call once per frame, before nn::audio::RequestUpdateAudioRenderer.
+        void Update();
+
+        int GetSoundCount() const { return m_Virtualizer.GetSoundCount(); }
+        int GetVoiceCount() const { return m_VoiceCount; }
+
+    private:
+        VoiceManager(const VoiceManager&);
+        VoiceManager& operator=(const VoiceManager&);
+
+        struct Slot
+        {
+            nn::audio::VoiceType voice;
+            // A looping sound that resumes mid way plays the rest once, then loops from the start.
+            nn::audio::WaveBuffer waveBuffers[2];
+            int sound; // InvalidSound while the voice is released.
+        };
+
+        struct SoundInfo
+        {
+            const VoiceSource* pSource;
+            int bus;
+            bool isLooping;
+        };
+
+        static int64_t GetNow();
+        void StartVoice(Slot* pSlot, int sound, int64_t now);
+        void StopVoice(Slot* pSlot);
+
+        nn::audio::AudioRendererConfig* m_pConfig;
+        nn::audio::FinalMixType* m_pFinalMix;
+        SoundVirtualizer m_Virtualizer;
+        std::vector<Slot> m_Slots;
+        std::vector<SoundInfo> m_Sounds;
+        std::vector<SoundSlotChange> m_Changes;
+        int m_VoiceCount;
+    };
+
+}
@@ -0,0 +1,277 @@
+#include "WavParser.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "AudioSampleTraits.h"
+
+namespace AUS {
+
+    namespace {
+
+        const uint16_t FormatTagPcm = 0x0001;
+        const uint16_t FormatTagFloat = 0x0003;
+        const uint16_t FormatTagExtensible = 0xFFFE;
+
+        const size_t ChunkHeaderSize = 8;
+        const size_t FormatSizeMin = 16;
+        const size_t FormatSizeExtensible = 40;
+        // The smpl chunk up to and including its first loop.
+        const size_t SamplerSizeFirstLoop = 36 + 24;
+
+        uint16_t ReadLe16(const uint8_t* p)
+        {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        uint32_t ReadLe32(const uint8_t* p)
+        {
+            return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+                | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        bool IsChunk(const uint8_t* pHeader, const char* pId)
+        {
+            return std::memcmp(pHeader, pId, 4) == 0;
+        }
+
+        WavResult ParseFormat(WavInfo* pInfo, const uint8_t* pFormat, size_t size)
+        {
+            uint16_t formatTag = ReadLe16(pFormat);
+            const int channelCount = ReadLe16(pFormat + 2);
+            const uint32_t sampleRate = ReadLe32(pFormat + 4);
+            const int blockAlign = ReadLe16(pFormat + 12);
+            const int bitsPerSample = ReadLe16(pFormat + 14);
+            if (formatTag == FormatTagExtensible)
+            {
+                if (size < FormatSizeExtensible)
+                {
+                    return WavResult_Corrupt;
+                }
+                // The sub format GUID starts with the plain format tag.
+                formatTag = ReadLe16(pFormat + 24);
+            }
+
+            if (formatTag == FormatTagPcm && bitsPerSample == 8)
+            {
+                pInfo->sampleFormat = WavSampleFormat_PcmUInt8;
+            }
+            else if (formatTag == FormatTagPcm && bitsPerSample == 16)
+            {
+                pInfo->sampleFormat = WavSampleFormat_PcmInt16;
+            }
+            else if (formatTag == FormatTagPcm && bitsPerSample == 24)
+            {
+                pInfo->sampleFormat = WavSampleFormat_PcmInt24;
+            }
+            else if (formatTag == FormatTagPcm && bitsPerSample == 32)
+            {
+                pInfo->sampleFormat = WavSampleFormat_PcmInt32;
+            }
+            else if (formatTag == FormatTagFloat && bitsPerSample == 32)
+            {
+                pInfo->sampleFormat = WavSampleFormat_PcmFloat;
+            }
+            else
+            {
+                return WavResult_UnsupportedFormat;
+            }
+
+            if (channelCount == 0 || sampleRate == 0 || sampleRate > INT32_MAX
+                || blockAlign != channelCount * GetWavSampleByteSize(pInfo->sampleFormat))
+            {
+                return WavResult_UnsupportedFormat;
+            }
+            pInfo->channelCount = channelCount;
+            pInfo->sampleRate = static_cast<int>(sampleRate);
+            pInfo->frameByteSize = blockAlign;
+            return WavResult_Success;
+        }
+
+    }
+
+    WavResult ParseWav(WavInfo* pOutInfo, WavReadFunction readFunction, void* pUserArg, int64_t fileSize)
+    {
+        assert(pOutInfo != nullptr);
+        assert(readFunction != nullptr);
+
+        uint8_t header[12];
+        if (fileSize < static_cast<int64_t>(sizeof(header)))
+        {
+            return WavResult_NotWave;
+        }
+        if (!readFunction(header, 0, sizeof(header), pUserArg))
+        {
+            return WavResult_ReadError;
+        }
+        if (!IsChunk(header, "RIFF") || !IsChunk(header + 8, "WAVE"))
+        {
+            return WavResult_NotWave;
+        }
+
+        WavInfo info = {};
+        bool hasFormat = false;
+        bool hasData = false;
+        int64_t dataSize = 0;
+        int64_t offset = sizeof(header);
+        while (offset + static_cast<int64_t>(ChunkHeaderSize) <= fileSize)
+        {
+            uint8_t chunkHeader[ChunkHeaderSize];
+            if (!readFunction(chunkHeader, offset, sizeof(chunkHeader), pUserArg))
+            {
+                return WavResult_ReadError;
+            }
+            const int64_t bodyOffset = offset + static_cast<int64_t>(ChunkHeaderSize);
+            int64_t chunkSize = ReadLe32(chunkHeader + 4);
+
+            if (IsChunk(chunkHeader, "data"))
+            {
+                // Writers that stream sometimes leave the size at its maximum, the samples run
+                // to the end of the file then.
+                if (bodyOffset + chunkSize > fileSize)
+                {
+                    chunkSize = fileSize - bodyOffset;
+                }
+                info.dataOffset = bodyOffset;
+                dataSize = chunkSize;
+                hasData = true;
+            }
+            else if (bodyOffset + chunkSize > fileSize)
+            {
+                return WavResult_Corrupt;
+            }
+            else if (IsChunk(chunkHeader, "fmt "))
+            {
+                if (chunkSize < static_cast<int64_t>(FormatSizeMin))
+                {
+                    return WavResult_Corrupt;
+                }
+                uint8_t format[FormatSizeExtensible];
+                const size_t size = chunkSize < static_cast<int64_t>(sizeof(format)) ? static_cast<size_t>(chunkSize) : sizeof(format);
+                if (!readFunction(format, bodyOffset, size, pUserArg))
+                {
+                    return WavResult_ReadError;
+                }
+                const WavResult result = ParseFormat(&info, format, size);
+                if (result != WavResult_Success)
+                {
+                    return result;
+                }
+                hasFormat = true;
+            }
+            else if (IsChunk(chunkHeader, "smpl") && chunkSize >= static_cast<int64_t>(SamplerSizeFirstLoop))
+            {
+                uint8_t sampler[SamplerSizeFirstLoop];
+                if (!readFunction(sampler, bodyOffset, sizeof(sampler), pUserArg))
+                {
+                    return WavResult_ReadError;
+                }
+                if (ReadLe32(sampler + 28) > 0)
+                {
+                    // The end of a sampler loop is the last frame played, inclusive.
+                    info.hasLoop = true;
+                    info.loopStartFrame = ReadLe32(sampler + 36 + 8);
+                    info.loopEndFrame = static_cast<int64_t>(ReadLe32(sampler + 36 + 12)) + 1;
+                }
+            }
+
+            // Chunks are padded to an even size.
+            offset = bodyOffset + chunkSize + (chunkSize & 1);
+        }
+
+        if (!hasFormat)
+        {
+            return WavResult_NoFormat;
+        }
+        if (!hasData)
+        {
+            return WavResult_NoData;
+        }
+        info.frameCount = dataSize / info.frameByteSize;
+        if (info.hasLoop && !(info.loopStartFrame < info.loopEndFrame && info.loopEndFrame <= info.frameCount))
+        {
+            info.hasLoop = false;
+        }
+        if (!info.hasLoop)
+        {
+            info.loopStartFrame = 0;
+            info.loopEndFrame = info.frameCount;
+        }
+        *pOutInfo = info;
+        return WavResult_Success;
+    }
+
+    int GetWavSampleByteSize(WavSampleFormat format)
+    {
+        switch (format)
+        {
+        case WavSampleFormat_PcmUInt8:
+            return 1;
+        case WavSampleFormat_PcmInt16:
+            return 2;
+        case WavSampleFormat_PcmInt24:
+            return 3;
+        case WavSampleFormat_PcmInt32:
+        case WavSampleFormat_PcmFloat:
+            return 4;
+        default:
+            assert(false);
+            return 0;
+        }
+    }
+
+    void ConvertWavSamples(int16_t* pOut, const void* pIn, WavSampleFormat format, size_t sampleCount)
+    {
+        assert(pOut != nullptr);
+        assert(pIn != nullptr || sampleCount == 0);
+
+        switch (format)
+        {
+        case WavSampleFormat_PcmUInt8:
+            {
+                // 8-bit WAV samples are unsigned around 128.
+                const uint8_t* pSamples = static_cast<const uint8_t*>(pIn);
+                for (size_t i = 0; i < sampleCount; ++i)
+                {
+                    pOut[i] = static_cast<int16_t>((pSamples[i] - 128) * 256);
+                }
+            }
+            break;
+        case WavSampleFormat_PcmInt16:
+            std::memmove(pOut, pIn, sampleCount * sizeof(int16_t));
+            break;
+        case WavSampleFormat_PcmInt24:
+            {
+                // The upper two bytes of each little endian sample.
+                const uint8_t* pBytes = static_cast<const uint8_t*>(pIn);
+                for (size_t i = 0; i < sampleCount; ++i)
+                {
+                    pOut[i] = static_cast<int16_t>(pBytes[i * 3 + 1] | (pBytes[i * 3 + 2] << 8));
+                }
+            }
+            break;
+        case WavSampleFormat_PcmInt32:
+            {
+                const int32_t* pSamples = static_cast<const int32_t*>(pIn);
+                for (size_t i = 0; i < sampleCount; ++i)
+                {
+                    pOut[i] = static_cast<int16_t>(pSamples[i] >> 16);
+                }
+            }
+            break;
+        case WavSampleFormat_PcmFloat:
+            {
+                const float* pSamples = static_cast<const float*>(pIn);
+                for (size_t i = 0; i < sampleCount; ++i)
+                {
+                    pOut[i] = SampleTraits<int16_t>::FromFloat(pSamples[i]);
+                }
+            }
+            break;
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+}
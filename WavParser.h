@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace AUS {
+
+    enum WavSampleFormat
+    {
+        WavSampleFormat_PcmUInt8,
+        WavSampleFormat_PcmInt16,
+        WavSampleFormat_PcmInt24,
+        WavSampleFormat_PcmInt32,
+        WavSampleFormat_PcmFloat
+    };
+
+    enum WavResult
+    {
+        WavResult_Success,
+        WavResult_ReadError,         // The read function failed.
+        WavResult_NotWave,           // No RIFF WAVE header.
+        WavResult_Corrupt,           // A chunk runs past the end of the file or is too short.
+        WavResult_NoFormat,          // No fmt chunk before the end of the file.
+        WavResult_NoData,            // No data chunk before the end of the file.
+        WavResult_UnsupportedFormat  // Not 8/16/24/32-bit PCM or 32-bit float.
+    };
+
+    // Where the samples of a WAV file are and how to read them.
+    struct WavInfo
+    {
+        WavSampleFormat sampleFormat;
+        int sampleRate;
+        int channelCount;
+        int frameByteSize;  // Bytes of one sample of every channel.
+        int64_t dataOffset; // File offset of the first sample.
+        int64_t frameCount;
+        // The first loop of the smpl chunk, if there is one. loopEndFrame is exclusive.
+        bool hasLoop;
+        int64_t loopStartFrame;
+        int64_t loopEndFrame;
+    };
+
+    // Reads size bytes at offset of the file. Returns false on failure.
+    typedef bool (*WavReadFunction)(void* pBuffer, int64_t offset, size_t size, void* pUserArg);
+
+    // Walks the RIFF chunks of a WAV file of fileSize bytes. Only the chunk headers, the fmt
+    // chunk and the start of the smpl chunk are read, wherever they are in the file, and
+    // every other chunk is skipped.
+    WavResult ParseWav(WavInfo* pOutInfo, WavReadFunction readFunction, void* pUserArg, int64_t fileSize);
+
+    int GetWavSampleByteSize(WavSampleFormat format);
+
+    // Converts sampleCount samples to 16-bit PCM. pIn must be aligned to its sample size,
+    // apart from 24-bit samples, which are read byte by byte. Narrower formats are scaled up,
+    // wider ones truncated and float saturated. The loops are branch free so they vectorize;
+    // the 24-bit one is a stride three byte gather, which NEON loads with vld3.
+    void ConvertWavSamples(int16_t* pOut, const void* pIn, WavSampleFormat format, size_t sampleCount);
+
+}